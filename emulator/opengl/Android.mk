@@ -78,4 +78,7 @@ include $(EMUGL_PATH)/tests/translator_tests/MacCommon/Android.mk
 include $(EMUGL_PATH)/tests/translator_tests/GLES_CM/Android.mk
 include $(EMUGL_PATH)/tests/translator_tests/GLES_V2/Android.mk
 
+# Host benchmarks for the renderer
+include $(EMUGL_PATH)/tests/renderer_bench/Android.mk
+
 endif # BUILD_EMULATOR_OPENGL == true
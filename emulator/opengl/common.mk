@@ -189,11 +189,13 @@ emugl-dump-module = \
 # be automatically added to your LOCAL_C_INCLUDES.
 #
 # Usage:
-#    $(call emugl-gen-decoder,<input-dir>,<basename>)
+#    $(call emugl-gen-decoder,<input-dir>,<basename>[,<emugen-flags>])
+#
+# <emugen-flags> is optional, e.g. '-B table' to force the decoder backend.
 #
 emugl-gen-decoder = \
     $(eval _emugl_out := $(call local-intermediates-dir))\
-    $(call emugl-gen-decoder-generic,$(_emugl_out),$1,$2)\
+    $(call emugl-gen-decoder-generic,$(_emugl_out),$1,$2,$3)\
     $(call emugl-export,C_INCLUDES,$(_emugl_out))
 
 # DO NOT CALL DIRECTLY, USE emugl-gen-decoder instead.
@@ -201,11 +203,12 @@ emugl-gen-decoder = \
 # The following function can be called to generate wire protocol decoder
 # source files, Usage is:
 #
-#  $(call emugl-gen-decoder-generic,<dst-dir>,<src-dir>,<basename>)
+#  $(call emugl-gen-decoder-generic,<dst-dir>,<src-dir>,<basename>[,<emugen-flags>])
 #
 #  <dst-dir> is the destination directory where the generated sources are stored
 #  <src-dir> is the source directory where to find <basename>.attrib, etc..
 #  <basename> is the emugen basename (see host/tools/emugen/README)
+#  <emugen-flags> are extra emugen command line flags
 #
 emugl-gen-decoder-generic = $(eval $(emugl-gen-decoder-generic-ev))
 
@@ -219,7 +222,7 @@ GEN := $$(_emugl_dec)_dec.cpp \
        $$(_emugl_dec)_server_context.cpp
 
 $$(GEN): PRIVATE_PATH := $$(LOCAL_PATH)
-$$(GEN): PRIVATE_CUSTOM_TOOL := $$(EMUGL_EMUGEN) -D $$1 -i $$2 $$3
+$$(GEN): PRIVATE_CUSTOM_TOOL := $$(EMUGL_EMUGEN) $$4 -D $$1 -i $$2 $$3
 $$(GEN): $$(EMUGL_EMUGEN) $$(_emugl_src).attrib $$(_emugl_src).in $$(_emugl_src).types
 	$$(transform-generated-source)
 
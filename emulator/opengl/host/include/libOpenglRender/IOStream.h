@@ -28,6 +28,7 @@ public:
         m_buf = NULL;
         m_bufsize = bufSize;
         m_free = 0;
+        m_openPacket = NULL;
     }
 
     virtual void *allocBuffer(size_t minSize) = 0;
@@ -36,6 +37,12 @@ public:
     virtual const unsigned char *read( void *buf, size_t *inout_len) = 0;
     virtual int writeFully(const void* buf, size_t len) = 0;
 
+    //
+    // Streams which defer commitBuffer() (see SocketStream batching)
+    // send the deferred data here. Called by flush().
+    //
+    virtual int flushPending() { return 0; }
+
     virtual ~IOStream() {
 
         // NOTE: m_buf is 'owned' by the child class thus we expect it to be released by it
@@ -43,9 +50,10 @@ public:
 
     unsigned char *alloc(size_t len) {
 
+        m_openPacket = NULL;
         if (m_buf && len > m_free) {
-            if (flush() < 0) {
-                ERR("Failed to flush in alloc\n");
+            if (commit() < 0) {
+                ERR("Failed to commit in alloc\n");
                 return NULL; // we failed to flush so something is wrong
             }
         }
@@ -68,8 +76,37 @@ public:
         return ptr;
     }
 
-    int flush() {
+    //
+    // Packets an encoder may grow after allocating them, the way the
+    // emugen 'batched' entry points coalesce consecutive calls.
+    // allocPacket() is alloc() leaving the packet open: until anything
+    // else is allocated or the buffer is committed, openPacket() returns
+    // it and appendPacket() allocates the len bytes following it, when
+    // they fit in the buffer (NULL otherwise).
+    //
+    unsigned char *allocPacket(size_t len) {
+        unsigned char *ptr = alloc(len);
+        m_openPacket = ptr;
+        return ptr;
+    }
 
+    unsigned char *openPacket() const { return m_openPacket; }
+
+    unsigned char *appendPacket(size_t len) {
+        if (!m_openPacket || len > m_free) return NULL;
+
+        unsigned char *ptr = m_buf + (m_bufsize - m_free);
+        m_free -= len;
+        return ptr;
+    }
+
+    //
+    // Hand the data allocated so far to the stream. A stream in
+    // batching mode may hold it back until the next flush().
+    //
+    int commit() {
+
+        m_openPacket = NULL;
         if (!m_buf || m_free == m_bufsize) return 0;
 
         int stat = commitBuffer(m_bufsize - m_free);
@@ -78,16 +115,31 @@ public:
         return stat;
     }
 
+    int flush() {
+
+        int stat = commit();
+        int pending = flushPending();
+        return stat < 0 ? stat : pending;
+    }
+
     const unsigned char *readback(void *buf, size_t len) {
         flush();
         return readFully(buf, len);
     }
 
+protected:
+    //
+    // alloc() keeps asking for the largest buffer allocated so far. A
+    // stream which handed out a one-off bigger buffer sets the size of
+    // the next ones back with this once it is committed.
+    //
+    void setBufferSize(size_t bufSize) { m_bufsize = bufSize; }
 
 private:
     unsigned char *m_buf;
     size_t m_bufsize;
     size_t m_free;
+    unsigned char *m_openPacket;
 };
 
 //
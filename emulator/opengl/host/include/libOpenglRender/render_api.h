@@ -55,6 +55,7 @@ DECL(int, initLibrary, (void));
 #define STREAM_MODE_TCP       1
 #define STREAM_MODE_UNIX      2
 #define STREAM_MODE_PIPE      3
+#define STREAM_MODE_SHM       4   /* shared memory rings, Linux only */
 
 /* Change the stream mode. This must be called before initOpenGLRenderer */
 DECL(int, setStreamMode, (int mode));
@@ -117,6 +118,57 @@ typedef void (*OnPostFn)(void* context, int width, int height, int ydir,
                          int format, int type, unsigned char* pixels);
 DECL(void, setPostCallback, (OnPostFn onPost, void* onPostContext));
 
+/* setPostDamageCallback -
+ *    register a per-frame callback like setPostCallback(), which also
+ *    gets the rectangles of the frame that changed since the previous
+ *    call. Only those rectangles are read back from the GPU: the rest of
+ *    'pixels' still holds the previous frame, so the callback must not
+ *    modify the buffer. The first frame is reported as one rectangle
+ *    covering it entirely, and a frame identical to the previous one
+ *    with no rectangle at all.
+ *
+ *    Rectangles are in pixels of the 'pixels' buffer, 'y' counting rows
+ *    from its start, and do not overlap. Registering a callback with
+ *    either function replaces the other one.
+ */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} RenderRect;
+
+typedef void (*OnPostDamageFn)(void* context, int width, int height, int ydir,
+                               int format, int type, unsigned char* pixels,
+                               const RenderRect* rects, int numRects);
+DECL(void, setPostDamageCallback, (OnPostDamageFn onPost, void* onPostContext));
+
+/* setPostReadbackMode -
+ *    choose how frames are read back for the post callbacks.
+ *
+ *    With a 'depth' of 0 (the default) the frame is read back and the
+ *    callback called synchronously while it is posted, which stalls the
+ *    renderer until the callback returns.
+ *
+ *    With a 'depth' of N > 0 each posted frame is only copied on the GPU
+ *    into one of N slots, and a separate renderer thread reads the slots
+ *    back and calls the callback, in posting order. When all N slots are
+ *    waiting to be read back, 'dropPolicy' decides what happens to a new
+ *    frame:
+ *        RENDER_POST_DROP_NEWEST - the new frame is not delivered.
+ *        RENDER_POST_DROP_OLDEST - the oldest waiting frame is replaced.
+ *        RENDER_POST_BLOCK       - posting waits for a free slot.
+ *
+ *    The mode can be changed at any time. Returns false if the arguments
+ *    are invalid.
+ */
+#define RENDER_POST_DROP_NEWEST 0
+#define RENDER_POST_DROP_OLDEST 1
+#define RENDER_POST_BLOCK       2
+#define RENDER_POST_MAX_DEPTH   8
+
+DECL(int, setPostReadbackMode, (int depth, int dropPolicy));
+
 /* createOpenGLSubwindow -
  *     Create a native subwindow which is a child of 'window'
  *     to be used for framebuffer display.
@@ -147,6 +199,73 @@ DECL(void, setOpenGLDisplayRotation, (float zRot));
  */
 DECL(void, repaintOpenGLDisplay, (void));
 
+/* Renderer statistics.
+ *
+ * Every guest connection (served by its own render thread) keeps a set
+ * of counters which the embedding process can query at any time. Only
+ * the connections still open are reported.
+ */
+#define RENDER_STATS_DECODER_GLES1          0
+#define RENDER_STATS_DECODER_GLES2          1
+#define RENDER_STATS_DECODER_RENDER_CONTROL 2
+#define RENDER_STATS_NUM_DECODERS           3
+
+typedef struct {
+    unsigned int       id;            /* unique for the life of the renderer */
+    unsigned long long bytes;         /* bytes received from the guest */
+    double             bytesPerSec;   /* receive rate over the last second */
+    unsigned long long packets[RENDER_STATS_NUM_DECODERS];
+    unsigned long long decodeTimeUs;  /* decoding and executing the commands */
+    unsigned long long readTimeUs;    /* blocked reading the stream */
+    unsigned long long posts;         /* color buffers posted to the display */
+    unsigned long long postTimeUs;    /* cumulative post latency */
+    unsigned long long postMaxUs;     /* worst post latency */
+} RenderConnectionStats;
+
+typedef struct {
+    unsigned int       opcode;
+    const char*        name;          /* e.g. "glDrawArrays" */
+    unsigned long long calls;
+    unsigned long long timeUs;        /* 0 unless opcode timing is enabled */
+} RenderOpcodeStats;
+
+/* getRenderConnectionStats -
+ *    fill up to 'maxCount' entries of 'stats' and return the number of
+ *    open connections, which can be larger than 'maxCount'.
+ */
+DECL(int, getRenderConnectionStats, (RenderConnectionStats* stats, int maxCount));
+
+/* getRenderOpcodeStats -
+ *    fill up to 'maxCount' entries of 'stats' with the opcodes called on
+ *    connection 'id' and return how many distinct opcodes were called,
+ *    or 0 if there is no such connection.
+ */
+DECL(int, getRenderOpcodeStats, (unsigned int id, RenderOpcodeStats* stats, int maxCount));
+
+/* setRenderOpcodeTiming -
+ *    enable (non zero) or disable the per-opcode decode timing. It is off
+ *    by default as it reads the clock twice per packet, unless the
+ *    RENDERER_OPCODE_PROFILE environment variable is set; the render
+ *    threads then also print their opcode profile to stderr on exit.
+ */
+DECL(void, setRenderOpcodeTiming, (int enable));
+
+/* dumpRenderOpcodeProfile -
+ *    write the 'maxCalls' opcodes of connection 'id' which took the most
+ *    time, with their call counts, payload bytes and time percentiles,
+ *    into 'buf' as a text table, truncated to 'bufLen' bytes and always
+ *    NUL terminated. Only the time spent while opcode timing was enabled
+ *    is counted. Returns the buffer size needed for the whole table.
+ */
+DECL(size_t, dumpRenderOpcodeProfile, (unsigned int id, int maxCalls, char* buf, size_t bufLen));
+
+/* dumpRenderStatsJSON -
+ *    write the statistics of all open connections into 'buf' as a JSON
+ *    document, truncated to 'bufLen' bytes and always NUL terminated.
+ *    Returns the buffer size needed for the whole document.
+ */
+DECL(size_t, dumpRenderStatsJSON, (char* buf, size_t bufLen));
+
 /* stopOpenGLRenderer - stops the OpenGL renderer process.
  *     This functions is *NOT* thread safe and should be called
  *     only if previous initOpenGLRenderer has returned true.
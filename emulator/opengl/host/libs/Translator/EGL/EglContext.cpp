@@ -18,8 +18,6 @@
 #include "EglGlobalInfo.h"
 #include "EglOsApi.h"
 
-unsigned int EglContext::s_nextContextHndl = 0;
-
 extern EglGlobalInfo* g_eglInfo; // defined in EglImp.cpp
 
 bool EglContext::usingSurface(SurfacePtr surface) {
@@ -35,12 +33,12 @@ m_glesContext(glesCtx),
 m_read(NULL),
 m_draw(NULL),
 m_version(ver),
-m_mngr(mngr)
+m_mngr(mngr),
+m_hndl(0)
 {
     m_shareGroup = shared_context.Ptr()?
                    mngr->attachShareGroup(context,shared_context->nativeType()):
                    mngr->createShareGroup(context);
-    m_hndl = ++s_nextContextHndl;
 }
 
 EglContext::~EglContext()
@@ -50,13 +50,13 @@ public:
     GLEScontext* getGlesContext(){return m_glesContext;}
     void setSurfaces(SurfacePtr read,SurfacePtr draw);
     unsigned int getHndl(){return m_hndl;}
+    void setHndl(unsigned int hndl){m_hndl = hndl;}
     bool attachImage(unsigned int imageId,ImagePtr img);
     void detachImage(unsigned int imageId);
 
     ~EglContext();
 
 private:
-    static unsigned int  s_nextContextHndl;
     EglDisplay          *m_dpy;
     EGLNativeContextType m_native;
     EglConfig*           m_config;
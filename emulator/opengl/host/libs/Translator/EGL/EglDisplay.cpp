@@ -141,79 +141,46 @@ EglConfig* EglDisplay::getConfig(EGLConfig conf) {
 
 SurfacePtr EglDisplay::getSurface(EGLSurface surface) {
     android::Mutex::Autolock mutex(m_lock);
-    /* surface is "key" in map<unsigned int, SurfacePtr>. */
     unsigned int hndl = ToTargetCompatibleHandle((uintptr_t)surface);
-    SurfacesHndlMap::iterator it = m_surfaces.find(hndl);
-    return it != m_surfaces.end() ?
-                                  (*it).second :
-                                   SurfacePtr(NULL);
+    SurfacePtr* s = m_surfaces.lookup(hndl);
+    return s ? *s : SurfacePtr(NULL);
 }
 
 ContextPtr EglDisplay::getContext(EGLContext ctx) {
     android::Mutex::Autolock mutex(m_lock);
-    /* ctx is "key" in map<unsigned int, ContextPtr>. */
     unsigned int hndl = ToTargetCompatibleHandle((uintptr_t)ctx);
-    ContextsHndlMap::iterator it = m_contexts.find(hndl);
-    return it != m_contexts.end() ?
-                                  (*it).second :
-                                   ContextPtr(NULL);
+    ContextPtr* c = m_contexts.lookup(hndl);
+    return c ? *c : ContextPtr(NULL);
 }
 
 bool EglDisplay::removeSurface(EGLSurface s) {
     android::Mutex::Autolock mutex(m_lock);
-    /* s is "key" in map<unsigned int, SurfacePtr>. */
     unsigned int hndl = ToTargetCompatibleHandle((uintptr_t)s);
-    SurfacesHndlMap::iterator it = m_surfaces.find(hndl);
-    if(it != m_surfaces.end()) {
-        m_surfaces.erase(it);
-        return true;
-    }
-    return false;
+    return m_surfaces.remove(hndl);
 }
 
 bool EglDisplay::removeSurface(SurfacePtr s) {
     android::Mutex::Autolock mutex(m_lock);
-
-    SurfacesHndlMap::iterator it;
-    for(it = m_surfaces.begin(); it!= m_surfaces.end();it++)
-    {
-        if((*it).second.Ptr() == s.Ptr()) {
-            break;
-        }
+    SurfacePtr* found = m_surfaces.lookup(s->getHndl());
+    if(!found || found->Ptr() != s.Ptr()) {
+        return false;
     }
-    if(it != m_surfaces.end()) {
-        m_surfaces.erase(it);
-        return true;
-    }
-    return false;
+    return m_surfaces.remove(s->getHndl());
 }
 
 bool EglDisplay::removeContext(EGLContext ctx) {
     android::Mutex::Autolock mutex(m_lock);
-    /* ctx is "key" in map<unsigned int, ContextPtr>. */
     unsigned int hndl = ToTargetCompatibleHandle((uintptr_t)ctx);
-    ContextsHndlMap::iterator it = m_contexts.find(hndl);
-    if(it != m_contexts.end()) {
-        m_contexts.erase(it);
-        return true;
-    }
-    return false;
+    return m_contexts.remove(hndl);
 }
 
 bool EglDisplay::removeContext(ContextPtr ctx) {
     android::Mutex::Autolock mutex(m_lock);
-
-    ContextsHndlMap::iterator it;
-    for(it = m_contexts.begin(); it != m_contexts.end();it++) {
-        if((*it).second.Ptr() == ctx.Ptr()){
-            break;
-        }
-    }
-    if(it != m_contexts.end()) {
-        m_contexts.erase(it);
-        return true;
+    ContextPtr* found = m_contexts.lookup(ctx->getHndl());
+    if(!found || found->Ptr() != ctx.Ptr()) {
+        return false;
     }
-    return false;
+    return m_contexts.remove(ctx->getHndl());
 }
 
 EglConfig* EglDisplay::getConfig(EGLint id) {
@@ -257,30 +224,34 @@ int EglDisplay::doChooseConfigs(const EglConfig& dummy,EGLConfig* configs,int co
     return added;
 }
 
+//
+// The handle comes from the registry: it is an index into it and the
+// slot generation, a handle kept after the object was removed is
+// rejected. It is stored in the object for eglGetCurrentContext/Surface.
+// EGL_NO_SURFACE/EGL_NO_CONTEXT when the registry is full.
+//
 EGLSurface EglDisplay::addSurface(SurfacePtr s ) {
    android::Mutex::Autolock mutex(m_lock);
    unsigned int hndl = s.Ptr()->getHndl();
-   EGLSurface ret =reinterpret_cast<EGLSurface> (hndl);
-
-   if(m_surfaces.find(hndl) != m_surfaces.end()) {
-       return ret;
+   SurfacePtr* found = m_surfaces.lookup(hndl);
+   if(!found || found->Ptr() != s.Ptr()) {
+       hndl = m_surfaces.add(s);
+       if(!hndl) return EGL_NO_SURFACE;
+       s.Ptr()->setHndl(hndl);
    }
-
-   m_surfaces[hndl] = s;
-   return ret;
+   return reinterpret_cast<EGLSurface> (hndl);
 }
 
 EGLContext EglDisplay::addContext(ContextPtr ctx ) {
-    android::Mutex::Autolock mutex(m_lock);
-
+   android::Mutex::Autolock mutex(m_lock);
    unsigned int hndl = ctx.Ptr()->getHndl();
-   EGLContext ret    = reinterpret_cast<EGLContext> (hndl);
-
-   if(m_contexts.find(hndl) != m_contexts.end()) {
-       return ret;
+   ContextPtr* found = m_contexts.lookup(hndl);
+   if(!found || found->Ptr() != ctx.Ptr()) {
+       hndl = m_contexts.add(ctx);
+       if(!hndl) return EGL_NO_CONTEXT;
+       ctx.Ptr()->setHndl(hndl);
    }
-   m_contexts[hndl] = ctx;
-   return ret;
+   return reinterpret_cast<EGLContext> (hndl);
 }
 
 
@@ -22,6 +22,7 @@
 #include <EGL/eglext.h>
 #include <utils/threads.h>
 #include <GLcommon/SmartPtr.h>
+#include <OpenglCodecCommon/HandleRegistry.h>
 
 #include "EglConfig.h"
 #include "EglContext.h"
@@ -31,8 +32,8 @@
 
 
 typedef  std::list<EglConfig*>  ConfigsList;
-typedef  std::map< unsigned int, ContextPtr>     ContextsHndlMap;
-typedef  std::map< unsigned int, SurfacePtr>     SurfacesHndlMap;
+typedef  HandleRegistry<ContextPtr>   ContextsHndlRegistry;
+typedef  HandleRegistry<SurfacePtr>   SurfacesHndlRegistry;
 
 class EglDisplay {
 public:
@@ -77,8 +78,8 @@ private:
    bool                           m_configInitialized;
    bool                           m_isDefault;
    ConfigsList                    m_configs;
-   ContextsHndlMap                m_contexts;
-   SurfacesHndlMap                m_surfaces;
+   ContextsHndlRegistry           m_contexts;
+   SurfacesHndlRegistry           m_surfaces;
    GlobalNameSpace                m_globalNameSpace;
    ObjectNameManager              *m_manager[MAX_GLES_VERSION];
    android::Mutex                 m_lock;
@@ -496,7 +496,11 @@ EGLAPI EGLSurface EGLAPIENTRY eglCreateWindowSurface(EGLDisplay display, EGLConf
     if(!wSurface.Ptr()) {
         RETURN_ERROR(EGL_NO_SURFACE,EGL_BAD_ALLOC);
     }
-    return dpy->addSurface(wSurface);
+    EGLSurface surface = dpy->addSurface(wSurface);
+    if(surface == EGL_NO_SURFACE) {
+        RETURN_ERROR(EGL_NO_SURFACE,EGL_BAD_ALLOC);
+    }
+    return surface;
 }
 
 EGLAPI EGLSurface EGLAPIENTRY eglCreatePbufferSurface(EGLDisplay display, EGLConfig config,
@@ -540,7 +544,11 @@ EGLAPI EGLSurface EGLAPIENTRY eglCreatePbufferSurface(EGLDisplay display, EGLCon
     }
 
     tmpPbSurfacePtr->setNativePbuffer(pb);
-    return dpy->addSurface(pbSurface);
+    EGLSurface surface = dpy->addSurface(pbSurface);
+    if(surface == EGL_NO_SURFACE) {
+        RETURN_ERROR(EGL_NO_SURFACE,EGL_BAD_ALLOC);
+    }
+    return surface;
 }
 
 EGLAPI EGLSurface EGLAPIENTRY eglCreatePixmapSurface(EGLDisplay display, EGLConfig config,
@@ -567,7 +575,11 @@ EGLAPI EGLSurface EGLAPIENTRY eglCreatePixmapSurface(EGLDisplay display, EGLConf
         RETURN_ERROR(EGL_NO_SURFACE,EGL_BAD_ALLOC);
     }
 
-    return dpy->addSurface(pixSurface);
+    EGLSurface surface = dpy->addSurface(pixSurface);
+    if(surface == EGL_NO_SURFACE) {
+        RETURN_ERROR(EGL_NO_SURFACE,EGL_BAD_ALLOC);
+    }
+    return surface;
 }
 
 EGLAPI EGLBoolean EGLAPIENTRY eglDestroySurface(EGLDisplay display, EGLSurface surface) {
@@ -649,7 +661,11 @@ EGLAPI EGLContext EGLAPIENTRY eglCreateContext(EGLDisplay display, EGLConfig con
 
     if(nativeContext) {
         ContextPtr ctx(new EglContext(dpy, nativeContext,sharedCtxPtr,cfg,glesCtx,version,dpy->getManager(version)));
-        return dpy->addContext(ctx);
+        EGLContext context = dpy->addContext(ctx);
+        if(context == EGL_NO_CONTEXT) {
+            RETURN_ERROR(EGL_NO_CONTEXT,EGL_BAD_ALLOC);
+        }
+        return context;
     } else {
         iface->deleteGLESContext(glesCtx);
     }
@@ -685,6 +701,7 @@ EGLAPI EGLBoolean EGLAPIENTRY eglMakeCurrent(EGLDisplay display, EGLSurface draw
                RETURN_ERROR(EGL_FALSE,EGL_BAD_ACCESS);
            }
            thread->updateInfo(ContextPtr(NULL),dpy,NULL,ShareGroupPtr(NULL),dpy->getManager(prevCtx->version()));
+           g_eglInfo->getIface(prevCtx->version())->setCurrentContext(NULL);
        }
     } else { //assining new context
         VALIDATE_CONTEXT(context);
@@ -743,6 +760,10 @@ EGLAPI EGLBoolean EGLAPIENTRY eglMakeCurrent(EGLDisplay display, EGLSurface draw
         // EGL_BAD_CURRENT_SURFACE , EGL_CONTEXT_LOST  , EGL_BAD_ACCESS
 
         thread->updateInfo(newCtx,dpy,newCtx->getGlesContext(),newCtx->getShareGroup(),dpy->getManager(newCtx->version()));
+        if(prevCtx.Ptr() && prevCtx->version() != newCtx->version()) {
+            g_eglInfo->getIface(prevCtx->version())->setCurrentContext(NULL);
+        }
+        g_eglInfo->getIface(newCtx->version())->setCurrentContext(newCtx->getGlesContext());
         newCtx->setSurfaces(newReadSrfc,newDrawSrfc);
         g_eglInfo->getIface(newCtx->version())->initContext(newCtx->getGlesContext(),newCtx->getShareGroup());
 
@@ -16,8 +16,6 @@
 #include "EglSurface.h"
 #include "EglOsApi.h"
 
-unsigned int EglSurface::s_nextSurfaceHndl = 0;
-
 EglSurface::~EglSurface(){ 
 
     if(m_type == EglSurface::PBUFFER) {
@@ -41,10 +41,10 @@ public:
   void          setDim(int width,int height){ m_width = width; m_height = height;};
   EglConfig*    getConfig(){return m_config;};
   unsigned int  getHndl(){return m_hndl;};
+  void          setHndl(unsigned int hndl){m_hndl = hndl;};
   virtual       ~EglSurface();
 
 private:
-    static unsigned int   s_nextSurfaceHndl;
     ESurfaceType          m_type;
     unsigned int          m_hndl;
 
@@ -55,14 +55,13 @@ protected:
                EGLint width,
                EGLint height) :
        m_type(type),
+       m_hndl(0),
        m_config(config),
        m_width(width),
        m_height(height),
        m_native(NULL),
        m_dpy(dpy)
-    { 
-        m_hndl = ++s_nextSurfaceHndl;
-    }
+    {}
 
 protected:
     EglConfig*            m_config;
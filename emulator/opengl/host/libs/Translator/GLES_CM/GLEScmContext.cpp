@@ -18,7 +18,10 @@
 #include "GLEScmUtils.h"
 #include <GLcommon/GLutils.h>
 #include <GLcommon/GLconversion_macros.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <string>
 #include <GLES/gl.h>
 #include <GLES/glext.h>
 
@@ -39,7 +42,10 @@ void GLEScmContext::init() {
     m_initialized = true;
 }
 
-GLEScmContext::GLEScmContext():GLEScontext(),m_texCoords(NULL),m_pointsIndex(-1), m_clientActiveTexture(0) {
+GLEScmContext::GLEScmContext():GLEScontext(),m_texCoords(NULL),m_pointsIndex(-1), m_clientActiveTexture(0),
+                               m_lightingEnabled(false),m_matrixPaletteEnabled(false),m_texGenUnits(0),
+                               m_pointSizeProgram(0),
+                               m_noPointSizeProgram(getenv("ANDROID_GLES_NO_POINT_SIZE_PROGRAM") != NULL) {
 
     m_map[GL_COLOR_ARRAY]          = new GLESpointer();
     m_map[GL_NORMAL_ARRAY]         = new GLESpointer();
@@ -140,6 +146,136 @@ void GLEScmContext::setupArraysPointers(GLESConversionArrays& cArrs,GLint first,
     s_glDispatch.glClientActiveTexture(activeTexture);
 }
 
+void GLEScmContext::setVertexCapEnabled(GLenum cap,bool enable) {
+    switch(cap) {
+    case GL_LIGHTING:
+        m_lightingEnabled = enable;
+        break;
+    case GL_MATRIX_PALETTE_OES:
+        m_matrixPaletteEnabled = enable;
+        break;
+    case GL_TEXTURE_GEN_STR_OES:
+        if(enable) {
+            m_texGenUnits |= 1 << m_activeTexture;
+        } else {
+            m_texGenUnits &= ~(1 << m_activeTexture);
+        }
+        break;
+    }
+}
+
+//
+// Vertex program doing what the fixed pipeline does for unlit points,
+// with the point size taken per vertex from generic attribute 6 and
+// attenuated and clamped by the current point parameters. Position
+// invariance leaves the position, and so the clipping, to the fixed
+// pipeline.
+//
+#define POINT_SIZE_ATTRIB 6
+
+bool GLEScmContext::initPointSizeProgram() {
+    if(m_pointSizeProgram) return true;
+    if(m_noPointSizeProgram) return false;
+
+    if(!s_glSupport.GL_ARB_VERTEX_PROGRAM ||
+       !s_glDispatch.glGenProgramsARB ||
+       !s_glDispatch.glBindProgramARB ||
+       !s_glDispatch.glProgramStringARB ||
+       !s_glDispatch.glVertexAttribPointerARB ||
+       !s_glDispatch.glEnableVertexAttribArrayARB ||
+       !s_glDispatch.glDisableVertexAttribArrayARB) {
+        m_noPointSizeProgram = true;
+        return false;
+    }
+
+    char line[128];
+    std::string prog = "!!ARBvp1.0\n"
+                       "OPTION ARB_position_invariant;\n";
+    snprintf(line,sizeof(line),"ATTRIB size = vertex.attrib[%d];\n",POINT_SIZE_ATTRIB);
+    prog += line;
+    prog += "PARAM mv[4] = { state.matrix.modelview };\n"
+            "PARAM atten = state.point.attenuation;\n"
+            "PARAM range = state.point.size;\n"
+            "TEMP eye, d, f;\n"
+            "DP4 eye.x, mv[0], vertex.position;\n"
+            "DP4 eye.y, mv[1], vertex.position;\n"
+            "DP4 eye.z, mv[2], vertex.position;\n"
+            // d = (1, |eye|, |eye|^2)
+            "DP3 d.z, eye, eye;\n"
+            "RSQ d.y, d.z;\n"
+            "MUL d.y, d.y, d.z;\n"
+            "MOV d.x, 1.0;\n"
+            // size / sqrt(a + b * d + c * d^2), clamped to [min, max]
+            "DP3 f.x, atten, d;\n"
+            "RSQ f.x, f.x;\n"
+            "MUL f.x, f.x, size.x;\n"
+            "MAX f.x, f.x, range.y;\n"
+            "MIN result.pointsize.x, f.x, range.z;\n"
+            "MOV result.color, vertex.color;\n"
+            "ABS result.fogcoord.x, eye.z;\n";
+
+    for(int i = 0; i < getMaxTexUnits(); i++) {
+        snprintf(line,sizeof(line),
+                 "PARAM tm%d[4] = { state.matrix.texture[%d] };\n"
+                 "DP4 result.texcoord[%d].x, tm%d[0], vertex.texcoord[%d];\n",
+                 i,i,i,i,i);
+        prog += line;
+        for(int c = 1; c < 4; c++) {
+            snprintf(line,sizeof(line),"DP4 result.texcoord[%d].%c, tm%d[%d], vertex.texcoord[%d];\n",
+                     i,"xyzw"[c],i,c,i);
+            prog += line;
+        }
+    }
+    prog += "END\n";
+
+    GLuint name = 0;
+    s_glDispatch.glGenProgramsARB(1,&name);
+    s_glDispatch.glBindProgramARB(GL_VERTEX_PROGRAM_ARB,name);
+    s_glDispatch.glProgramStringARB(GL_VERTEX_PROGRAM_ARB,GL_PROGRAM_FORMAT_ASCII_ARB,
+                                    prog.size(),prog.c_str());
+
+    GLint errorPos = -1;
+    s_glDispatch.glGetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB,&errorPos);
+    if(errorPos != -1) {
+        fprintf(stderr,"point size program rejected at %d: %s\n",errorPos,
+                (const char*)s_glDispatch.glGetString(GL_PROGRAM_ERROR_STRING_ARB));
+        s_glDispatch.glGetError(); // the GL_INVALID_OPERATION raised above
+        s_glDispatch.glBindProgramARB(GL_VERTEX_PROGRAM_ARB,0);
+        if(s_glDispatch.glDeleteProgramsARB) {
+            s_glDispatch.glDeleteProgramsARB(1,&name);
+        }
+        m_noPointSizeProgram = true;
+        return false;
+    }
+
+    //
+    // the binding and the point size switch only take effect while
+    // GL_VERTEX_PROGRAM_ARB is enabled, which is only around the draws
+    //
+    s_glDispatch.glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    m_pointSizeProgram = name;
+    return true;
+}
+
+bool GLEScmContext::drawPointsProgram(const char* pointsArr,int stride,GLint first,GLsizei count,GLenum type,const GLvoid* indices_in,bool isElemsDraw) {
+    if(m_lightingEnabled || m_matrixPaletteEnabled || m_texGenUnits) return false;
+    if(!initPointSizeProgram()) return false;
+
+    s_glDispatch.glVertexAttribPointerARB(POINT_SIZE_ATTRIB,1,GL_FLOAT,GL_FALSE,stride,pointsArr);
+    s_glDispatch.glEnableVertexAttribArrayARB(POINT_SIZE_ATTRIB);
+    s_glDispatch.glEnable(GL_VERTEX_PROGRAM_ARB);
+
+    if(isElemsDraw) {
+        s_glDispatch.glDrawElements(GL_POINTS,count,type,indices_in);
+    } else {
+        s_glDispatch.glDrawArrays(GL_POINTS,first,count);
+    }
+
+    s_glDispatch.glDisable(GL_VERTEX_PROGRAM_ARB);
+    s_glDispatch.glDisableVertexAttribArrayARB(POINT_SIZE_ATTRIB);
+    return true;
+}
+
 void  GLEScmContext::drawPointsData(GLESConversionArrays& cArrs,GLint first,GLsizei count,GLenum type,const GLvoid* indices_in,bool isElemsDraw) {
     const char  *pointsArr =  NULL;
     int stride = 0;
@@ -158,6 +294,11 @@ void  GLEScmContext::drawPointsData(GLESConversionArrays& cArrs,GLint first,GLsi
         stride = sizeof(GLfloat);
     }
 
+    //
+    // one draw for all the points when the host can take the sizes as a
+    // vertex attribute, otherwise one draw per run of equal sizes
+    //
+    if(drawPointsProgram(pointsArr,stride,first,count,type,indices_in,isElemsDraw)) return;
 
     if(isElemsDraw) {
         int tSize = type == GL_UNSIGNED_SHORT ? 2 : 1;
@@ -43,6 +43,7 @@ public:
     void drawPointsElems(GLESConversionArrays& arrs,GLsizei count,GLenum type,const GLvoid* indices);
     virtual const GLESpointer* getPointer(GLenum arrType);
     int  getMaxTexUnits();
+    void setVertexCapEnabled(GLenum cap,bool enable);
 
     virtual bool glGetIntegerv(GLenum pname, GLint *params);
     virtual bool glGetBooleanv(GLenum pname, GLboolean *params);
@@ -58,11 +59,23 @@ private:
     void setupArr(const GLvoid* arr,GLenum arrayType,GLenum dataType,GLint size,GLsizei stride,GLboolean normalized, int pointsIndex = -1);
     void drawPoints(PointSizeIndices* points);
     void drawPointsData(GLESConversionArrays& arrs,GLint first,GLsizei count,GLenum type,const GLvoid* indices_in,bool isElemsDraw);
+    bool drawPointsProgram(const char* pointsArr,int stride,GLint first,GLsizei count,GLenum type,const GLvoid* indices_in,bool isElemsDraw);
+    bool initPointSizeProgram();
     void initExtensionString();
 
     GLESpointer*          m_texCoords;
     int                   m_pointsIndex;
     unsigned int          m_clientActiveTexture;
+
+    //
+    // vertex state the point size program can not reproduce, the
+    // points are drawn in runs of equal size while any of it is enabled
+    //
+    bool                  m_lightingEnabled;
+    bool                  m_matrixPaletteEnabled;
+    unsigned int          m_texGenUnits;      // bit per texture unit
+    GLuint                m_pointSizeProgram;
+    bool                  m_noPointSizeProgram;
 };
 
 #endif
@@ -42,6 +42,7 @@ extern "C" {
 static void initContext(GLEScontext* ctx,ShareGroupPtr grp);
 static void deleteGLESContext(GLEScontext* ctx);
 static void setShareGroup(GLEScontext* ctx,ShareGroupPtr grp);
+static void setCurrentContext(GLEScontext* ctx);
 static GLEScontext* createGLESContext();
 static __translatorMustCastToProperFunctionPointerType getProcAddress(const char* procName);
 
@@ -61,9 +62,14 @@ static GLESiface  s_glesIface = {
     flush            :(FUNCPTR)glFlush,
     finish           :(FUNCPTR)glFinish,
     setShareGroup    :setShareGroup,
+    setCurrentContext:setCurrentContext,
     getProcAddress   :getProcAddress
 };
 
+#ifdef __linux__
+static __thread GLEScontext* s_currentContext = NULL;
+#endif
+
 #include <GLcommon/GLESmacros.h>
 
 extern "C" {
@@ -90,6 +96,12 @@ static void setShareGroup(GLEScontext* ctx,ShareGroupPtr grp) {
         ctx->setShareGroup(grp);
     }
 }
+
+static void setCurrentContext(GLEScontext* ctx) {
+#ifdef __linux__
+    s_currentContext = ctx;
+#endif
+}
 static __translatorMustCastToProperFunctionPointerType getProcAddress(const char* procName) {
     GET_CTX_RET(NULL)
     ctx->getGlobalLock();
@@ -325,13 +337,15 @@ GL_API void GL_APIENTRY  glBindTexture( GLenum target, GLuint texture) {
     }
 
     ctx->setBindedTexture(target,texture);
-    ctx->dispatcher().glBindTexture(target,globalTextureName);
+    if (!ctx->stateFilter().bindTexture(ctx->getActiveTextureUnit(),target,globalTextureName))
+        ctx->dispatcher().glBindTexture(target,globalTextureName);
 }
 
 GL_API void GL_APIENTRY  glBlendFunc( GLenum sfactor, GLenum dfactor) {
     GET_CTX()
     SET_ERROR_IF(!GLEScmValidate::blendSrc(sfactor) || !GLEScmValidate::blendDst(dfactor),GL_INVALID_ENUM)
-    ctx->dispatcher().glBlendFunc(sfactor,dfactor);
+    if (!ctx->stateFilter().blendFunc(sfactor,dfactor))
+        ctx->dispatcher().glBlendFunc(sfactor,dfactor);
 }
 
 GL_API void GL_APIENTRY  glBufferData( GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage) {
@@ -450,9 +464,12 @@ GL_API void GL_APIENTRY  glCompressedTexSubImage2D( GLenum target, GLint level,
     SET_ERROR_IF(level < 0 || level > log2(ctx->getMaxTexSize()),GL_INVALID_VALUE)
 
     GLenum uncompressedFrmt;
-    unsigned char* uncompressed = uncompressTexture(format,uncompressedFrmt,width,height,imageSize,data,level);
+    size_t offset;
+    unsigned char* uncompressed = uncompressTexture(format,uncompressedFrmt,width,height,imageSize,data,
+                                                    0,1,ctx->getUnpackAlignment(),&offset);
+    SET_ERROR_IF(!uncompressed,GL_INVALID_VALUE);
     ctx->dispatcher().glTexSubImage2D(target,level,xoffset,yoffset,width,height,uncompressedFrmt,GL_UNSIGNED_BYTE,uncompressed);
-    delete uncompressed;
+    delete[] uncompressed;
 }
 
 GL_API void GL_APIENTRY  glCopyTexImage2D( GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border) {
@@ -497,6 +514,7 @@ GL_API void GL_APIENTRY  glDeleteTextures( GLsizei n, const GLuint *textures) {
                 if (!tData || tData->sourceEGLImage == 0) {
                     const GLuint globalTextureName = ctx->shareGroup()->getGlobalName(TEXTURE,textures[i]);
                     ctx->dispatcher().glDeleteTextures(1,&globalTextureName);
+                    GLESstateFilter::textureNamesChanged();
                 }
                 ctx->shareGroup()->deleteName(TEXTURE,textures[i]);
                 
@@ -530,15 +548,17 @@ GL_API void GL_APIENTRY  glDepthRangex( GLclampx zNear, GLclampx zFar) {
 }
 
 GL_API void GL_APIENTRY  glDisable( GLenum cap) {
-    GET_CTX()
+    GET_CTX_CM()
     if (cap==GL_TEXTURE_GEN_STR_OES) {
         ctx->dispatcher().glDisable(GL_TEXTURE_GEN_S);
         ctx->dispatcher().glDisable(GL_TEXTURE_GEN_T);
         ctx->dispatcher().glDisable(GL_TEXTURE_GEN_R);
     }
-    else ctx->dispatcher().glDisable(cap);
+    else if (!ctx->stateFilter().enable(cap,ctx->getActiveTextureUnit(),false))
+        ctx->dispatcher().glDisable(cap);
     if (cap==GL_TEXTURE_2D || cap==GL_TEXTURE_CUBE_MAP_OES)
         ctx->setTextureEnabled(cap,false);
+    ctx->setVertexCapEnabled(cap,false);
 }
 
 GL_API void GL_APIENTRY  glDisableClientState( GLenum array) {
@@ -561,6 +581,7 @@ GL_API void GL_APIENTRY  glDrawArrays( GLenum mode, GLint first, GLsizei count)
 
     GLESConversionArrays tmpArrs;
     ctx->setupArraysPointers(tmpArrs,first,count,0,NULL,true);
+    SET_ERROR_IF(tmpArrs.failed(),GL_OUT_OF_MEMORY);
     if(mode == GL_POINTS && ctx->isArrEnabled(GL_POINT_SIZE_ARRAY_OES)){
         ctx->drawPointsArrs(tmpArrs,first,count);
     }
@@ -586,6 +607,7 @@ GL_API void GL_APIENTRY  glDrawElements( GLenum mode, GLsizei count, GLenum type
     }
 
     ctx->setupArraysPointers(tmpArrs,0,count,type,indices,false);
+    SET_ERROR_IF(tmpArrs.failed(),GL_OUT_OF_MEMORY);
     if(mode == GL_POINTS && ctx->isArrEnabled(GL_POINT_SIZE_ARRAY_OES)){
         ctx->drawPointsElems(tmpArrs,count,type,indices);
     }
@@ -595,16 +617,17 @@ GL_API void GL_APIENTRY  glDrawElements( GLenum mode, GLsizei count, GLenum type
 }
 
 GL_API void GL_APIENTRY  glEnable( GLenum cap) {
-    GET_CTX()
+    GET_CTX_CM()
     if (cap==GL_TEXTURE_GEN_STR_OES) {
         ctx->dispatcher().glEnable(GL_TEXTURE_GEN_S);
         ctx->dispatcher().glEnable(GL_TEXTURE_GEN_T);
         ctx->dispatcher().glEnable(GL_TEXTURE_GEN_R);
     }
-    else
+    else if (!ctx->stateFilter().enable(cap,ctx->getActiveTextureUnit(),true))
         ctx->dispatcher().glEnable(cap);
     if (cap==GL_TEXTURE_2D || cap==GL_TEXTURE_CUBE_MAP_OES)
         ctx->setTextureEnabled(cap,true);
+    ctx->setVertexCapEnabled(cap,true);
 }
 
 GL_API void GL_APIENTRY  glEnableClientState( GLenum array) {
@@ -1407,24 +1430,28 @@ GL_API void GL_APIENTRY  glTexCoordPointer( GLint size, GLenum type, GLsizei str
 GL_API void GL_APIENTRY  glTexEnvf( GLenum target, GLenum pname, GLfloat param) {
     GET_CTX()
     SET_ERROR_IF(!GLEScmValidate::texEnv(target,pname),GL_INVALID_ENUM);
-    ctx->dispatcher().glTexEnvf(target,pname,param);
+    if (!ctx->stateFilter().texEnv(ctx->getActiveTextureUnit(),target,pname,param))
+        ctx->dispatcher().glTexEnvf(target,pname,param);
 }
 
 GL_API void GL_APIENTRY  glTexEnvfv( GLenum target, GLenum pname, const GLfloat *params) {
     GET_CTX()
     SET_ERROR_IF(!GLEScmValidate::texEnv(target,pname),GL_INVALID_ENUM);
+    ctx->stateFilter().forgetTexEnv(ctx->getActiveTextureUnit(),target,pname);
     ctx->dispatcher().glTexEnvfv(target,pname,params);
 }
 
 GL_API void GL_APIENTRY  glTexEnvi( GLenum target, GLenum pname, GLint param) {
     GET_CTX()
     SET_ERROR_IF(!GLEScmValidate::texEnv(target,pname),GL_INVALID_ENUM);
-    ctx->dispatcher().glTexEnvi(target,pname,param);
+    if (!ctx->stateFilter().texEnv(ctx->getActiveTextureUnit(),target,pname,param))
+        ctx->dispatcher().glTexEnvi(target,pname,param);
 }
 
 GL_API void GL_APIENTRY  glTexEnviv( GLenum target, GLenum pname, const GLint *params) {
     GET_CTX()
     SET_ERROR_IF(!GLEScmValidate::texEnv(target,pname),GL_INVALID_ENUM);
+    ctx->stateFilter().forgetTexEnv(ctx->getActiveTextureUnit(),target,pname);
     ctx->dispatcher().glTexEnviv(target,pname,params);
 }
 
@@ -1432,7 +1459,8 @@ GL_API void GL_APIENTRY  glTexEnvx( GLenum target, GLenum pname, GLfixed param)
     GET_CTX()
     SET_ERROR_IF(!GLEScmValidate::texEnv(target,pname),GL_INVALID_ENUM);
     GLfloat tmpParam = static_cast<GLfloat>(param);
-    ctx->dispatcher().glTexEnvf(target,pname,tmpParam);
+    if (!ctx->stateFilter().texEnv(ctx->getActiveTextureUnit(),target,pname,tmpParam))
+        ctx->dispatcher().glTexEnvf(target,pname,tmpParam);
 }
 
 GL_API void GL_APIENTRY  glTexEnvxv( GLenum target, GLenum pname, const GLfixed *params) {
@@ -1447,6 +1475,7 @@ GL_API void GL_APIENTRY  glTexEnvxv( GLenum target, GLenum pname, const GLfixed
     } else {
         tmpParams[0] = static_cast<GLfloat>(params[0]);
     }
+    ctx->stateFilter().forgetTexEnv(ctx->getActiveTextureUnit(),target,pname);
     ctx->dispatcher().glTexEnvfv(target,pname,tmpParams);
 }
 
@@ -1487,6 +1516,7 @@ GL_API void GL_APIENTRY  glTexImage2D( GLenum target, GLint level, GLint interna
                                                      tex,
                                                      texData->oldGlobal);
                 ctx->dispatcher().glBindTexture(GL_TEXTURE_2D, texData->oldGlobal);
+                GLESstateFilter::textureNamesChanged();
                 texData->sourceEGLImage = 0;
                 texData->oldGlobal = 0;
             }
@@ -1671,6 +1701,7 @@ GL_API void GL_APIENTRY glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOE
             // replace mapping and bind the new global object
             ctx->shareGroup()->replaceGlobalName(TEXTURE, tex,img->globalTexName);
             ctx->dispatcher().glBindTexture(GL_TEXTURE_2D, img->globalTexName);
+            GLESstateFilter::textureNamesChanged();
             TextureData *texData = getTextureTargetData(target);
             SET_ERROR_IF(texData==NULL,GL_INVALID_OPERATION);
             texData->width = img->width;
@@ -1751,6 +1782,7 @@ GL_API void GL_APIENTRY glBlendFuncSeparateOES(GLenum srcRGB, GLenum dstRGB, GLe
     GET_CTX()
     SET_ERROR_IF(!GLEScmValidate::blendSrc(srcRGB) || !GLEScmValidate::blendDst(dstRGB) ||
                  !GLEScmValidate::blendSrc(srcAlpha) || ! GLEScmValidate::blendDst(dstAlpha) ,GL_INVALID_ENUM);
+    ctx->stateFilter().forgetBlendFunc();
     ctx->dispatcher().glBlendFuncSeparate(srcRGB,dstRGB,srcAlpha,dstAlpha);
 }
 
@@ -15,6 +15,7 @@
 */
 
 #include "GLESv2Context.h"
+#include <string.h>
 
 
 
@@ -36,7 +37,10 @@ void GLESv2Context::init() {
     m_initialized = true;
 }
 
-GLESv2Context::GLESv2Context():GLEScontext(), m_att0Array(NULL), m_att0ArrayLength(0), m_att0NeedsDisable(false){};
+GLESv2Context::GLESv2Context():GLEScontext(), m_att0Array(NULL), m_att0ArrayLength(0), m_att0Filled(0), m_att0Bound(false){
+    m_attribute0value[0] = m_attribute0value[1] = m_attribute0value[2] = 0.0;
+    m_attribute0value[3] = 1.0;
+};
 
 GLESv2Context::~GLESv2Context()
 {
@@ -45,6 +49,10 @@ GLESv2Context::~GLESv2Context()
 
 void GLESv2Context::setAttribute0value(float x, float y, float z, float w)
 {
+    if(m_attribute0value[0] != x || m_attribute0value[1] != y ||
+       m_attribute0value[2] != z || m_attribute0value[3] != w)
+        m_att0Filled = 0;
+
     m_attribute0value[0] = x;
     m_attribute0value[1] = y;
     m_attribute0value[2] = z;
@@ -53,38 +61,43 @@ void GLESv2Context::setAttribute0value(float x, float y, float z, float w)
 
 void GLESv2Context::validateAtt0PreDraw(unsigned int count)
 {
-    m_att0NeedsDisable = false;
-
     if(count == 0)
         return;
 
-    int enabled = 0;
-    s_glDispatch.glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
-    if(enabled)
+    if(isArrEnabled(0)) {
+        // setupArraysPointers() pointed the host array to the application's
+        m_att0Bound = false;
         return;
+    }
 
     if(count > m_att0ArrayLength)
     {
-        delete [] m_att0Array; 
-        m_att0Array = new GLfloat[4*count];
-        m_att0ArrayLength = count;
+        unsigned int length = m_att0ArrayLength * 2;
+        if(length < count)
+            length = count;
+        delete [] m_att0Array;
+        m_att0Array = new GLfloat[4*length];
+        m_att0ArrayLength = length;
+        m_att0Filled = 0;
+        m_att0Bound = false;
     }
 
-    for(unsigned int i=0; i<count; i++)
+    for(unsigned int i=m_att0Filled; i<count; i++)
         memcpy(m_att0Array+i*4, m_attribute0value, 4*sizeof(GLfloat));
+    if(count > m_att0Filled)
+        m_att0Filled = count;
 
-    s_glDispatch.glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, m_att0Array);
-    s_glDispatch.glEnableVertexAttribArray(0);
-
-    m_att0NeedsDisable = true;
+    if(!m_att0Bound) {
+        s_glDispatch.glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, m_att0Array);
+        s_glDispatch.glEnableVertexAttribArray(0);
+        m_att0Bound = true;
+    }
 }
 
 void GLESv2Context::validateAtt0PostDraw(void)
 {
-    if(m_att0NeedsDisable)
-        s_glDispatch.glDisableVertexAttribArray(0);
-
-    m_att0NeedsDisable = false;
+    // the attribute 0 array stays enabled for the next draw, the
+    // application's view of it is the GLESpointer's
 }
 
 void GLESv2Context::setupArraysPointers(GLESConversionArrays& cArrs,GLint first,GLsizei count,GLenum type,const GLvoid* indices,bool direct) {
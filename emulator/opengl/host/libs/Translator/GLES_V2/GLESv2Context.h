@@ -36,9 +36,17 @@ public:
     // GLES allows a vertex shader attribute to be in location 0 and have a
     // current value, while OpenGL is not very clear about this, which results
     // in each implementation doing something different.
+    //
+    // The attribute 0 array and whether it is enabled are kept from one
+    // draw to the next, the array is only refilled when the value changes
+    // or more vertices are drawn. The enable state is the one shadowed in
+    // the GLESpointer, the host driver is not asked for it.
+    //
     void setAttribute0value(float x, float y, float z, float w);
     void validateAtt0PreDraw(unsigned int count);
     void validateAtt0PostDraw(void);
+    // the application enabled or disabled the attribute 0 array
+    void att0ArrayChanged(void) {m_att0Bound = false;}
     const float* getAtt0(void) {return m_attribute0value;}
 
 protected:
@@ -50,7 +58,8 @@ private:
     float m_attribute0value[4];
     GLfloat* m_att0Array;
     unsigned int m_att0ArrayLength;
-    bool m_att0NeedsDisable;
+    unsigned int m_att0Filled;    // vertices of m_att0Array holding the value
+    bool m_att0Bound;             // host attribute 0 array is m_att0Array
 };
 
 #endif
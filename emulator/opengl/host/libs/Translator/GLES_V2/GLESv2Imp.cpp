@@ -39,6 +39,7 @@ extern "C" {
 static void initContext(GLEScontext* ctx,ShareGroupPtr grp);
 static void deleteGLESContext(GLEScontext* ctx);
 static void setShareGroup(GLEScontext* ctx,ShareGroupPtr grp);
+static void setCurrentContext(GLEScontext* ctx);
 static GLEScontext* createGLESContext();
 static __translatorMustCastToProperFunctionPointerType getProcAddress(const char* procName);
 
@@ -58,9 +59,14 @@ static GLESiface  s_glesIface = {
     flush            :(FUNCPTR)glFlush,
     finish           :(FUNCPTR)glFinish,
     setShareGroup    :setShareGroup,
+    setCurrentContext:setCurrentContext,
     getProcAddress   :getProcAddress
 };
 
+#ifdef __linux__
+static __thread GLEScontext* s_currentContext = NULL;
+#endif
+
 #include <GLcommon/GLESmacros.h>
 
 extern "C" {
@@ -87,6 +93,12 @@ static void setShareGroup(GLEScontext* ctx,ShareGroupPtr grp) {
     }
 }
 
+static void setCurrentContext(GLEScontext* ctx) {
+#ifdef __linux__
+    s_currentContext = ctx;
+#endif
+}
+
 static __translatorMustCastToProperFunctionPointerType getProcAddress(const char* procName) {
     GET_CTX_RET(NULL)
     ctx->getGlobalLock();
@@ -266,7 +278,8 @@ GL_APICALL void  GL_APIENTRY glBindTexture(GLenum target, GLuint texture){
     }
 
     ctx->setBindedTexture(target,texture);
-    ctx->dispatcher().glBindTexture(target,globalTextureName);
+    if (!ctx->stateFilter().bindTexture(ctx->getActiveTextureUnit(),target,globalTextureName))
+        ctx->dispatcher().glBindTexture(target,globalTextureName);
 }
 
 GL_APICALL void  GL_APIENTRY glBlendColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha){
@@ -289,13 +302,15 @@ GL_APICALL void  GL_APIENTRY glBlendEquationSeparate(GLenum modeRGB, GLenum mode
 GL_APICALL void  GL_APIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor){
     GET_CTX();
     SET_ERROR_IF(!GLESv2Validate::blendSrc(sfactor) || !GLESv2Validate::blendDst(dfactor),GL_INVALID_ENUM)
-    ctx->dispatcher().glBlendFunc(sfactor,dfactor);
+    if (!ctx->stateFilter().blendFunc(sfactor,dfactor))
+        ctx->dispatcher().glBlendFunc(sfactor,dfactor);
 }
 
 GL_APICALL void  GL_APIENTRY glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha){
     GET_CTX();
     SET_ERROR_IF(
 !(GLESv2Validate::blendSrc(srcRGB) && GLESv2Validate::blendDst(dstRGB) && GLESv2Validate::blendSrc(srcAlpha) && GLESv2Validate::blendDst(dstAlpha)),GL_INVALID_ENUM);
+    ctx->stateFilter().forgetBlendFunc();
     ctx->dispatcher().glBlendFuncSeparate(srcRGB,dstRGB,srcAlpha,dstAlpha);
 }
 
@@ -476,6 +491,7 @@ GL_APICALL void  GL_APIENTRY glDeleteTextures(GLsizei n, const GLuint* textures)
                 if (!tData || tData->sourceEGLImage == 0) {
                     const GLuint globalTextureName = ctx->shareGroup()->getGlobalName(TEXTURE,textures[i]);
                     ctx->dispatcher().glDeleteTextures(1,&globalTextureName);
+                    GLESstateFilter::textureNamesChanged();
                 }
                 ctx->shareGroup()->deleteName(TEXTURE,textures[i]);
 
@@ -544,13 +560,15 @@ GL_APICALL void  GL_APIENTRY glDetachShader(GLuint program, GLuint shader){
 
 GL_APICALL void  GL_APIENTRY glDisable(GLenum cap){
     GET_CTX();
-    ctx->dispatcher().glDisable(cap);
+    if (!ctx->stateFilter().enable(cap,ctx->getActiveTextureUnit(),false))
+        ctx->dispatcher().glDisable(cap);
 }
 
 GL_APICALL void  GL_APIENTRY glDisableVertexAttribArray(GLuint index){
-    GET_CTX();
+    GET_CTX_V2();
     SET_ERROR_IF((!GLESv2Validate::arrayIndex(ctx,index)),GL_INVALID_VALUE);
     ctx->enableArr(index,false);
+    if(index == 0) ctx->att0ArrayChanged();
     ctx->dispatcher().glDisableVertexAttribArray(index);
 }
 
@@ -563,8 +581,9 @@ GL_APICALL void  GL_APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei coun
 
     GLESConversionArrays tmpArrs;
     ctx->setupArraysPointers(tmpArrs,first,count,0,NULL,true);
+    SET_ERROR_IF(tmpArrs.failed(),GL_OUT_OF_MEMORY);
 
-    ctx->validateAtt0PreDraw(count);
+    ctx->validateAtt0PreDraw(count ? first + count : 0);
 
     //Enable texture generation for GL_POINTS and gl_PointSize shader variable
     //GLES2 assumes this is enabled by default, we need to set this state for GL
@@ -598,9 +617,10 @@ GL_APICALL void  GL_APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum t
 
     GLESConversionArrays tmpArrs;
     ctx->setupArraysPointers(tmpArrs,0,count,type,indices,false);
+    SET_ERROR_IF(tmpArrs.failed(),GL_OUT_OF_MEMORY);
 
     int maxIndex = ctx->findMaxIndex(count, type, indices);
-    ctx->validateAtt0PreDraw(maxIndex);
+    ctx->validateAtt0PreDraw(count ? maxIndex + 1 : 0);
     
     //See glDrawArrays
     if (mode==GL_POINTS) {
@@ -620,13 +640,15 @@ GL_APICALL void  GL_APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum t
 
 GL_APICALL void  GL_APIENTRY glEnable(GLenum cap){
     GET_CTX();
-    ctx->dispatcher().glEnable(cap);
+    if (!ctx->stateFilter().enable(cap,ctx->getActiveTextureUnit(),true))
+        ctx->dispatcher().glEnable(cap);
 }
 
 GL_APICALL void  GL_APIENTRY glEnableVertexAttribArray(GLuint index){
-    GET_CTX();
+    GET_CTX_V2();
     SET_ERROR_IF(!(GLESv2Validate::arrayIndex(ctx,index)),GL_INVALID_VALUE);
     ctx->enableArr(index,true);
+    if(index == 0) ctx->att0ArrayChanged();
     ctx->dispatcher().glEnableVertexAttribArray(index);
 }
 
@@ -1767,6 +1789,7 @@ GL_APICALL void  GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint inte
                                                      tex,
                                                      texData->oldGlobal);
                 ctx->dispatcher().glBindTexture(GL_TEXTURE_2D, texData->oldGlobal);
+                GLESstateFilter::textureNamesChanged();
                 texData->sourceEGLImage = 0;
                 texData->oldGlobal = 0;
             }
@@ -1911,7 +1934,8 @@ GL_APICALL void  GL_APIENTRY glUseProgram(GLuint program){
         SET_ERROR_IF(program!=0 && globalProgramName==0,GL_INVALID_VALUE);
         ObjectDataPtr objData = ctx->shareGroup()->getObjectData(SHADER,program);
         SET_ERROR_IF(objData.Ptr() && (objData.Ptr()->getDataType()!=PROGRAM_DATA),GL_INVALID_OPERATION);
-        ctx->dispatcher().glUseProgram(globalProgramName);
+        if (!ctx->stateFilter().useProgram(globalProgramName))
+            ctx->dispatcher().glUseProgram(globalProgramName);
     }
 }
 
@@ -2025,6 +2049,7 @@ GL_APICALL void GL_APIENTRY glEGLImageTargetTexture2DOES(GLenum target, GLeglIma
             // replace mapping and bind the new global object
             ctx->shareGroup()->replaceGlobalName(TEXTURE, tex,img->globalTexName);
             ctx->dispatcher().glBindTexture(GL_TEXTURE_2D, img->globalTexName);
+            GLESstateFilter::textureNamesChanged();
             TextureData *texData = getTextureTargetData(target);
             SET_ERROR_IF(texData==NULL,GL_INVALID_OPERATION);
             texData->width = img->width;
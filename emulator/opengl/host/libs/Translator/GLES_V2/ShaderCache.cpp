@@ -0,0 +1,99 @@
+/*
+* Copyright 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "ShaderCache.h"
+#include <utils/threads.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <list>
+#include <map>
+
+// total size of the sources kept, original and translated
+#define MAX_CACHE_BYTES (4 * 1024 * 1024)
+
+struct CacheEntry {
+    uint64_t    hash;
+    std::string src;
+    std::string translated;
+};
+
+typedef std::list<CacheEntry> EntryList;   // most recently used first
+typedef std::map<uint64_t,EntryList::iterator> EntryMap;
+
+static android::Mutex  s_lock;
+static EntryList       s_entries;
+static EntryMap        s_index;
+static size_t          s_bytes = 0;
+static const bool      s_enabled = getenv("ANDROID_GLES_NO_SHADER_CACHE") == NULL;
+
+// 64 bit FNV-1a
+static uint64_t hashSource(const std::string& src) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < src.size(); i++) {
+        h ^= (unsigned char)src[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static size_t entryBytes(const CacheEntry& e) {
+    return e.src.size() + e.translated.size();
+}
+
+static void removeEntry(EntryList::iterator it) {
+    s_bytes -= entryBytes(*it);
+    s_index.erase((*it).hash);
+    s_entries.erase(it);
+}
+
+bool ShaderCache::find(const std::string& src,std::string* translated) {
+    if (!s_enabled) return false;
+
+    uint64_t hash = hashSource(src);
+    android::Mutex::Autolock mutex(s_lock);
+    EntryMap::iterator it = s_index.find(hash);
+    if (it == s_index.end() || (*(*it).second).src != src) {
+        return false;
+    }
+
+    s_entries.splice(s_entries.begin(),s_entries,(*it).second);
+    *translated = (*(*it).second).translated;
+    return true;
+}
+
+void ShaderCache::add(const std::string& src,const std::string& translated) {
+    if (!s_enabled) return;
+
+    CacheEntry e;
+    e.hash = hashSource(src);
+    e.src = src;
+    e.translated = translated;
+    if (entryBytes(e) > MAX_CACHE_BYTES) return;
+
+    android::Mutex::Autolock mutex(s_lock);
+    // a colliding source replaces the one cached
+    EntryMap::iterator it = s_index.find(e.hash);
+    if (it != s_index.end()) {
+        removeEntry((*it).second);
+    }
+    while (s_bytes + entryBytes(e) > MAX_CACHE_BYTES) {
+        removeEntry(--s_entries.end());
+    }
+
+    s_bytes += entryBytes(e);
+    s_entries.push_front(e);
+    s_index[e.hash] = s_entries.begin();
+}
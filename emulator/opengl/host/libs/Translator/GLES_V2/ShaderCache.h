@@ -0,0 +1,38 @@
+/*
+* Copyright 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <string>
+
+//
+// Process wide cache of the sources ShaderParser produced, keyed by the
+// source the guest gave, so that a shader submitted again is not parsed
+// again. Entries are found by a hash of the source and checked against
+// it; the least recently used ones are dropped past a total size.
+//
+// Setting ANDROID_GLES_NO_SHADER_CACHE in the environment disables it.
+//
+class ShaderCache
+{
+public:
+    // false when src was not translated before
+    static bool find(const std::string& src,std::string* translated);
+    static void add(const std::string& src,const std::string& translated);
+};
+
+#endif
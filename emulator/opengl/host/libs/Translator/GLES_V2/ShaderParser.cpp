@@ -15,11 +15,12 @@
 */
 
 #include "ShaderParser.h"
+#include "ShaderCache.h"
+#include <stdlib.h>
 #include <string.h>
 
 ShaderParser::ShaderParser():ObjectData(SHADER_DATA),
                              m_type(0),
-                             m_originalSrc(NULL),
                              m_parsedLines(NULL) {
     m_infoLog = new GLchar[1];
     m_infoLog[0] = '\0';
@@ -27,7 +28,6 @@ ShaderParser::ShaderParser():ObjectData(SHADER_DATA),
 
 ShaderParser::ShaderParser(GLenum type):ObjectData(SHADER_DATA), 
                                         m_type(type),
-                                        m_originalSrc(NULL),
                                         m_parsedLines(NULL) {
 
     m_infoLog = new GLchar[1];
@@ -35,16 +35,23 @@ ShaderParser::ShaderParser(GLenum type):ObjectData(SHADER_DATA),
 };
 
 void ShaderParser::setSrc(const Version& ver,GLsizei count,const GLchar** strings,const GLint* length){
+    m_src.clear();
     for(int i = 0;i<count;i++){
-        m_src.append(strings[i]);
+        if(length && length[i] >= 0) {
+            m_src.append(strings[i],length[i]);
+        } else {
+            m_src.append(strings[i]);
+        }
     }
     //store original source
-    if (m_originalSrc)
-        free(m_originalSrc);
-    m_originalSrc = strdup(m_src.c_str());
+    m_originalSrc = m_src;
 
     clearParsedSrc();
 
+    // the same source is often given again, by this or another context
+    if (ShaderCache::find(m_originalSrc,&m_parsedSrc))
+        return;
+
     // parseGLSLversion must be called first since #version should be the
     // first token in the shader source.
     parseGLSLversion();
@@ -67,6 +74,7 @@ void ShaderParser::setSrc(const Version& ver,GLsizei count,const GLchar** string
 #endif
     parseLineNumbers();
     parseOriginalSrc();
+    ShaderCache::add(m_originalSrc,m_parsedSrc);
 }
 const GLchar** ShaderParser::parsedLines() {
       m_parsedLines = (GLchar*)m_parsedSrc.c_str();
@@ -74,7 +82,7 @@ const GLchar** ShaderParser::parsedLines() {
 };
 
 const char* ShaderParser::getOriginalSrc(){
-    return m_originalSrc;
+    return m_originalSrc.c_str();
 }
 
 void ShaderParser::parseLineNumbers()
@@ -337,7 +345,5 @@ GLchar* ShaderParser::getInfoLog()
 
 ShaderParser::~ShaderParser(){
     clearParsedSrc();
-    if (m_originalSrc)
-        free(m_originalSrc);
     delete[] m_infoLog;
 }
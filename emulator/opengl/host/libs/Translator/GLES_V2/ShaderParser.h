@@ -45,7 +45,7 @@ private:
     void clearParsedSrc();
 
     GLenum      m_type;
-    char*       m_originalSrc;
+    std::string m_originalSrc;
     std::string m_src;
     std::string m_parsedSrc;
     GLchar*     m_parsedLines;
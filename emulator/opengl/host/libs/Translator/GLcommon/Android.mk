@@ -7,11 +7,15 @@ host_common_SRC_FILES :=     \
      GLESvalidate.cpp        \
      GLESpointer.cpp         \
      GLESbuffer.cpp          \
+     GLESstateFilter.cpp     \
      DummyGLfuncs.cpp        \
      RangeManip.cpp          \
      TextureUtils.cpp        \
+     VertexConversion.cpp    \
+     ConvertedArrayCache.cpp \
      PaletteTexture.cpp      \
      etc1.cpp                \
+     Etc1Decoder.cpp         \
      objectNameManager.cpp   \
      FramebufferData.cpp
 
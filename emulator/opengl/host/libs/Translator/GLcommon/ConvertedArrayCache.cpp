@@ -0,0 +1,114 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <GLcommon/ConvertedArrayCache.h>
+#include <GLcommon/VertexConversion.h>
+#include <stdlib.h>
+#include <string.h>
+
+// consecutive changed draws after which the source is no longer compared
+#define MAX_CHANGES     4
+// draws without comparing before trying again
+#define RETRY_INTERVAL  64
+
+ConvertedArrayCache::ConvertedArrayCache():m_data(NULL),
+                                           m_stride(0),
+                                           m_type(0),
+                                           m_attribSize(0),
+                                           m_nElements(0),
+                                           m_valid(false),
+                                           m_converted(NULL),
+                                           m_convertedCap(0),
+                                           m_source(NULL),
+                                           m_sourceCap(0),
+                                           m_compare(true),
+                                           m_changes(0),
+                                           m_skipped(0){}
+
+ConvertedArrayCache::~ConvertedArrayCache() {
+    free(m_converted);
+    free(m_source);
+}
+
+bool ConvertedArrayCache::grow(unsigned char** buf, size_t* cap, size_t len) {
+    if (len <= *cap) return true;
+    size_t newCap = *cap ? *cap : 256;
+    while (newCap < len) newCap *= 2;
+    unsigned char* p = (unsigned char*)realloc(*buf, newCap);
+    if (!p) return false;
+    *buf = p;
+    *cap = newCap;
+    return true;
+}
+
+void* ConvertedArrayCache::convert(const char* data, unsigned int stride, GLenum type,
+                                   int attribSize, unsigned int nElements) {
+    unsigned int inSize  = type == GL_FIXED ? sizeof(GLfixed) : sizeof(GLbyte);
+    unsigned int outSize = type == GL_FIXED ? sizeof(GLfloat) : sizeof(GLshort);
+    size_t sourceLen = nElements ? (nElements - 1) * stride + attribSize * inSize : 0;
+    size_t convertedLen = nElements * attribSize * outSize;
+
+    bool sameLayout = m_valid &&
+                      data == m_data && stride == m_stride && type == m_type &&
+                      attribSize == m_attribSize && nElements == m_nElements;
+
+    if (sameLayout && m_compare && memcmp(m_source, data, sourceLen) == 0) {
+        m_changes = 0;
+        return m_converted;
+    }
+
+    m_valid = false;
+    if (!grow(&m_converted, &m_convertedCap, convertedLen)) {
+        return NULL;
+    }
+    if (type == GL_FIXED) {
+        convertFixedToFloat(data, stride, (char*)m_converted,
+                            attribSize * outSize, nElements, attribSize);
+    } else {
+        convertByteToShort(data, stride, (char*)m_converted,
+                           attribSize * outSize, nElements, attribSize);
+    }
+
+    //
+    // arrays rewritten on every draw are not worth copying
+    //
+    if (!sameLayout) {
+        m_changes = 0;
+    } else if (m_compare) {
+        m_changes++;
+    }
+    if (m_compare && m_changes >= MAX_CHANGES) {
+        m_compare = false;
+        m_skipped = 0;
+    } else if (!m_compare && ++m_skipped >= RETRY_INTERVAL) {
+        m_compare = true;
+        m_changes = 0;
+    }
+
+    if (m_compare) {
+        if (!grow(&m_source, &m_sourceCap, sourceLen)) {
+            return m_converted;
+        }
+        memcpy(m_source, data, sourceLen);
+    }
+
+    m_data = data;
+    m_stride = stride;
+    m_type = type;
+    m_attribSize = attribSize;
+    m_nElements = nElements;
+    m_valid = true;
+    return m_converted;
+}
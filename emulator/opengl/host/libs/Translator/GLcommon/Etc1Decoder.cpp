@@ -0,0 +1,261 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <GLcommon/Etc1Decoder.h>
+#include <OpenglOsUtils/osThread.h>
+#include <utils/threads.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define MAX_WORKERS     3
+// block rows handed out at a time, and the image height, in block rows,
+// below which the pool is not used
+#define CHUNK_ROWS      4
+#define MIN_POOL_ROWS   64
+
+namespace {
+
+struct DecodeJob {
+    const etc1_byte* in;
+    etc1_byte*       out;
+    etc1_uint32      width;
+    etc1_uint32      height;
+    etc1_uint32      stride;
+    etc1_uint32      rows;       // block rows of the image
+    etc1_uint32      nextRow;    // first one not handed out yet
+    etc1_uint32      rowsDone;
+};
+
+class DecodePool
+{
+public:
+    static DecodePool* get();
+
+    // false when the pool is busy with another image
+    bool decode(DecodeJob* job);
+
+    void workerLoop();
+
+private:
+    DecodePool():m_job(NULL){}
+
+    // hands out the next chunk of the current job, called locked
+    bool takeRows(etc1_uint32* first,etc1_uint32* end);
+    void rowsDone(etc1_uint32 n);
+
+    android::Mutex     m_busy;     // held by the thread submitting a job
+    android::Mutex     m_lock;
+    android::Condition m_workCond;
+    android::Condition m_doneCond;
+    DecodeJob*         m_job;
+};
+
+class DecodeWorker : public osUtils::Thread
+{
+public:
+    DecodeWorker(DecodePool* pool):m_pool(pool){}
+    virtual int Main() {
+        m_pool->workerLoop();
+        return 0;
+    }
+private:
+    DecodePool* m_pool;
+};
+
+static int workerCount() {
+    const char* env = getenv("ANDROID_GLES_ETC1_THREADS");
+    if (env) {
+        int n = atoi(env);
+        if (n < 0) n = 0;
+        return n < MAX_WORKERS ? n : MAX_WORKERS;
+    }
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int cpus = info.dwNumberOfProcessors;
+#else
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    int n = cpus - 1;
+    if (n < 0) n = 0;
+    return n < MAX_WORKERS ? n : MAX_WORKERS;
+}
+
+static android::Mutex s_poolLock;
+static bool           s_poolInitialized = false;
+static DecodePool*    s_pool = NULL;
+
+//
+// The pool and its workers live until the process exits, the workers
+// wait for jobs on the pool condition so they are never destroyed.
+//
+DecodePool* DecodePool::get() {
+    android::Mutex::Autolock mutex(s_poolLock);
+    if (s_poolInitialized) {
+        return s_pool;
+    }
+    s_poolInitialized = true;
+
+    int n = workerCount();
+    if (n == 0) {
+        return NULL;
+    }
+
+    // a worker failing to start is harmless, the caller decodes too
+    DecodePool* pool = new DecodePool();
+    for (int i = 0; i < n; i++) {
+        DecodeWorker* w = new DecodeWorker(pool);
+        if (!w->start()) {
+            delete w;
+            break;
+        }
+    }
+    s_pool = pool;
+    return s_pool;
+}
+
+bool DecodePool::takeRows(etc1_uint32* first,etc1_uint32* end) {
+    if (!m_job || m_job->nextRow >= m_job->rows) {
+        return false;
+    }
+    *first = m_job->nextRow;
+    *end = *first + CHUNK_ROWS;
+    if (*end > m_job->rows) {
+        *end = m_job->rows;
+    }
+    m_job->nextRow = *end;
+    return true;
+}
+
+void DecodePool::rowsDone(etc1_uint32 n) {
+    m_job->rowsDone += n;
+    if (m_job->rowsDone == m_job->rows) {
+        m_doneCond.signal();
+    }
+}
+
+void DecodePool::workerLoop() {
+    m_lock.lock();
+    for (;;) {
+        etc1_uint32 first, end;
+        while (!takeRows(&first,&end)) {
+            m_workCond.wait(m_lock);
+        }
+        // the job outlives the rows taken, its owner waits for them
+        DecodeJob* job = m_job;
+        m_lock.unlock();
+        Etc1Decoder::decodeBlockRows(job->in,job->out,job->width,job->height,
+                                     job->stride,first,end);
+        m_lock.lock();
+        rowsDone(end - first);
+    }
+}
+
+bool DecodePool::decode(DecodeJob* job) {
+    if (m_busy.tryLock() != 0) {
+        return false;
+    }
+
+    m_lock.lock();
+    m_job = job;
+    m_workCond.broadcast();
+
+    etc1_uint32 first, end;
+    while (takeRows(&first,&end)) {
+        m_lock.unlock();
+        Etc1Decoder::decodeBlockRows(job->in,job->out,job->width,job->height,
+                                     job->stride,first,end);
+        m_lock.lock();
+        rowsDone(end - first);
+    }
+    while (job->rowsDone < job->rows) {
+        m_doneCond.wait(m_lock);
+    }
+    m_job = NULL;
+    m_lock.unlock();
+
+    m_busy.unlock();
+    return true;
+}
+
+} // anonymous namespace
+
+void Etc1Decoder::decodeBlockRows(const etc1_byte* pIn, etc1_byte* pOut,
+                                  etc1_uint32 width, etc1_uint32 height,
+                                  etc1_uint32 stride,
+                                  etc1_uint32 firstRow, etc1_uint32 endRow) {
+    etc1_byte block[ETC1_DECODED_BLOCK_SIZE];
+    etc1_uint32 blocksPerRow = (width + 3) / 4;
+
+    pIn += firstRow * blocksPerRow * ETC1_ENCODED_BLOCK_SIZE;
+    for (etc1_uint32 y = firstRow * 4; y < endRow * 4; y += 4) {
+        etc1_uint32 yEnd = height - y;
+        if (yEnd > 4) {
+            yEnd = 4;
+        }
+        for (etc1_uint32 x = 0; x < width; x += 4) {
+            etc1_uint32 xEnd = width - x;
+            if (xEnd > 4) {
+                xEnd = 4;
+            }
+            etc1_decode_block(pIn, block);
+            pIn += ETC1_ENCODED_BLOCK_SIZE;
+            etc1_byte* p = pOut + 3 * x + stride * y;
+            if (xEnd == 4 && yEnd == 4) {
+                memcpy(p, block, 12);
+                memcpy(p + stride, block + 12, 12);
+                memcpy(p + 2 * stride, block + 24, 12);
+                memcpy(p + 3 * stride, block + 36, 12);
+                continue;
+            }
+            for (etc1_uint32 cy = 0; cy < yEnd; cy++) {
+                memcpy(p, block + cy * 4 * 3, xEnd * 3);
+                p += stride;
+            }
+        }
+    }
+}
+
+int Etc1Decoder::decodeRGB(const etc1_byte* pIn, etc1_byte* pOut,
+                           etc1_uint32 width, etc1_uint32 height,
+                           etc1_uint32 stride) {
+    etc1_uint32 rows = (height + 3) / 4;
+
+    if (rows >= MIN_POOL_ROWS) {
+        DecodePool* pool = DecodePool::get();
+        if (pool) {
+            DecodeJob job;
+            job.in = pIn;
+            job.out = pOut;
+            job.width = width;
+            job.height = height;
+            job.stride = stride;
+            job.rows = rows;
+            job.nextRow = 0;
+            job.rowsDone = 0;
+            if (pool->decode(&job)) {
+                return 0;
+            }
+        }
+    }
+
+    decodeBlockRows(pIn, pOut, width, height, stride, 0, rows);
+    return 0;
+}
@@ -114,6 +114,7 @@ void FramebufferData::detachObject(int idx) {
             break;
         case GL_TEXTURE_2D:
             GLEScontext::dispatcher().glDeleteTextures(1, &(m_attachPoints[idx].name));
+            GLESstateFilter::textureNamesChanged();
             break;
         }
     }
@@ -226,6 +226,13 @@ void (GLAPIENTRY *GLDispatch::glTexGenfv) (GLenum coord, GLenum pname, const GLf
 void (GLAPIENTRY *GLDispatch::glTexGeniv) (GLenum coord, GLenum pname, const GLint *params ) = NULL;
 void (GLAPIENTRY *GLDispatch::glGetTexGenfv) (GLenum coord, GLenum pname, GLfloat *params ) = NULL;
 void (GLAPIENTRY *GLDispatch::glGetTexGeniv) (GLenum coord, GLenum pname, GLint *params ) = NULL;
+void (GLAPIENTRY *GLDispatch::glGenProgramsARB) (GLsizei n, GLuint *programs) = NULL;
+void (GLAPIENTRY *GLDispatch::glDeleteProgramsARB) (GLsizei n, const GLuint *programs) = NULL;
+void (GLAPIENTRY *GLDispatch::glBindProgramARB) (GLenum target, GLuint program) = NULL;
+void (GLAPIENTRY *GLDispatch::glProgramStringARB) (GLenum target, GLenum format, GLsizei len, const GLvoid *string) = NULL;
+void (GLAPIENTRY *GLDispatch::glVertexAttribPointerARB) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer) = NULL;
+void (GLAPIENTRY *GLDispatch::glEnableVertexAttribArrayARB) (GLuint index) = NULL;
+void (GLAPIENTRY *GLDispatch::glDisableVertexAttribArrayARB) (GLuint index) = NULL;
 
 /* GLES 2.0*/
 void (GL_APIENTRY *GLDispatch::glBlendColor)(GLclampf,GLclampf,GLclampf,GLclampf) = NULL;
@@ -461,6 +468,13 @@ void GLDispatch::dispatchFuncs(GLESVersion version){
         LOAD_GLEXT_FUNC(glTexGeniv);
         LOAD_GLEXT_FUNC(glGetTexGenfv);
         LOAD_GLEXT_FUNC(glGetTexGeniv);
+        LOAD_GLEXT_FUNC(glGenProgramsARB);
+        LOAD_GLEXT_FUNC(glDeleteProgramsARB);
+        LOAD_GLEXT_FUNC(glBindProgramARB);
+        LOAD_GLEXT_FUNC(glProgramStringARB);
+        LOAD_GLEXT_FUNC(glVertexAttribPointerARB);
+        LOAD_GLEXT_FUNC(glEnableVertexAttribArrayARB);
+        LOAD_GLEXT_FUNC(glDisableVertexAttribArrayARB);
 
     } else if (version == GLES_2_0){
 
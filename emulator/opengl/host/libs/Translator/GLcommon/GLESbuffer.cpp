@@ -39,13 +39,11 @@ bool  GLESbuffer::setSubBuffer(GLint offset,GLuint size,const GLvoid* data) {
     if(offset + size > m_size) return false;
     memcpy(m_data+offset,data,size);
     m_conversionManager.addRange(Range(offset,size));
-    m_conversionManager.merge();
     return true;
 }
 
 void  GLESbuffer::getConversions(const RangeList& rIn,RangeList& rOut) {
         m_conversionManager.delRanges(rIn,rOut);
-        rOut.merge();
 }
 
 GLESbuffer::~GLESbuffer() {
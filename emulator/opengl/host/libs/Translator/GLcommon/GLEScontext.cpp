@@ -22,13 +22,10 @@
 #include <GLcommon/GLESvalidate.h>
 #include <GLcommon/TextureUtils.h>
 #include <GLcommon/FramebufferData.h>
+#include <GLcommon/VertexConversion.h>
 #include <strings.h>
-
-//decleration
-static void convertFixedDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize);
-static void convertFixedIndirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,GLsizei count,GLenum indices_type,const GLvoid* indices,unsigned int strideOut,int attribSize);
-static void convertByteDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize);
-static void convertByteIndirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,GLsizei count,GLenum indices_type,const GLvoid* indices,unsigned int strideOut,int attribSize);
+#include <algorithm>
+#include <vector>
 
 GLESConversionArrays::~GLESConversionArrays() {
     for(std::map<GLenum,ArrayData>::iterator it = m_arrays.begin(); it != m_arrays.end();it++) {
@@ -213,55 +210,6 @@ const GLESpointer* GLEScontext::getPointer(GLenum arrType) {
     return NULL;
 }
 
-static void convertFixedDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize) {
-
-    for(unsigned int i = 0; i < nBytes;i+=strideOut) {
-        const GLfixed* fixed_data = (const GLfixed *)dataIn;
-        //filling attrib
-        for(int j=0;j<attribSize;j++) {
-            reinterpret_cast<GLfloat*>(&static_cast<unsigned char*>(dataOut)[i])[j] = X2F(fixed_data[j]);
-        }
-        dataIn += strideIn;
-    }
-}
-
-static void convertFixedIndirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,GLsizei count,GLenum indices_type,const GLvoid* indices,unsigned int strideOut,int attribSize) {
-    for(int i = 0 ;i < count ;i++) {
-        unsigned short index = indices_type == GL_UNSIGNED_BYTE? ((GLubyte *)indices)[i]:
-                                                             ((GLushort *)indices)[i];
-        const GLfixed* fixed_data = (GLfixed *)(dataIn  + index*strideIn);
-        GLfloat* float_data = reinterpret_cast<GLfloat*>(static_cast<unsigned char*>(dataOut) + index*strideOut);
-
-        for(int j=0;j<attribSize;j++) {
-            float_data[j] = X2F(fixed_data[j]);
-         }
-    }
-}
-
-static void convertByteDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize) {
-
-    for(unsigned int i = 0; i < nBytes;i+=strideOut) {
-        const GLbyte* byte_data = (const GLbyte *)dataIn;
-        //filling attrib
-        for(int j=0;j<attribSize;j++) {
-            reinterpret_cast<GLshort*>(&static_cast<unsigned char*>(dataOut)[i])[j] = B2S(byte_data[j]);
-        }
-        dataIn += strideIn;
-    }
-}
-
-static void convertByteIndirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,GLsizei count,GLenum indices_type,const GLvoid* indices,unsigned int strideOut,int attribSize) {
-    for(int i = 0 ;i < count ;i++) {
-        unsigned short index = indices_type == GL_UNSIGNED_BYTE? ((GLubyte *)indices)[i]:
-                                                             ((GLushort *)indices)[i];
-        const GLbyte* bytes_data = (GLbyte *)(dataIn  + index*strideIn);
-        GLshort* short_data = reinterpret_cast<GLshort*>(static_cast<unsigned char*>(dataOut) + index*strideOut);
-
-        for(int j=0;j<attribSize;j++) {
-            short_data[j] = B2S(bytes_data[j]);
-         }
-    }
-}
 static void directToBytesRanges(GLint first,GLsizei count,GLESpointer* p,RangeList& list) {
 
     int attribSize = p->getSize()*4; //4 is the sizeof GLfixed or GLfloat in bytes
@@ -281,12 +229,19 @@ static void indirectToBytesRanges(const GLvoid* indices,GLenum indices_type,GLsi
     int attribSize = p->getSize() * 4; //4 is the sizeof GLfixed or GLfloat in bytes
     int stride = p->getStride()?p->getStride():attribSize;
     int start  = p->getBufferOffset();
+
+    // each index once and in ascending order, so that the ranges are appended
+    std::vector<GLushort> sorted(count);
     for(int i=0 ; i < count; i++) {
-        GLushort index = (indices_type == GL_UNSIGNED_SHORT?
-                         static_cast<const GLushort*>(indices)[i]:
-                         static_cast<const GLubyte*>(indices)[i]);
-        list.addRange(Range(start+index*stride,attribSize));
+        sorted[i] = (indices_type == GL_UNSIGNED_SHORT?
+                    static_cast<const GLushort*>(indices)[i]:
+                    static_cast<const GLubyte*>(indices)[i]);
+    }
+    std::sort(sorted.begin(),sorted.end());
+    sorted.erase(std::unique(sorted.begin(),sorted.end()),sorted.end());
 
+    for(unsigned int i=0 ; i < sorted.size(); i++) {
+        list.addRange(Range(start+sorted[i]*stride,attribSize));
     }
 }
 
@@ -313,15 +268,13 @@ void GLEScontext::convertDirect(GLESConversionArrays& cArrs,GLint first,GLsizei
     int attribSize = p->getSize();
     unsigned int size = attribSize*count + first;
     unsigned int bytes = type == GL_FIXED ? sizeof(GLfixed):sizeof(GLbyte);
-    cArrs.allocArr(size,type);
     int stride = p->getStride()?p->getStride():bytes*attribSize;
     const char* data = (const char*)p->getArrayData() + (first*stride);
+    unsigned int nElements = (size + attribSize - 1) / attribSize;
 
-    if(type == GL_FIXED) {
-        convertFixedDirectLoop(data,stride,cArrs.getCurrentData(),size*sizeof(GLfloat),attribSize*sizeof(GLfloat),attribSize);
-    } else if(type == GL_BYTE) {
-        convertByteDirectLoop(data,stride,cArrs.getCurrentData(),size*sizeof(GLshort),attribSize*sizeof(GLshort),attribSize);
-    }
+    void* converted = p->conversionCache().convert(data,stride,type,attribSize,nElements);
+    if(!converted) cArrs.setFailed();
+    cArrs.setArr(converted,0,type == GL_FIXED ? GL_FLOAT : GL_SHORT);
 }
 
 void GLEScontext::convertDirectVBO(GLESConversionArrays& cArrs,GLint first,GLsizei count,GLenum array_id,GLESpointer* p) {
@@ -342,7 +295,7 @@ void GLEScontext::convertDirectVBO(GLESConversionArrays& cArrs,GLint first,GLsiz
         if(conversions.size()) { // there are some elements to convert
            indices = new GLushort[count];
            int nIndices = bytesRangesToIndices(conversions,p,indices); //converting bytes ranges by offset to indices in this array
-           convertFixedIndirectLoop(data,stride,data,nIndices,GL_UNSIGNED_SHORT,indices,stride,attribSize);
+           convertFixedToFloatIndexed(data,stride,data,stride,nIndices,GL_UNSIGNED_SHORT,indices,attribSize);
         }
     }
     if(indices) delete[] indices;
@@ -368,20 +321,20 @@ int GLEScontext::findMaxIndex(GLsizei count,GLenum type,const GLvoid* indices) {
 
 void GLEScontext::convertIndirect(GLESConversionArrays& cArrs,GLsizei count,GLenum indices_type,const GLvoid* indices,GLenum array_id,GLESpointer* p) {
     GLenum type    = p->getType();
-    int maxElements = findMaxIndex(count,type,indices) + 1;
+    int maxElements = findMaxIndex(count,indices_type,indices) + 1;
 
     int attribSize = p->getSize();
-    int size = attribSize * maxElements;
     unsigned int bytes = type == GL_FIXED ? sizeof(GLfixed):sizeof(GLbyte);
-    cArrs.allocArr(size,type);
     int stride = p->getStride()?p->getStride():bytes*attribSize;
 
+    //
+    // all the elements up to the largest index are converted, so that
+    // the conversion does not depend on the indices and can be reused
+    //
     const char* data = (const char*)p->getArrayData();
-    if(type == GL_FIXED) {
-        convertFixedIndirectLoop(data,stride,cArrs.getCurrentData(),count,indices_type,indices,attribSize*sizeof(GLfloat),attribSize);
-    } else if(type == GL_BYTE){
-        convertByteIndirectLoop(data,stride,cArrs.getCurrentData(),count,indices_type,indices,attribSize*sizeof(GLshort),attribSize);
-    }
+    void* converted = p->conversionCache().convert(data,stride,type,attribSize,maxElements);
+    if(!converted) cArrs.setFailed();
+    cArrs.setArr(converted,0,type == GL_FIXED ? GL_FLOAT : GL_SHORT);
 }
 
 void GLEScontext::convertIndirectVBO(GLESConversionArrays& cArrs,GLsizei count,GLenum indices_type,const GLvoid* indices,GLenum array_id,GLESpointer* p) {
@@ -398,7 +351,7 @@ void GLEScontext::convertIndirectVBO(GLESConversionArrays& cArrs,GLsizei count,G
         if(conversions.size()) { // there are some elements to convert
             conversionIndices = new GLushort[count];
             int nIndices = bytesRangesToIndices(conversions,p,conversionIndices); //converting bytes ranges by offset to indices in this array
-            convertFixedIndirectLoop(data,stride,data,nIndices,GL_UNSIGNED_SHORT,conversionIndices,stride,attribSize);
+            convertFixedToFloatIndexed(data,stride,data,stride,nIndices,GL_UNSIGNED_SHORT,conversionIndices,attribSize);
         }
     }
     if(conversionIndices) delete[] conversionIndices;
@@ -555,6 +508,9 @@ void GLEScontext::initCapsLocked(const GLubyte * extensionString)
     if (strstr(cstring,"GL_OES_standard_derivatives ")!=NULL)
         s_glSupport.GL_OES_STANDARD_DERIVATIVES = true;
 
+    if (strstr(cstring,"GL_ARB_vertex_program ")!=NULL)
+        s_glSupport.GL_ARB_VERTEX_PROGRAM = true;
+
 }
 
 void GLEScontext::buildStrings(const char* baseVendor,
@@ -0,0 +1,170 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <GLcommon/GLESstateFilter.h>
+#include <GLES/glext.h>
+#include <cutils/atomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+volatile int32_t GLESstateFilter::s_textureEpoch = 0;
+
+static const char* s_callNames[GLESstateFilter::NUM_CALLS] = {
+    "glEnable/glDisable",
+    "glBindTexture",
+    "glBlendFunc",
+    "glUseProgram",
+    "glTexEnv"
+};
+
+GLESstateFilter::GLESstateFilter():m_enabled(getenv("ANDROID_GLES_NO_STATE_FILTER") == NULL),
+                                   m_printStats(getenv("ANDROID_GLES_STATE_FILTER_STATS") != NULL),
+                                   m_blendValid(false),
+                                   m_blendSrc(0),
+                                   m_blendDst(0),
+                                   m_programValid(false),
+                                   m_program(0) {
+    memset(m_calls,0,sizeof(m_calls));
+    memset(m_dropped,0,sizeof(m_dropped));
+}
+
+GLESstateFilter::~GLESstateFilter() {
+    if(!m_printStats) return;
+
+    fprintf(stderr,"GLES state filter%s:\n",m_enabled ? "" : " (disabled)");
+    for(int i = 0; i < NUM_CALLS; i++) {
+        fprintf(stderr,"    %-20s %10u calls %10u dropped\n",
+                s_callNames[i],m_calls[i],m_dropped[i]);
+    }
+}
+
+void GLESstateFilter::textureNamesChanged() {
+    android_atomic_inc(&s_textureEpoch);
+}
+
+//
+// Only the capabilities GLES defines are shadowed, so that an invalid
+// one keeps reaching the host and raising its error. The texture ones
+// are per texture unit.
+//
+static bool capKey(GLenum cap,unsigned int unit,unsigned int* key) {
+    if(cap >= GL_LIGHT0 && cap < GL_LIGHT0 + 8) {
+        *key = cap;
+        return true;
+    }
+    if(cap >= GL_CLIP_PLANE0 && cap < GL_CLIP_PLANE0 + 6) {
+        *key = cap;
+        return true;
+    }
+    switch(cap) {
+    case GL_TEXTURE_2D:
+    case GL_TEXTURE_CUBE_MAP_OES:
+        *key = cap | (unit << 16);
+        return true;
+    case GL_ALPHA_TEST:
+    case GL_BLEND:
+    case GL_COLOR_LOGIC_OP:
+    case GL_COLOR_MATERIAL:
+    case GL_CULL_FACE:
+    case GL_DEPTH_TEST:
+    case GL_DITHER:
+    case GL_FOG:
+    case GL_LIGHTING:
+    case GL_LINE_SMOOTH:
+    case GL_MULTISAMPLE:
+    case GL_NORMALIZE:
+    case GL_POINT_SMOOTH:
+    case GL_POLYGON_OFFSET_FILL:
+    case GL_RESCALE_NORMAL:
+    case GL_SAMPLE_ALPHA_TO_COVERAGE:
+    case GL_SAMPLE_ALPHA_TO_ONE:
+    case GL_SAMPLE_COVERAGE:
+    case GL_SCISSOR_TEST:
+    case GL_STENCIL_TEST:
+        *key = cap;
+        return true;
+    }
+    return false;
+}
+
+bool GLESstateFilter::enable(GLenum cap,unsigned int unit,bool enable) {
+    unsigned int key;
+    if(!capKey(cap,unit,&key)) {
+        m_calls[ENABLE]++;
+        return false;
+    }
+
+    std::map<unsigned int,bool>::iterator it = m_caps.find(key);
+    bool same = it != m_caps.end() && (*it).second == enable;
+    if(check(ENABLE,same)) return true;
+
+    m_caps[key] = enable;
+    return false;
+}
+
+bool GLESstateFilter::bindTexture(unsigned int unit,GLenum target,GLuint globalName) {
+    unsigned int index = unit * 2 + (target == GL_TEXTURE_CUBE_MAP_OES ? 1 : 0);
+    if(index >= m_textures.size()) {
+        m_textures.resize(index + 1);
+    }
+
+    TextureBinding& b = m_textures[index];
+    int32_t epoch = s_textureEpoch;
+    bool same = b.valid && b.epoch == epoch && b.name == globalName;
+    if(check(BIND_TEXTURE,same)) return true;
+
+    b.name = globalName;
+    b.epoch = epoch;
+    b.valid = true;
+    return false;
+}
+
+bool GLESstateFilter::blendFunc(GLenum sfactor,GLenum dfactor) {
+    bool same = m_blendValid && m_blendSrc == sfactor && m_blendDst == dfactor;
+    if(check(BLEND_FUNC,same)) return true;
+
+    m_blendSrc = sfactor;
+    m_blendDst = dfactor;
+    m_blendValid = true;
+    return false;
+}
+
+bool GLESstateFilter::useProgram(GLuint globalName) {
+    bool same = m_programValid && m_program == globalName;
+    if(check(USE_PROGRAM,same)) return true;
+
+    m_program = globalName;
+    m_programValid = true;
+    return false;
+}
+
+static uint64_t texEnvKey(unsigned int unit,GLenum target,GLenum pname) {
+    return ((uint64_t)unit << 32) | ((uint64_t)(target & 0xffff) << 16) | (pname & 0xffff);
+}
+
+bool GLESstateFilter::texEnv(unsigned int unit,GLenum target,GLenum pname,GLfloat param) {
+    uint64_t key = texEnvKey(unit,target,pname);
+    std::map<uint64_t,GLfloat>::iterator it = m_texEnv.find(key);
+    bool same = it != m_texEnv.end() && (*it).second == param;
+    if(check(TEX_ENV,same)) return true;
+
+    m_texEnv[key] = param;
+    return false;
+}
+
+void GLESstateFilter::forgetTexEnv(unsigned int unit,GLenum target,GLenum pname) {
+    m_texEnv.erase(texEnvKey(unit,target,pname));
+}
@@ -15,17 +15,7 @@
 */
 #include "GLcommon/PaletteTexture.h"
 #include <stdio.h>
-
-
-
-struct Color
-{
-  Color(unsigned char r, unsigned char g,unsigned char b, unsigned char a):red(r),green(g),blue(b),alpha(a){};
-  unsigned char red;
-  unsigned char green;
-  unsigned char blue;
-  unsigned char alpha;
-};
+#include <string.h>
 
 void getPaletteInfo(GLenum internalFormat,unsigned int& indexSizeBits,unsigned int& colorSizeBytes,GLenum& colorFrmt) {
 
@@ -75,96 +65,198 @@ void getPaletteInfo(GLenum internalFormat,unsigned int& indexSizeBits,unsigned i
 }
 
 
-Color paletteColor(const unsigned char* pallete,unsigned int index,GLenum format)
+//
+// Expands the nColors palette entries to RGBA8, RGB entries get an
+// alpha of 255.
+//
+static void expandPalette(const unsigned char* palette,int nColors,GLenum format,unsigned char* lut)
 {
-        short s;
+    for(int i = 0; i < nColors; i++, lut += 4) {
+        const unsigned char* c;
+        unsigned short s;
         switch(format) {
-        //RGB
-    case GL_PALETTE4_RGB8_OES:
-    case GL_PALETTE8_RGB8_OES:
-            return Color(pallete[index],pallete[index+1],pallete[index+2],0);
-    case GL_PALETTE8_R5_G6_B5_OES:
-    case GL_PALETTE4_R5_G6_B5_OES:
-            s = *((short *)(pallete+index));
-            return Color((s >> 11)*255/31,((s >> 5) & 0x3f)*255/63 ,(s & 0x1f)*255/31,0);
+        case GL_PALETTE4_RGB8_OES:
+        case GL_PALETTE8_RGB8_OES:
+            c = palette + i * 3;
+            lut[0] = c[0];
+            lut[1] = c[1];
+            lut[2] = c[2];
+            lut[3] = 255;
+            break;
+        case GL_PALETTE4_RGBA8_OES:
+        case GL_PALETTE8_RGBA8_OES:
+            memcpy(lut,palette + i * 4,4);
+            break;
+        case GL_PALETTE4_R5_G6_B5_OES:
+        case GL_PALETTE8_R5_G6_B5_OES:
+            memcpy(&s,palette + i * 2,2);
+            lut[0] = (s >> 11) * 255 / 31;
+            lut[1] = ((s >> 5) & 0x3f) * 255 / 63;
+            lut[2] = (s & 0x1f) * 255 / 31;
+            lut[3] = 255;
+            break;
+        case GL_PALETTE4_RGBA4_OES:
+        case GL_PALETTE8_RGBA4_OES:
+            memcpy(&s,palette + i * 2,2);
+            lut[0] = ((s >> 12) & 0xf) * 255 / 15;
+            lut[1] = ((s >> 8) & 0xf) * 255 / 15;
+            lut[2] = ((s >> 4) & 0xf) * 255 / 15;
+            lut[3] = (s & 0xf) * 255 / 15;
+            break;
+        case GL_PALETTE4_RGB5_A1_OES:
+        case GL_PALETTE8_RGB5_A1_OES:
+            memcpy(&s,palette + i * 2,2);
+            lut[0] = ((s >> 11) & 0x1f) * 255 / 31;
+            lut[1] = ((s >> 6) & 0x1f) * 255 / 31;
+            lut[2] = ((s >> 1) & 0x1f) * 255 / 31;
+            lut[3] = (s & 0x1) * 255;
+            break;
+        }
+    }
+}
 
-        //RGBA
-    case GL_PALETTE4_RGBA8_OES:
-    case GL_PALETTE8_RGBA8_OES:
-            return Color(pallete[index],pallete[index+1],pallete[index+2],pallete[index+3]);
-    case GL_PALETTE4_RGBA4_OES:
-    case GL_PALETTE8_RGBA4_OES:
-            s = *((short *)(pallete+index));
-            return Color(((s >> 12) & 0xf)*255/15,((s >> 8) & 0xf)*255/15,((s >> 4) & 0xf)*255/15 ,(s & 0xf)*255/15);
-    case GL_PALETTE4_RGB5_A1_OES:
-    case GL_PALETTE8_RGB5_A1_OES:
-            s = *((short *)(pallete+index));
-            return Color(((s >> 11) & 0x1f)*255/31,((s >> 6) & 0x1f)*255/31,((s >> 1) & 0x1f)*255/31 ,(s & 0x1) * 255);
-        default:
-            return Color(255,255,255,255);
+//
+// The indices of a level are packed without any row padding, two per
+// byte high nibble first for the 4 bit formats, and each level starts
+// on a byte.
+//
+static size_t levelIndexBytes(GLsizei width,GLsizei height,unsigned int indexSizeBits)
+{
+    return ((size_t)width * height * indexSizeBits + 7) / 8;
+}
+
+//
+// PALETTE8, one byte per texel.
+//
+template <int nComps>
+static void expandLevel8(const unsigned char* indices,GLsizei width,GLsizei height,
+                         const unsigned char* lut,unsigned char* out,size_t rowBytes)
+{
+    for(GLsizei y = 0; y < height; y++) {
+        unsigned char* p = out + y * rowBytes;
+        for(GLsizei x = 0; x < width; x++, p += nComps) {
+            memcpy(p,lut + 4 * *indices++,nComps);
+        }
+    }
+}
+
+//
+// PALETTE4, two texels per byte taken at once from a table of the 256
+// possible texel pairs. A row starts in the middle of a byte when the
+// width is odd.
+//
+template <int nComps>
+static void expandLevel4(const unsigned char* indices,GLsizei width,GLsizei height,
+                         const unsigned char* pairs,unsigned char* out,size_t rowBytes)
+{
+    size_t texel = 0;
+    for(GLsizei y = 0; y < height; y++) {
+        unsigned char* p = out + y * rowBytes;
+        const unsigned char* in = indices + texel / 2;
+        GLsizei x = 0;
+        if(texel & 1) {
+            memcpy(p,pairs + 8 * *in++ + 4,nComps);
+            p += nComps;
+            x++;
+        }
+        for(; x + 1 < width; x += 2, p += 2 * nComps) {
+            const unsigned char* pair = pairs + 8 * *in++;
+            if(nComps == 4) {
+                memcpy(p,pair,8);
+            } else {
+                memcpy(p,pair,3);
+                memcpy(p + 3,pair + 4,3);
+            }
+        }
+        if(x < width) {
+            memcpy(p,pairs + 8 * *in,nComps);
+        }
+        texel += width;
     }
 }
 
-unsigned char* uncompressTexture(GLenum internalformat,GLenum& formatOut,GLsizei width,GLsizei height,GLsizei imageSize, const GLvoid* data,GLint level) {
+unsigned char* uncompressTexture(GLenum internalformat,GLenum& formatOut,
+                                 GLsizei width,GLsizei height,
+                                 GLsizei imageSize,const GLvoid* data,
+                                 GLint firstLevel,GLint nLevels,
+                                 GLint unpackAlignment,size_t* offsets) {
 
-    unsigned int indexSizeBits;  //the size of the color index in the pallete
-    unsigned int colorSizeBytes; //the size of each color cell in the pallete
+    unsigned int indexSizeBits = 0;  //the size of the color index in the pallete
+    unsigned int colorSizeBytes = 0; //the size of each color cell in the pallete
 
     getPaletteInfo(internalformat,indexSizeBits,colorSizeBytes,formatOut);
-    if(!data)
+    if(!data || !indexSizeBits || nLevels < 1)
     {
         return NULL;
     }
+    if(unpackAlignment < 1) unpackAlignment = 1;
 
     const unsigned char* palette = static_cast<const unsigned char *>(data);
 
     //the pallete positioned in the begininng of the data
     // so we jump over it to get to the colos indices in the palette
 
-    int nColors = 2 << (indexSizeBits -1); //2^indexSizeBits
-    int paletteSizeBytes = nColors*colorSizeBytes;
+    int nColors = 1 << indexSizeBits;
+    size_t paletteSizeBytes = nColors*colorSizeBytes;
     const unsigned char* imageIndices =  palette + paletteSizeBytes;
 
-    //jumping to the the correct mipmap level
-    for(int i=0;i<level;i++) {
-        imageIndices+= (width*height*indexSizeBits)/8;
-        width  = width  >> 1;
-        height = height >> 1;
+    //jumping to the the first level
+    for(int i=0;i<firstLevel;i++) {
+        imageIndices+= levelIndexBytes(width,height,indexSizeBits);
+        width  = width  > 1 ? width  >> 1 : 1;
+        height = height > 1 ? height >> 1 : 1;
     }
 
+    //the data needed and the space taken by the levels
     int colorSizeOut = (formatOut == GL_RGB? 3:4);
-    int nPixels = width*height;
-    unsigned char* pixelsOut = new unsigned char[nPixels*colorSizeOut];
-    if(!pixelsOut) return NULL;
+    size_t indexBytes = imageIndices - palette;
+    size_t outBytes = 0;
+    GLsizei w = width, h = height;
+    for(int i = 0; i < nLevels; i++) {
+        size_t rowBytes = (w * colorSizeOut + unpackAlignment - 1) & ~(size_t)(unpackAlignment - 1);
+        offsets[i] = outBytes;
+        outBytes += rowBytes * h;
+        indexBytes += levelIndexBytes(w,h,indexSizeBits);
+        w = w > 1 ? w >> 1 : 1;
+        h = h > 1 ? h >> 1 : 1;
+    }
+    if(imageSize < 0 || indexBytes > (size_t)imageSize) {
+        return NULL;
+    }
 
-    int leftBytes = ((palette + imageSize) /* the end of data pointer*/
-                      - imageIndices);
-    int leftPixels = (leftBytes * 8 )/indexSizeBits;
+    unsigned char* pixelsOut = new unsigned char[outBytes];
+    if(!pixelsOut) return NULL;
 
-    int maxIndices = (leftPixels < nPixels) ? leftPixels:nPixels;
+    //the palette as RGBA8, for PALETTE4 as the 256 texel pairs a byte holds
+    unsigned char lut[256 * 4];
+    unsigned char pairs[256 * 8];
+    expandPalette(palette,nColors,internalformat,lut);
+    if(indexSizeBits == 4) {
+        for(int i = 0; i < 256; i++) {
+            memcpy(pairs + 8 * i,lut + 4 * (i >> 4),4);
+            memcpy(pairs + 8 * i + 4,lut + 4 * (i & 0xf),4);
+        }
+    }
 
-    //filling the pixels array
-    for(int i =0 ; i < maxIndices ; i++) {
-        int paletteIndex = 0;
-        int indexOut = i*colorSizeOut;
+    for(int i = 0; i < nLevels; i++) {
+        unsigned char* out = pixelsOut + offsets[i];
+        size_t rowBytes = (width * colorSizeOut + unpackAlignment - 1) & ~(size_t)(unpackAlignment - 1);
         if(indexSizeBits == 4) {
-            paletteIndex = (i%2) == 0 ?
-                           imageIndices[i/2] >> 4:  //upper bits
-                           imageIndices[i/2] & 0xf; //lower bits
+            if(colorSizeOut == 4) {
+                expandLevel4<4>(imageIndices,width,height,pairs,out,rowBytes);
+            } else {
+                expandLevel4<3>(imageIndices,width,height,pairs,out,rowBytes);
+            }
         } else {
-            paletteIndex = imageIndices[i];
-        }
-
-        paletteIndex*=colorSizeBytes;
-        Color c = paletteColor(palette,paletteIndex,internalformat);
-
-        pixelsOut[indexOut] = c.red;
-        pixelsOut[indexOut+1] = c.green;
-        pixelsOut[indexOut+2] = c.blue;
-        if(formatOut == GL_RGBA) {
-            pixelsOut[indexOut+3] = c.alpha;
+            if(colorSizeOut == 4) {
+                expandLevel8<4>(imageIndices,width,height,lut,out,rowBytes);
+            } else {
+                expandLevel8<3>(imageIndices,width,height,lut,out,rowBytes);
+            }
         }
+        imageIndices += levelIndexBytes(width,height,indexSizeBits);
+        width  = width  > 1 ? width  >> 1 : 1;
+        height = height > 1 ? height >> 1 : 1;
     }
     return pixelsOut;
 }
-
@@ -35,13 +35,53 @@ bool Range::rangeUnion(const Range& r,Range& rOut) const {
     int size =  max_end - min_start;
     if(size) {
         rOut.setRange(min_start,max_end-min_start);
-        return false;
+        return true;
     }
     return false;
 }
 
+unsigned int RangeList::findEnd(int pos,bool strict) const {
+    unsigned int lo = 0;
+    unsigned int hi = list.size();
+    while(lo < hi) {
+        unsigned int mid = (lo + hi) / 2;
+        int end = list[mid].getEnd();
+        if(end < pos || (strict && end == pos)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
 void RangeList::addRange(const Range& r) {
-    list.push_back(r);
+    if(r.getSize() <= 0) return;
+
+    int start = r.getStart();
+    int end   = r.getEnd();
+
+    // past the last range, the common case
+    if(list.empty() || list.back().getEnd() < start) {
+        list.push_back(r);
+        return;
+    }
+
+    // coalesce with every range overlapping or touching r
+    unsigned int i = findEnd(start,false);
+    unsigned int j = i;
+    while(j < list.size() && list[j].getStart() <= end) {
+        if(list[j].getStart() < start) start = list[j].getStart();
+        if(list[j].getEnd() > end) end = list[j].getEnd();
+        j++;
+    }
+
+    if(i == j) {
+        list.insert(list.begin() + i,r);
+    } else {
+        list[i].setRange(start,end - start);
+        list.erase(list.begin() + i + 1,list.begin() + j);
+    }
 }
 
 void RangeList::addRanges(const RangeList& rl) {
@@ -67,60 +107,38 @@ void RangeList::clear() {
     return list.clear();
 }
 
-void RangeList::erase(unsigned int i) {
-    if(i > list.size()) return;
-    list.erase(list.begin() +i);
-}
-
 void RangeList::delRange(const Range& r,RangeList& deleted) {
-    if(r.getSize() == 0) return;
-
-    Range intersection;
-    Range temp;
-    // compare new rect to each and any of the rects on the list
-    for (int i=0;i<(int)list.size();i++) { // i must be signed for i-- below
-     // if there is intersection
-     if (r.rangeIntersection(list[i],intersection)) {
-             Range old=list[i];
-         // remove old as it is about to be split
-         erase(i);
-         i--;
-         if (intersection!=old) { // otherwise split:
-             //intersection on right side
-             if(old.getStart() != intersection.getStart()) {
-                 list.insert(list.begin(),Range(old.getStart(),intersection.getStart() - old.getStart()));
-             }
-
-             //intersection on left side
-             if(old.getEnd() != intersection.getEnd()) {
-                 list.insert(list.begin(),Range(intersection.getEnd(),old.getEnd() - intersection.getEnd()));
-             }
-         }
-         deleted.addRange(intersection);
-     }
- }
-}
+    if(r.getSize() <= 0) return;
+
+    int start = r.getStart();
+    int end   = r.getEnd();
 
-void RangeList::merge() {
-    if(list.empty()) return;
-
-    Range temp;
-    bool changed;
-
-    do { // re-run if changed in last run
-        changed=0;
-        // run for each combinations of two rects in the list
-        for (int i=0;i<(((int)list.size())-1) && !changed ;i++)
-        {
-            for (int j=i+1;j<(int)list.size() && !changed ;j++)
-            {
-               if (list[i].rangeUnion(list[j],temp)) {
-                    // are them exactly one on left of the other
-                    list[i] = temp;
-                    erase(j);
-                    changed=1;
-               }
-            }
+    // ranges overlapping r are [i,j)
+    unsigned int i = findEnd(start,true);
+    unsigned int j = i;
+    while(j < list.size() && list[j].getStart() < end) {
+        Range intersection;
+        if(r.rangeIntersection(list[j],intersection)) {
+            deleted.addRange(intersection);
         }
-    } while (changed);
+        j++;
+    }
+    if(i == j) return;
+
+    // only the first and the last of them can stick out of r
+    Range left(list[i].getStart(),start - list[i].getStart());
+    Range right(end,list[j-1].getEnd() - end);
+
+    unsigned int n = i;
+    if(left.getSize() > 0) list[n++] = left;
+    if(right.getSize() > 0) {
+        if(n < j) {
+            list[n++] = right;
+        } else {
+            // r was inside a single range, which is split in two
+            list.insert(list.begin() + n,right);
+            return;
+        }
+    }
+    list.erase(list.begin() + n,list.begin() + j);
 }
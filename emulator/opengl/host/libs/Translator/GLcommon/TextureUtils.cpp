@@ -14,6 +14,7 @@
 * limitations under the License.
 */
 #include <GLcommon/TextureUtils.h>
+#include <GLcommon/Etc1Decoder.h>
 #include <GLcommon/GLESmacros.h>
 #include <GLcommon/GLDispatch.h>
 #include <GLcommon/GLESvalidate.h>
@@ -64,7 +65,7 @@ void  doCompressedTexImage2D(GLEScontext * ctx, GLenum target, GLint level,
                 const size_t size = bpr * height;
 
                 etc1_byte* pOut = new etc1_byte[size];
-                int res = etc1_decode_image((const etc1_byte*)data, pOut, width, height, 3, bpr);
+                int res = Etc1Decoder::decodeRGB((const etc1_byte*)data, pOut, width, height, bpr);
                 SET_ERROR_IF(res!=0, GL_INVALID_VALUE);
                 glTexImage2DPtr(target,level,format,width,height,border,format,type,pOut);
                 delete [] pOut;
@@ -83,22 +84,28 @@ void  doCompressedTexImage2D(GLEScontext * ctx, GLenum target, GLint level,
         case GL_PALETTE8_RGB5_A1_OES:
             {
                 SET_ERROR_IF(level > log2(ctx->getMaxTexSize()) || 
+                             -level > log2(ctx->getMaxTexSize()) ||
                              border !=0 || level > 0 || 
                              !GLESvalidate::texImgDim(width,height,ctx->getMaxTexSize()+2),GL_INVALID_VALUE)
 
+                // all the levels are expanded at once, -level is the last one
                 int nMipmaps = -level + 1;
+                size_t offsets[32];
+                GLenum uncompressedFrmt;
+                unsigned char* uncompressed = uncompressTexture(internalformat,uncompressedFrmt,
+                                                                width,height,imageSize,data,
+                                                                0,nMipmaps,ctx->getUnpackAlignment(),offsets);
+                SET_ERROR_IF(!uncompressed,GL_INVALID_VALUE);
+
                 GLsizei tmpWidth  = width;
                 GLsizei tmpHeight = height;
-
                 for(int i = 0; i < nMipmaps ; i++)
                 {
-                   GLenum uncompressedFrmt;
-                   unsigned char* uncompressed = uncompressTexture(internalformat,uncompressedFrmt,width,height,imageSize,data,i);
-                   glTexImage2DPtr(target,i,uncompressedFrmt,tmpWidth,tmpHeight,border,uncompressedFrmt,GL_UNSIGNED_BYTE,uncompressed);
-                   tmpWidth/=2;
-                   tmpHeight/=2;
-                   delete[] uncompressed;
+                   glTexImage2DPtr(target,i,uncompressedFrmt,tmpWidth,tmpHeight,border,uncompressedFrmt,GL_UNSIGNED_BYTE,uncompressed + offsets[i]);
+                   tmpWidth  = tmpWidth  > 1 ? tmpWidth  / 2 : 1;
+                   tmpHeight = tmpHeight > 1 ? tmpHeight / 2 : 1;
                 }
+                delete[] uncompressed;
             }
             break;
 
@@ -0,0 +1,633 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <GLcommon/VertexConversion.h>
+#include <GLcommon/GLconversion_macros.h>
+#include <string.h>
+
+//
+// The vector kernels are built with per function target attributes, so
+// that the rest of the library keeps the default compiler flags and the
+// kernels are only called once the CPU is known to support them.
+//
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#include <cpuid.h>
+#define SSE2_FUNC __attribute__((target("sse2")))
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+
+typedef void (*DirectFunc)(const char* dataIn, unsigned int strideIn,
+                           char* dataOut, unsigned int strideOut,
+                           unsigned int count, int attribSize);
+typedef void (*IndexedFunc)(const char* dataIn, unsigned int strideIn,
+                            char* dataOut, unsigned int strideOut,
+                            GLsizei count, GLenum indicesType,
+                            const GLvoid* indices, int attribSize);
+
+struct ConversionFuncs {
+    DirectFunc fixedDirect;
+    DirectFunc byteDirect;
+    IndexedFunc fixedIndexed;
+    IndexedFunc byteIndexed;
+};
+
+//
+// Scalar implementation, also used for the sizes without a vector kernel
+//
+
+template <int N>
+static inline void fixedElem(const char* in, char* out) {
+    const GLfixed* s = reinterpret_cast<const GLfixed*>(in);
+    GLfloat* d = reinterpret_cast<GLfloat*>(out);
+    for (int j = 0; j < N; j++) {
+        d[j] = X2F(s[j]);
+    }
+}
+
+template <int N>
+static inline void byteElem(const char* in, char* out) {
+    const GLbyte* s = reinterpret_cast<const GLbyte*>(in);
+    GLshort* d = reinterpret_cast<GLshort*>(out);
+    for (int j = 0; j < N; j++) {
+        d[j] = B2S(s[j]);
+    }
+}
+
+static void fixedDirectGeneric(const char* in, unsigned int strideIn,
+                               char* out, unsigned int strideOut,
+                               unsigned int count, int attribSize) {
+    for (unsigned int i = 0; i < count; i++) {
+        const GLfixed* s = reinterpret_cast<const GLfixed*>(in);
+        GLfloat* d = reinterpret_cast<GLfloat*>(out);
+        for (int j = 0; j < attribSize; j++) {
+            d[j] = X2F(s[j]);
+        }
+        in += strideIn;
+        out += strideOut;
+    }
+}
+
+static void byteDirectGeneric(const char* in, unsigned int strideIn,
+                              char* out, unsigned int strideOut,
+                              unsigned int count, int attribSize) {
+    for (unsigned int i = 0; i < count; i++) {
+        const GLbyte* s = reinterpret_cast<const GLbyte*>(in);
+        GLshort* d = reinterpret_cast<GLshort*>(out);
+        for (int j = 0; j < attribSize; j++) {
+            d[j] = B2S(s[j]);
+        }
+        in += strideIn;
+        out += strideOut;
+    }
+}
+
+template <class IndexT>
+static void fixedIndexedGeneric(const char* in, unsigned int strideIn,
+                                char* out, unsigned int strideOut,
+                                GLsizei count, const IndexT* indices,
+                                int attribSize) {
+    for (GLsizei i = 0; i < count; i++) {
+        unsigned int index = indices[i];
+        fixedDirectGeneric(in + index * strideIn, 0, out + index * strideOut, 0,
+                           1, attribSize);
+    }
+}
+
+template <class IndexT>
+static void byteIndexedGeneric(const char* in, unsigned int strideIn,
+                               char* out, unsigned int strideOut,
+                               GLsizei count, const IndexT* indices,
+                               int attribSize) {
+    for (GLsizei i = 0; i < count; i++) {
+        unsigned int index = indices[i];
+        byteDirectGeneric(in + index * strideIn, 0, out + index * strideOut, 0,
+                          1, attribSize);
+    }
+}
+
+template <int N>
+static void fixedDirectScalar(const char* in, unsigned int strideIn,
+                              char* out, unsigned int strideOut,
+                              unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        fixedElem<N>(in, out);
+        in += strideIn;
+        out += strideOut;
+    }
+}
+
+template <int N>
+static void byteDirectScalar(const char* in, unsigned int strideIn,
+                             char* out, unsigned int strideOut,
+                             unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        byteElem<N>(in, out);
+        in += strideIn;
+        out += strideOut;
+    }
+}
+
+template <int N, class IndexT>
+static void fixedIndexedScalar(const char* in, unsigned int strideIn,
+                               char* out, unsigned int strideOut,
+                               GLsizei count, const IndexT* indices) {
+    for (GLsizei i = 0; i < count; i++) {
+        unsigned int index = indices[i];
+        fixedElem<N>(in + index * strideIn, out + index * strideOut);
+    }
+}
+
+template <int N, class IndexT>
+static void byteIndexedScalar(const char* in, unsigned int strideIn,
+                              char* out, unsigned int strideOut,
+                              GLsizei count, const IndexT* indices) {
+    for (GLsizei i = 0; i < count; i++) {
+        unsigned int index = indices[i];
+        byteElem<N>(in + index * strideIn, out + index * strideOut);
+    }
+}
+
+static void fixedDirectScalarImpl(const char* in, unsigned int strideIn,
+                                  char* out, unsigned int strideOut,
+                                  unsigned int count, int attribSize) {
+    switch (attribSize) {
+    case 2: fixedDirectScalar<2>(in, strideIn, out, strideOut, count); break;
+    case 3: fixedDirectScalar<3>(in, strideIn, out, strideOut, count); break;
+    case 4: fixedDirectScalar<4>(in, strideIn, out, strideOut, count); break;
+    default:
+        fixedDirectGeneric(in, strideIn, out, strideOut, count, attribSize);
+    }
+}
+
+static void byteDirectScalarImpl(const char* in, unsigned int strideIn,
+                                 char* out, unsigned int strideOut,
+                                 unsigned int count, int attribSize) {
+    switch (attribSize) {
+    case 2: byteDirectScalar<2>(in, strideIn, out, strideOut, count); break;
+    case 3: byteDirectScalar<3>(in, strideIn, out, strideOut, count); break;
+    case 4: byteDirectScalar<4>(in, strideIn, out, strideOut, count); break;
+    default:
+        byteDirectGeneric(in, strideIn, out, strideOut, count, attribSize);
+    }
+}
+
+template <class IndexT>
+static void fixedIndexedScalarImpl(const char* in, unsigned int strideIn,
+                                   char* out, unsigned int strideOut,
+                                   GLsizei count, const IndexT* indices,
+                                   int attribSize) {
+    switch (attribSize) {
+    case 2: fixedIndexedScalar<2>(in, strideIn, out, strideOut, count, indices); break;
+    case 3: fixedIndexedScalar<3>(in, strideIn, out, strideOut, count, indices); break;
+    case 4: fixedIndexedScalar<4>(in, strideIn, out, strideOut, count, indices); break;
+    default:
+        fixedIndexedGeneric(in, strideIn, out, strideOut, count, indices, attribSize);
+    }
+}
+
+template <class IndexT>
+static void byteIndexedScalarImpl(const char* in, unsigned int strideIn,
+                                  char* out, unsigned int strideOut,
+                                  GLsizei count, const IndexT* indices,
+                                  int attribSize) {
+    switch (attribSize) {
+    case 2: byteIndexedScalar<2>(in, strideIn, out, strideOut, count, indices); break;
+    case 3: byteIndexedScalar<3>(in, strideIn, out, strideOut, count, indices); break;
+    case 4: byteIndexedScalar<4>(in, strideIn, out, strideOut, count, indices); break;
+    default:
+        byteIndexedGeneric(in, strideIn, out, strideOut, count, indices, attribSize);
+    }
+}
+
+static void fixedIndexedScalarEntry(const char* in, unsigned int strideIn,
+                                    char* out, unsigned int strideOut,
+                                    GLsizei count, GLenum indicesType,
+                                    const GLvoid* indices, int attribSize) {
+    if (indicesType == GL_UNSIGNED_BYTE) {
+        fixedIndexedScalarImpl(in, strideIn, out, strideOut, count,
+                               static_cast<const GLubyte*>(indices), attribSize);
+    } else {
+        fixedIndexedScalarImpl(in, strideIn, out, strideOut, count,
+                               static_cast<const GLushort*>(indices), attribSize);
+    }
+}
+
+static void byteIndexedScalarEntry(const char* in, unsigned int strideIn,
+                                   char* out, unsigned int strideOut,
+                                   GLsizei count, GLenum indicesType,
+                                   const GLvoid* indices, int attribSize) {
+    if (indicesType == GL_UNSIGNED_BYTE) {
+        byteIndexedScalarImpl(in, strideIn, out, strideOut, count,
+                              static_cast<const GLubyte*>(indices), attribSize);
+    } else {
+        byteIndexedScalarImpl(in, strideIn, out, strideOut, count,
+                              static_cast<const GLushort*>(indices), attribSize);
+    }
+}
+
+static const ConversionFuncs s_scalarFuncs = {
+    fixedDirectScalarImpl,
+    byteDirectScalarImpl,
+    fixedIndexedScalarEntry,
+    byteIndexedScalarEntry
+};
+
+#ifdef HAVE_X86_KERNELS
+
+//
+// SSE2 implementation. Tightly packed arrays are converted as one flat
+// array of components, strided and indexed ones one element at a time
+// without touching the bytes between elements.
+//
+// (float)x * 2^-16 is exactly (float)x / 65536, as X2F() computes it.
+//
+
+SSE2_FUNC static inline __m128 fixedToFloatSSE2(__m128i v) {
+    return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 65536.0f));
+}
+
+SSE2_FUNC static inline __m128i byteToShortSSE2(__m128i v) {
+    // sign extend the 8 low bytes
+    return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+}
+
+template <int N>
+SSE2_FUNC static inline void fixedElemSSE2(const char* in, char* out) {
+    if (N == 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        _mm_storeu_ps(reinterpret_cast<float*>(out), fixedToFloatSSE2(v));
+    } else if (N == 3) {
+        int z;
+        memcpy(&z, in + 8, sizeof(z));
+        __m128i v = _mm_unpacklo_epi64(
+                        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in)),
+                        _mm_cvtsi32_si128(z));
+        __m128 f = fixedToFloatSSE2(v);
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), f);
+        _mm_store_ss(reinterpret_cast<float*>(out) + 2, _mm_movehl_ps(f, f));
+    } else if (N == 2) {
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), fixedToFloatSSE2(v));
+    } else {
+        fixedElem<N>(in, out);
+    }
+}
+
+template <int N>
+SSE2_FUNC static inline void byteElemSSE2(const char* in, char* out) {
+    if (N == 4) {
+        int v;
+        memcpy(&v, in, sizeof(v));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out),
+                         byteToShortSSE2(_mm_cvtsi32_si128(v)));
+    } else {
+        // 2 or 3 components do not pay for the vector setup
+        byteElem<N>(in, out);
+    }
+}
+
+SSE2_FUNC static void fixedFlatSSE2(const char* in, char* out, unsigned int n) {
+    const GLfixed* s = reinterpret_cast<const GLfixed*>(in);
+    GLfloat* d = reinterpret_cast<GLfloat*>(out);
+    unsigned int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        _mm_storeu_ps(d + i, fixedToFloatSSE2(v));
+    }
+    for (; i < n; i++) {
+        d[i] = X2F(s[i]);
+    }
+}
+
+SSE2_FUNC static void byteFlatSSE2(const char* in, char* out, unsigned int n) {
+    const GLbyte* s = reinterpret_cast<const GLbyte*>(in);
+    GLshort* d = reinterpret_cast<GLshort*>(out);
+    unsigned int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i),
+                         byteToShortSSE2(v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i + 8),
+                         _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8));
+    }
+    for (; i < n; i++) {
+        d[i] = B2S(s[i]);
+    }
+}
+
+template <int N>
+SSE2_FUNC static void fixedDirectSSE2(const char* in, unsigned int strideIn,
+                                      char* out, unsigned int strideOut,
+                                      unsigned int count) {
+    if (strideIn == N * sizeof(GLfixed) && strideOut == N * sizeof(GLfloat)) {
+        fixedFlatSSE2(in, out, count * N);
+        return;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        fixedElemSSE2<N>(in, out);
+        in += strideIn;
+        out += strideOut;
+    }
+}
+
+template <int N>
+SSE2_FUNC static void byteDirectSSE2(const char* in, unsigned int strideIn,
+                                     char* out, unsigned int strideOut,
+                                     unsigned int count) {
+    if (strideIn == N * sizeof(GLbyte) && strideOut == N * sizeof(GLshort)) {
+        byteFlatSSE2(in, out, count * N);
+        return;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        byteElemSSE2<N>(in, out);
+        in += strideIn;
+        out += strideOut;
+    }
+}
+
+template <int N, class IndexT>
+SSE2_FUNC static void fixedIndexedSSE2(const char* in, unsigned int strideIn,
+                                       char* out, unsigned int strideOut,
+                                       GLsizei count, const IndexT* indices) {
+    for (GLsizei i = 0; i < count; i++) {
+        unsigned int index = indices[i];
+        fixedElemSSE2<N>(in + index * strideIn, out + index * strideOut);
+    }
+}
+
+template <int N, class IndexT>
+SSE2_FUNC static void byteIndexedSSE2(const char* in, unsigned int strideIn,
+                                      char* out, unsigned int strideOut,
+                                      GLsizei count, const IndexT* indices) {
+    for (GLsizei i = 0; i < count; i++) {
+        unsigned int index = indices[i];
+        byteElemSSE2<N>(in + index * strideIn, out + index * strideOut);
+    }
+}
+
+SSE2_FUNC static void fixedDirectSSE2Impl(const char* in, unsigned int strideIn,
+                                          char* out, unsigned int strideOut,
+                                          unsigned int count, int attribSize) {
+    switch (attribSize) {
+    case 2: fixedDirectSSE2<2>(in, strideIn, out, strideOut, count); break;
+    case 3: fixedDirectSSE2<3>(in, strideIn, out, strideOut, count); break;
+    case 4: fixedDirectSSE2<4>(in, strideIn, out, strideOut, count); break;
+    default:
+        fixedDirectGeneric(in, strideIn, out, strideOut, count, attribSize);
+    }
+}
+
+SSE2_FUNC static void byteDirectSSE2Impl(const char* in, unsigned int strideIn,
+                                         char* out, unsigned int strideOut,
+                                         unsigned int count, int attribSize) {
+    switch (attribSize) {
+    case 2: byteDirectSSE2<2>(in, strideIn, out, strideOut, count); break;
+    case 3: byteDirectSSE2<3>(in, strideIn, out, strideOut, count); break;
+    case 4: byteDirectSSE2<4>(in, strideIn, out, strideOut, count); break;
+    default:
+        byteDirectGeneric(in, strideIn, out, strideOut, count, attribSize);
+    }
+}
+
+template <class IndexT>
+SSE2_FUNC static void fixedIndexedSSE2Impl(const char* in, unsigned int strideIn,
+                                           char* out, unsigned int strideOut,
+                                           GLsizei count, const IndexT* indices,
+                                           int attribSize) {
+    switch (attribSize) {
+    case 2: fixedIndexedSSE2<2>(in, strideIn, out, strideOut, count, indices); break;
+    case 3: fixedIndexedSSE2<3>(in, strideIn, out, strideOut, count, indices); break;
+    case 4: fixedIndexedSSE2<4>(in, strideIn, out, strideOut, count, indices); break;
+    default:
+        fixedIndexedGeneric(in, strideIn, out, strideOut, count, indices, attribSize);
+    }
+}
+
+template <class IndexT>
+SSE2_FUNC static void byteIndexedSSE2Impl(const char* in, unsigned int strideIn,
+                                          char* out, unsigned int strideOut,
+                                          GLsizei count, const IndexT* indices,
+                                          int attribSize) {
+    switch (attribSize) {
+    case 2: byteIndexedSSE2<2>(in, strideIn, out, strideOut, count, indices); break;
+    case 3: byteIndexedSSE2<3>(in, strideIn, out, strideOut, count, indices); break;
+    case 4: byteIndexedSSE2<4>(in, strideIn, out, strideOut, count, indices); break;
+    default:
+        byteIndexedGeneric(in, strideIn, out, strideOut, count, indices, attribSize);
+    }
+}
+
+SSE2_FUNC static void fixedIndexedSSE2Entry(const char* in, unsigned int strideIn,
+                                            char* out, unsigned int strideOut,
+                                            GLsizei count, GLenum indicesType,
+                                            const GLvoid* indices, int attribSize) {
+    if (indicesType == GL_UNSIGNED_BYTE) {
+        fixedIndexedSSE2Impl(in, strideIn, out, strideOut, count,
+                             static_cast<const GLubyte*>(indices), attribSize);
+    } else {
+        fixedIndexedSSE2Impl(in, strideIn, out, strideOut, count,
+                             static_cast<const GLushort*>(indices), attribSize);
+    }
+}
+
+SSE2_FUNC static void byteIndexedSSE2Entry(const char* in, unsigned int strideIn,
+                                           char* out, unsigned int strideOut,
+                                           GLsizei count, GLenum indicesType,
+                                           const GLvoid* indices, int attribSize) {
+    if (indicesType == GL_UNSIGNED_BYTE) {
+        byteIndexedSSE2Impl(in, strideIn, out, strideOut, count,
+                            static_cast<const GLubyte*>(indices), attribSize);
+    } else {
+        byteIndexedSSE2Impl(in, strideIn, out, strideOut, count,
+                            static_cast<const GLushort*>(indices), attribSize);
+    }
+}
+
+static const ConversionFuncs s_sse2Funcs = {
+    fixedDirectSSE2Impl,
+    byteDirectSSE2Impl,
+    fixedIndexedSSE2Entry,
+    byteIndexedSSE2Entry
+};
+
+//
+// AVX2 implementation. Only the flat conversion of packed arrays gets
+// wider, an element of a strided or indexed array fits in an SSE
+// register and those use the SSE2 kernels.
+//
+
+AVX2_FUNC static void fixedFlatAVX2(const char* in, char* out, unsigned int n) {
+    const GLfixed* s = reinterpret_cast<const GLfixed*>(in);
+    GLfloat* d = reinterpret_cast<GLfloat*>(out);
+    const __m256 scale = _mm256_set1_ps(1.0f / 65536.0f);
+    unsigned int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        _mm256_storeu_ps(d + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    for (; i < n; i++) {
+        d[i] = X2F(s[i]);
+    }
+}
+
+AVX2_FUNC static void byteFlatAVX2(const char* in, char* out, unsigned int n) {
+    const GLbyte* s = reinterpret_cast<const GLbyte*>(in);
+    GLshort* d = reinterpret_cast<GLshort*>(out);
+    unsigned int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i),
+                            _mm256_cvtepi8_epi16(v));
+    }
+    for (; i < n; i++) {
+        d[i] = B2S(s[i]);
+    }
+}
+
+AVX2_FUNC static void fixedDirectAVX2Impl(const char* in, unsigned int strideIn,
+                                          char* out, unsigned int strideOut,
+                                          unsigned int count, int attribSize) {
+    if (attribSize >= 1 && attribSize <= 4 &&
+        strideIn == attribSize * sizeof(GLfixed) &&
+        strideOut == attribSize * sizeof(GLfloat)) {
+        fixedFlatAVX2(in, out, count * attribSize);
+        return;
+    }
+    fixedDirectSSE2Impl(in, strideIn, out, strideOut, count, attribSize);
+}
+
+AVX2_FUNC static void byteDirectAVX2Impl(const char* in, unsigned int strideIn,
+                                         char* out, unsigned int strideOut,
+                                         unsigned int count, int attribSize) {
+    if (attribSize >= 1 && attribSize <= 4 &&
+        strideIn == attribSize * sizeof(GLbyte) &&
+        strideOut == attribSize * sizeof(GLshort)) {
+        byteFlatAVX2(in, out, count * attribSize);
+        return;
+    }
+    byteDirectSSE2Impl(in, strideIn, out, strideOut, count, attribSize);
+}
+
+static const ConversionFuncs s_avx2Funcs = {
+    fixedDirectAVX2Impl,
+    byteDirectAVX2Impl,
+    fixedIndexedSSE2Entry,
+    byteIndexedSSE2Entry
+};
+
+static unsigned int getXCR0() {
+    unsigned int lo, hi;
+    // xgetbv, spelled out for assemblers which do not know it
+    __asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));
+    return lo;
+}
+
+static VertexConversionImpl detectImpl() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 26))) {
+        return VERTEX_CONVERSION_SCALAR;
+    }
+
+    // AVX2 needs the OS to save the ymm registers (OSXSAVE, AVX, XCR0)
+    const unsigned int osxsaveAvx = (1 << 27) | (1 << 28);
+    if ((ecx & osxsaveAvx) == osxsaveAvx && (getXCR0() & 6) == 6 &&
+        __get_cpuid_max(0, NULL) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (ebx & (1 << 5)) {
+            return VERTEX_CONVERSION_AVX2;
+        }
+    }
+    return VERTEX_CONVERSION_SSE2;
+}
+
+#else
+
+static VertexConversionImpl detectImpl() {
+    return VERTEX_CONVERSION_SCALAR;
+}
+
+#endif // HAVE_X86_KERNELS
+
+static const ConversionFuncs* implFuncs(VertexConversionImpl impl) {
+    switch (impl) {
+#ifdef HAVE_X86_KERNELS
+    case VERTEX_CONVERSION_AVX2: return &s_avx2Funcs;
+    case VERTEX_CONVERSION_SSE2: return &s_sse2Funcs;
+#endif
+    default: return &s_scalarFuncs;
+    }
+}
+
+//
+// Set on first use, threads racing there store the same values.
+//
+static VertexConversionImpl s_bestImpl = VERTEX_CONVERSION_SCALAR;
+static VertexConversionImpl s_impl = VERTEX_CONVERSION_SCALAR;
+static const ConversionFuncs* s_funcs = NULL;
+
+static const ConversionFuncs* funcs() {
+    if (!s_funcs) {
+        s_bestImpl = detectImpl();
+        s_impl = s_bestImpl;
+        s_funcs = implFuncs(s_impl);
+    }
+    return s_funcs;
+}
+
+VertexConversionImpl getVertexConversionImpl() {
+    funcs();
+    return s_impl;
+}
+
+bool setVertexConversionImpl(VertexConversionImpl p_impl) {
+    funcs();
+    if (p_impl > s_bestImpl) {
+        return false;
+    }
+    s_impl = p_impl;
+    s_funcs = implFuncs(p_impl);
+    return true;
+}
+
+void convertFixedToFloat(const char* dataIn, unsigned int strideIn,
+                         char* dataOut, unsigned int strideOut,
+                         unsigned int count, int attribSize) {
+    funcs()->fixedDirect(dataIn, strideIn, dataOut, strideOut, count, attribSize);
+}
+
+void convertByteToShort(const char* dataIn, unsigned int strideIn,
+                        char* dataOut, unsigned int strideOut,
+                        unsigned int count, int attribSize) {
+    funcs()->byteDirect(dataIn, strideIn, dataOut, strideOut, count, attribSize);
+}
+
+void convertFixedToFloatIndexed(const char* dataIn, unsigned int strideIn,
+                                char* dataOut, unsigned int strideOut,
+                                GLsizei count, GLenum indicesType,
+                                const GLvoid* indices, int attribSize) {
+    funcs()->fixedIndexed(dataIn, strideIn, dataOut, strideOut,
+                          count, indicesType, indices, attribSize);
+}
+
+void convertByteToShortIndexed(const char* dataIn, unsigned int strideIn,
+                               char* dataOut, unsigned int strideOut,
+                               GLsizei count, GLenum indicesType,
+                               const GLvoid* indices, int attribSize) {
+    funcs()->byteIndexed(dataIn, strideIn, dataOut, strideOut,
+                         count, indicesType, indices, attribSize);
+}
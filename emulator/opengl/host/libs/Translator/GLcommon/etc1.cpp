@@ -16,6 +16,10 @@
 
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /* From http://www.khronos.org/registry/gles/extensions/OES/OES_compressed_ETC1_RGB8_texture.txt
 
  The number of bits that represent a 4x4 texel block is 64 bits if
@@ -163,34 +167,48 @@ inline int convertDiff(int base, int diff) {
     return convert5To8((0x1f & base) + kLookup[0x7 & diff]);
 }
 
+// The four colors a subblock can take, base color plus each modifier,
+// clamped. Stored as R, G, B, unused.
+
 static
-void decode_subblock(etc1_byte* pOut, int r, int g, int b, const int* table,
-        etc1_uint32 low, bool second, bool flipped) {
-    int baseX = 0;
-    int baseY = 0;
-    if (second) {
-        if (flipped) {
-            baseY = 2;
-        } else {
-            baseX = 2;
-        }
+inline void subblock_colors(etc1_byte* pColors, int r, int g, int b, const int* table) {
+#ifdef __SSE2__
+    // 16 bit lanes hold base + modifier exactly, packus does the clamping
+    __m128i base = _mm_setr_epi16(r, g, b, 0, r, g, b, 0);
+    __m128i d01 = _mm_setr_epi16(table[0], table[0], table[0], 0,
+                                 table[1], table[1], table[1], 0);
+    __m128i d23 = _mm_setr_epi16(table[2], table[2], table[2], 0,
+                                 table[3], table[3], table[3], 0);
+    __m128i colors = _mm_packus_epi16(_mm_add_epi16(base, d01),
+                                      _mm_add_epi16(base, d23));
+    _mm_storeu_si128((__m128i*) pColors, colors);
+#else
+    for (int i = 0; i < 4; i++) {
+        etc1_byte* q = pColors + 4 * i;
+        *q++ = clamp(r + table[i]);
+        *q++ = clamp(g + table[i]);
+        *q++ = clamp(b + table[i]);
+        *q = 0;
     }
-    for (int i = 0; i < 8; i++) {
-        int x, y;
-        if (flipped) {
-            x = baseX + (i >> 1);
-            y = baseY + (i & 1);
-        } else {
-            x = baseX + (i >> 2);
-            y = baseY + (i & 3);
+#endif
+}
+
+// Texel (x, y) takes one of the four colors of the subblock it is in,
+// picked by its two index bits k = y + 4 * x and k + 16 of low.
+
+static
+inline void decode_texels(etc1_byte* pOut, const etc1_byte* pColors,
+        etc1_uint32 low, bool flipped) {
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            int k = y + (x * 4);
+            int offset = ((low >> k) & 1) | ((low >> (k + 15)) & 2);
+            int second = flipped ? (y >> 1) : (x >> 1);
+            const etc1_byte* c = pColors + 16 * second + 4 * offset;
+            *pOut++ = c[0];
+            *pOut++ = c[1];
+            *pOut++ = c[2];
         }
-        int k = y + (x * 4);
-        int offset = ((low >> k) & 1) | ((low >> (k + 15)) & 2);
-        int delta = table[offset];
-        etc1_byte* q = pOut + 3 * (x + 4 * y);
-        *q++ = clamp(r + delta);
-        *q++ = clamp(g + delta);
-        *q++ = clamp(b + delta);
     }
 }
 
@@ -226,8 +244,10 @@ void etc1_decode_block(const etc1_byte* pIn, etc1_byte* pOut) {
     const int* tableA = kModifierTable + tableIndexA * 4;
     const int* tableB = kModifierTable + tableIndexB * 4;
     bool flipped = (high & 1) != 0;
-    decode_subblock(pOut, r1, g1, b1, tableA, low, false, flipped);
-    decode_subblock(pOut, r2, g2, b2, tableB, low, true, flipped);
+    etc1_byte colors[32];
+    subblock_colors(colors, r1, g1, b1, tableA);
+    subblock_colors(colors + 16, r2, g2, b2, tableB);
+    decode_texels(pOut, colors, low, flipped);
 }
 
 typedef struct {
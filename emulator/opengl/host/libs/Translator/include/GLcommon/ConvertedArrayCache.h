@@ -0,0 +1,70 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef CONVERTED_ARRAY_CACHE_H
+#define CONVERTED_ARRAY_CACHE_H
+
+#include <GLES/gl.h>
+#include <stddef.h>
+
+//
+// The GL_FLOAT / GL_SHORT conversion of a client side GL_FIXED / GL_BYTE
+// array, kept between draws.
+//
+// The conversion is returned as is when the same layout is converted
+// again and the source bytes did not change, which is checked against a
+// copy of them. An array found changed on several draws in a row is no
+// longer copied and compared for a while, it is just converted.
+// The conversion buffer is reused, it only grows.
+//
+class ConvertedArrayCache
+{
+public:
+    ConvertedArrayCache();
+    ~ConvertedArrayCache();
+
+    //
+    // Converts nElements elements of attribSize components, read every
+    // stride bytes from data, into a packed array. Returns NULL when out
+    // of memory.
+    //
+    void* convert(const char* data, unsigned int stride, GLenum type,
+                  int attribSize, unsigned int nElements);
+
+private:
+    ConvertedArrayCache(const ConvertedArrayCache&);
+    ConvertedArrayCache& operator=(const ConvertedArrayCache&);
+
+    static bool grow(unsigned char** buf, size_t* cap, size_t len);
+
+    // layout of the cached conversion
+    const char*    m_data;
+    unsigned int   m_stride;
+    GLenum         m_type;
+    int            m_attribSize;
+    unsigned int   m_nElements;
+    bool           m_valid;
+
+    unsigned char* m_converted;
+    size_t         m_convertedCap;
+    unsigned char* m_source;      // copy of the source bytes, when m_compare
+    size_t         m_sourceCap;
+
+    bool           m_compare;
+    unsigned int   m_changes;     // consecutive draws with a changed source
+    unsigned int   m_skipped;     // draws since m_compare was cleared
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef ETC1_DECODER_H
+#define ETC1_DECODER_H
+
+#include "etc1.h"
+
+//
+// ETC1 to RGB decoding for glCompressedTexImage2D.
+//
+// Large images have their block rows split between the calling thread
+// and a small pool of worker threads shared by all the contexts, started
+// on the first such image. A second thread decoding while the pool is
+// busy decodes alone rather than wait for it.
+//
+// The number of workers defaults to one less than the number of CPUs,
+// at most 3, and can be set with ANDROID_GLES_ETC1_THREADS; 0 decodes
+// every image on the calling thread.
+//
+class Etc1Decoder
+{
+public:
+    //
+    // Same as etc1_decode_image(pIn, pOut, width, height, 3, stride).
+    //
+    static int decodeRGB(const etc1_byte* pIn, etc1_byte* pOut,
+                         etc1_uint32 width, etc1_uint32 height,
+                         etc1_uint32 stride);
+
+    //
+    // Decodes the block rows [firstRow, endRow) of the image, each one
+    // is four pixel rows.
+    //
+    static void decodeBlockRows(const etc1_byte* pIn, etc1_byte* pOut,
+                                etc1_uint32 width, etc1_uint32 height,
+                                etc1_uint32 stride,
+                                etc1_uint32 firstRow, etc1_uint32 endRow);
+};
+
+#endif
@@ -191,6 +191,13 @@ public:
     static void (GLAPIENTRY *glTexGeniv) (GLenum coord, GLenum pname, const GLint *params );
     static void (GLAPIENTRY *glGetTexGenfv) (GLenum coord, GLenum pname, GLfloat *params );
     static void (GLAPIENTRY *glGetTexGeniv) (GLenum coord, GLenum pname, GLint *params );
+    static void (GLAPIENTRY *glGenProgramsARB) (GLsizei n, GLuint *programs);
+    static void (GLAPIENTRY *glDeleteProgramsARB) (GLsizei n, const GLuint *programs);
+    static void (GLAPIENTRY *glBindProgramARB) (GLenum target, GLuint program);
+    static void (GLAPIENTRY *glProgramStringARB) (GLenum target, GLenum format, GLsizei len, const GLvoid *string);
+    static void (GLAPIENTRY *glVertexAttribPointerARB) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+    static void (GLAPIENTRY *glEnableVertexAttribArrayARB) (GLuint index);
+    static void (GLAPIENTRY *glDisableVertexAttribArrayARB) (GLuint index);
 
     /* Loading OpenGL functions which are needed ONLY for implementing GLES 2.0*/
     static void (GL_APIENTRY *glBlendColor) (GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha);
@@ -19,6 +19,7 @@
 
 #include "GLDispatch.h"
 #include "GLESpointer.h"
+#include "GLESstateFilter.h"
 #include "objectNameManager.h"
 #include <utils/threads.h>
 #include <string>
@@ -60,7 +61,8 @@ struct GLSupport {
                 GL_EXT_PACKED_DEPTH_STENCIL(false) , GL_OES_READ_FORMAT(false), \
                 GL_ARB_HALF_FLOAT_PIXEL(false), GL_NV_HALF_FLOAT(false), \
                 GL_ARB_HALF_FLOAT_VERTEX(false),GL_SGIS_GENERATE_MIPMAP(false),
-                GL_ARB_ES2_COMPATIBILITY(false),GL_OES_STANDARD_DERIVATIVES(false) {} ;
+                GL_ARB_ES2_COMPATIBILITY(false),GL_OES_STANDARD_DERIVATIVES(false), \
+                GL_ARB_VERTEX_PROGRAM(false) {} ;
     int  maxLights;
     int  maxVertexAttribs;
     int  maxClipPlane;
@@ -80,6 +82,7 @@ struct GLSupport {
     bool GL_SGIS_GENERATE_MIPMAP;
     bool GL_ARB_ES2_COMPATIBILITY;
     bool GL_OES_STANDARD_DERIVATIVES;
+    bool GL_ARB_VERTEX_PROGRAM;
 
 };
 
@@ -98,8 +101,11 @@ struct ArrayData{
 class GLESConversionArrays
 {
 public:
-    GLESConversionArrays():m_current(0){};
+    GLESConversionArrays():m_current(0),m_failed(false){};
     void setArr(void* data,unsigned int stride,GLenum type);
+    // a conversion ran out of memory, the draw must not be done
+    void setFailed(){ m_failed = true; };
+    bool failed() const { return m_failed; };
     void allocArr(unsigned int size,GLenum type);
     ArrayData& operator[](int i);
     void* getCurrentData();
@@ -111,6 +117,7 @@ public:
 private:
     std::map<GLenum,ArrayData> m_arrays;
     unsigned int m_current;
+    bool m_failed;
 };
 
 class GLEScontext{
@@ -162,6 +169,9 @@ public:
     void setFramebufferBinding(GLuint fb) { m_framebuffer = fb; }
     GLuint getFramebufferBinding() const { return m_framebuffer; }
 
+    unsigned int getActiveTextureUnit() const { return m_activeTexture; }
+    GLESstateFilter& stateFilter() { return m_stateFilter; }
+
     static GLDispatch& dispatcher(){return s_glDispatch;};
 
     static int getMaxLights(){return s_glSupport.maxLights;}
@@ -208,6 +218,7 @@ private:
     unsigned int          m_elementBuffer;
     GLuint                m_renderbuffer;
     GLuint                m_framebuffer;
+    GLESstateFilter       m_stateFilter;
 
     static std::string    s_glVendor;
     static std::string    s_glRenderer;
@@ -1,33 +1,45 @@
 #ifndef GLES_MACROS_H
 #define GLES_MACROS_H
 
+//
+// The context current on the calling thread. Where __thread is available
+// the library keeps its own copy, set from eglMakeCurrent through
+// GLESiface::setCurrentContext, so that GL calls do not go through EGL's
+// thread info to find it.
+//
+#ifdef __linux__
+#define CURRENT_CTX() s_currentContext
+#else
+#define CURRENT_CTX() s_eglIface->getGLESContext()
+#endif
+
 #define GET_CTX() \
             if(!s_eglIface) return; \
-            GLEScontext *ctx = s_eglIface->getGLESContext(); \
+            GLEScontext *ctx = CURRENT_CTX(); \
 
 #define GET_CTX_CM() \
             if(!s_eglIface) return; \
-            GLEScmContext *ctx = static_cast<GLEScmContext *>(s_eglIface->getGLESContext()); \
+            GLEScmContext *ctx = static_cast<GLEScmContext *>(CURRENT_CTX()); \
             if(!ctx) return;
 
 #define GET_CTX_V2() \
             if(!s_eglIface) return; \
-            GLESv2Context *ctx = static_cast<GLESv2Context *>(s_eglIface->getGLESContext()); \
+            GLESv2Context *ctx = static_cast<GLESv2Context *>(CURRENT_CTX()); \
             if(!ctx) return;
 
 #define GET_CTX_RET(failure_ret) \
             if(!s_eglIface) return failure_ret; \
-            GLEScontext *ctx = s_eglIface->getGLESContext(); \
+            GLEScontext *ctx = CURRENT_CTX(); \
             if(!ctx) return failure_ret;
 
 #define GET_CTX_CM_RET(failure_ret) \
             if(!s_eglIface) return failure_ret; \
-            GLEScmContext *ctx = static_cast<GLEScmContext *>(s_eglIface->getGLESContext()); \
+            GLEScmContext *ctx = static_cast<GLEScmContext *>(CURRENT_CTX()); \
             if(!ctx) return failure_ret;
 
 #define GET_CTX_V2_RET(failure_ret) \
             if(!s_eglIface) return failure_ret; \
-            GLESv2Context *ctx = static_cast<GLESv2Context *>(s_eglIface->getGLESContext()); \
+            GLESv2Context *ctx = static_cast<GLESv2Context *>(CURRENT_CTX()); \
             if(!ctx) return failure_ret;
 
 
@@ -18,6 +18,7 @@
 
 #include <GLES/gl.h>
 #include "GLESbuffer.h"
+#include "ConvertedArrayCache.h"
 
 class GLESpointer
 {
@@ -42,6 +43,7 @@ public:
     bool          isNormalize() const;
     bool          isVBO() const;
     void          enable(bool b);
+    ConvertedArrayCache& conversionCache(){ return m_conversionCache; }
 
 private:
     GLint         m_size;
@@ -54,5 +56,6 @@ private:
     GLuint        m_bufferName;
     unsigned int  m_buffOffset;
     bool          m_isVBO;
+    ConvertedArrayCache m_conversionCache;  // of the client side array
 };
 #endif
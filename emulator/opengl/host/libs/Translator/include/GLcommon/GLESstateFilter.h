@@ -0,0 +1,105 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef GLES_STATE_FILTER_H
+#define GLES_STATE_FILTER_H
+
+#include <GLES/gl.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+//
+// Shadow of the host state a context sets through the translator, used
+// to drop the state calls that would not change anything. Each check
+// returns true when the call can be dropped and otherwise records the
+// new value; a value is unknown until the context first sets it.
+//
+// Setting ANDROID_GLES_NO_STATE_FILTER in the environment disables the
+// filter, ANDROID_GLES_STATE_FILTER_STATS prints how many calls of each
+// kind were dropped when the context is destroyed.
+//
+class GLESstateFilter
+{
+public:
+    enum Call {
+        ENABLE,             // glEnable / glDisable
+        BIND_TEXTURE,
+        BLEND_FUNC,
+        USE_PROGRAM,
+        TEX_ENV,
+        NUM_CALLS
+    };
+
+    GLESstateFilter();
+    ~GLESstateFilter();
+
+    bool enable(GLenum cap,unsigned int unit,bool enable);
+    bool bindTexture(unsigned int unit,GLenum target,GLuint globalName);
+    bool blendFunc(GLenum sfactor,GLenum dfactor);
+    bool useProgram(GLuint globalName);
+    bool texEnv(unsigned int unit,GLenum target,GLenum pname,GLfloat param);
+
+    // state changed by other calls
+    void forgetBlendFunc() { m_blendValid = false; }
+    void forgetTexEnv(unsigned int unit,GLenum target,GLenum pname);
+
+    //
+    // Texture names were deleted or remapped somewhere. Deleting a
+    // texture unbinds it and frees its name for reuse, in any context
+    // sharing it, so no texture binding shadowed before is trusted.
+    //
+    static void textureNamesChanged();
+
+    unsigned int calls(Call c) const { return m_calls[c]; }
+    unsigned int dropped(Call c) const { return m_dropped[c]; }
+
+private:
+    GLESstateFilter(const GLESstateFilter&);
+    GLESstateFilter& operator=(const GLESstateFilter&);
+
+    bool check(Call c,bool same) {
+        m_calls[c]++;
+        if(same && m_enabled) {
+            m_dropped[c]++;
+            return true;
+        }
+        return false;
+    }
+
+    struct TextureBinding {
+        TextureBinding():name(0),epoch(0),valid(false){}
+        GLuint  name;
+        int32_t epoch;
+        bool    valid;
+    };
+
+    bool                           m_enabled;
+    bool                           m_printStats;
+    std::map<unsigned int,bool>    m_caps;
+    std::vector<TextureBinding>    m_textures;
+    bool                           m_blendValid;
+    GLenum                         m_blendSrc;
+    GLenum                         m_blendDst;
+    bool                           m_programValid;
+    GLuint                         m_program;
+    std::map<uint64_t,GLfloat>     m_texEnv;
+    unsigned int                   m_calls[NUM_CALLS];
+    unsigned int                   m_dropped[NUM_CALLS];
+
+    static volatile int32_t        s_textureEpoch;
+};
+
+#endif
@@ -17,9 +17,24 @@
 #define __PALETTE_TEXTURE_H__
 
 #include <GLES/gl.h>
+#include <stddef.h>
 
 #define MAX_SUPPORTED_PALETTE 10
 
-unsigned char* uncompressTexture(GLenum internalformat,GLenum& formatOut,GLsizei width,GLsizei height,GLsizei imageSize, const GLvoid* data,GLint level);
+//
+// Expands the levels [firstLevel, firstLevel + nLevels) of a paletted
+// texture of the given level 0 size into GL_RGB or GL_RGBA (formatOut)
+// GL_UNSIGNED_BYTE images, with rows padded to unpackAlignment bytes.
+// The images follow each other in the returned buffer, image i starting
+// at offsets[i]; free it with delete[].
+//
+// Returns NULL for a format which is not paletted or when imageSize is
+// too small for the levels.
+//
+unsigned char* uncompressTexture(GLenum internalformat,GLenum& formatOut,
+                                 GLsizei width,GLsizei height,
+                                 GLsizei imageSize,const GLvoid* data,
+                                 GLint firstLevel,GLint nLevels,
+                                 GLint unpackAlignment,size_t* offsets);
 
 #endif
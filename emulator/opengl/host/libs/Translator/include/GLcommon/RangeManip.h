@@ -47,23 +47,28 @@ private:
     int m_size;
 };
 
+//
+// A set of byte ranges, kept sorted by start. Ranges that overlap or
+// touch are coalesced when added, so the list never holds two ranges
+// covering the same byte and operator[] walks them in ascending order.
+// Lookups are binary searches; adding ranges in ascending order, as the
+// draw paths do, only ever appends.
+//
 class RangeList {
 public:
       void addRange(const Range& r);
       void addRanges(const RangeList& rl);
+      // removes r from the list, the removed parts are added to deleted
       void delRange(const Range& r,RangeList& deleted);
       void delRanges(const RangeList& rl,RangeList& deleted);
       bool empty() const;
-      void merge();
       int  size() const;
       void clear();
       Range& operator[](unsigned int i){return list[i];};
 private:
-  void erase(unsigned int i);
+  // index of the first range ending at or after pos (after it when strict)
+  unsigned int findEnd(int pos,bool strict) const;
   std::vector<Range> list;
 };
 
-
-
-
 #endif
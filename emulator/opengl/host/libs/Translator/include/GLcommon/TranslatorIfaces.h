@@ -86,6 +86,7 @@ typedef struct {
     void                                            (*flush)();
     void                                            (*finish)();
     void                                            (*setShareGroup)(GLEScontext*,ShareGroupPtr);
+    void                                            (*setCurrentContext)(GLEScontext*);
     __translatorMustCastToProperFunctionPointerType (*getProcAddress)(const char*);
 }GLESiface;
 
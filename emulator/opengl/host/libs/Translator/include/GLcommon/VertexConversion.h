@@ -0,0 +1,67 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VERTEX_CONVERSION_H
+#define _VERTEX_CONVERSION_H
+
+#include <GLES/gl.h>
+
+//
+// Conversion of GL_FIXED vertex attributes to GL_FLOAT and of GL_BYTE
+// ones to GL_SHORT, for arrays the host GL can not take as they are.
+//
+// The results are the same as X2F() / B2S() on each component. Vector
+// kernels are used for attribSize 2, 3 and 4 when the CPU has them,
+// the implementation is picked on first use.
+//
+
+enum VertexConversionImpl {
+    VERTEX_CONVERSION_SCALAR,
+    VERTEX_CONVERSION_SSE2,
+    VERTEX_CONVERSION_AVX2
+};
+
+// the implementation in use, by default the best the CPU supports
+VertexConversionImpl getVertexConversionImpl();
+
+// for tests, fails if the CPU does not support p_impl
+bool setVertexConversionImpl(VertexConversionImpl p_impl);
+
+//
+// Convert count elements of attribSize components, element i is read
+// at dataIn + i * strideIn and written at dataOut + i * strideOut.
+// dataIn and dataOut may be the same when the strides are.
+//
+void convertFixedToFloat(const char* dataIn, unsigned int strideIn,
+                         char* dataOut, unsigned int strideOut,
+                         unsigned int count, int attribSize);
+void convertByteToShort(const char* dataIn, unsigned int strideIn,
+                        char* dataOut, unsigned int strideOut,
+                        unsigned int count, int attribSize);
+
+//
+// Same for the elements listed in indices (GL_UNSIGNED_BYTE or
+// GL_UNSIGNED_SHORT), element i being at i * stride in both arrays.
+//
+void convertFixedToFloatIndexed(const char* dataIn, unsigned int strideIn,
+                                char* dataOut, unsigned int strideOut,
+                                GLsizei count, GLenum indicesType,
+                                const GLvoid* indices, int attribSize);
+void convertByteToShortIndexed(const char* dataIn, unsigned int strideIn,
+                               char* dataOut, unsigned int strideOut,
+                               GLsizei count, GLenum indicesType,
+                               const GLvoid* indices, int attribSize);
+
+#endif
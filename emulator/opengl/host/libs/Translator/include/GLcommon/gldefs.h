@@ -30,6 +30,10 @@ typedef double      GLdouble;   /* double precision float */
 #define GL_HALF_FLOAT_NV      0x140B
 #define GL_HALF_FLOAT         0x140B
 #define GL_VERTEX_PROGRAM_POINT_SIZE 0x8642
+#define GL_VERTEX_PROGRAM_ARB          0x8620
+#define GL_PROGRAM_ERROR_POSITION_ARB  0x864B
+#define GL_PROGRAM_ERROR_STRING_ARB    0x8874
+#define GL_PROGRAM_FORMAT_ASCII_ARB    0x8875
 #define GL_POINT_SPRITE       0x8861
 #define GL_FRAMEBUFFER_EXT                0x8D40
 #define GL_TEXTURE_WIDTH			0x1000
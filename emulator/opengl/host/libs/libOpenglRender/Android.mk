@@ -21,9 +21,13 @@ host_common_SRC_FILES := \
     $(host_OS_SRCS) \
     render_api.cpp \
     ColorBuffer.cpp \
+    DirtyRegion.cpp \
     EGLDispatch.cpp \
     FBConfig.cpp \
     FrameBuffer.cpp \
+    PostReadback.cpp \
+    Compositor.cpp \
+    GLSync.cpp \
     GLDispatch.cpp \
     GL2Dispatch.cpp \
     RenderContext.cpp \
@@ -32,6 +36,9 @@ host_common_SRC_FILES := \
     ThreadInfo.cpp \
     RenderThread.cpp \
     ReadBuffer.cpp \
+    DecoderRouter.cpp \
+    RenderStats.cpp \
+    StreamCapture.cpp \
     RenderServer.cpp
 
 host_common_CFLAGS :=
@@ -18,10 +18,28 @@
 #include "EGLDispatch.h"
 #include "GLDispatch.h"
 #include "ThreadInfo.h"
+#include "GLSync.h"
 #ifdef WITH_GLES2
 #include "GL2Dispatch.h"
 #endif
 #include <stdio.h>
+#include <string.h>
+#include <vector>
+
+class ColorBuffer::BlitTask : public CompositorTask
+{
+public:
+    BlitTask(ColorBuffer *p_cb, GLsync p_fence) : m_cb(p_cb), m_fence(p_fence) {}
+
+    virtual void run() {
+        waitGLFence(m_fence);
+        m_cb->blitFromBlitTexture();
+    }
+
+private:
+    ColorBuffer *m_cb;
+    GLsync m_fence;     // of the copy to the blit texture
+};
 
 ColorBuffer *ColorBuffer::create(int p_width, int p_height,
                                  GLenum p_internalFormat)
@@ -47,10 +65,6 @@ ColorBuffer *ColorBuffer::create(int p_width, int p_height,
             break;
     }
 
-    if (!fb->bind_locked()) {
-        return NULL;
-    }
-
     ColorBuffer *cb = new ColorBuffer();
 
 
@@ -90,6 +104,7 @@ ColorBuffer *ColorBuffer::create(int p_width, int p_height,
     cb->m_width = p_width;
     cb->m_height = p_height;
     cb->m_internalFormat = texInternalFormat;
+    cb->m_dirty.setFull(p_width, p_height);
 
     if (fb->getCaps().has_eglimage_texture_2d) {
         cb->m_eglImage = s_egl.eglCreateImageKHR(fb->getDisplay(),
@@ -105,7 +120,6 @@ ColorBuffer *ColorBuffer::create(int p_width, int p_height,
                                                  NULL);
     }
 
-    fb->unbind_locked();
     return cb;
 }
 
@@ -116,7 +130,8 @@ ColorBuffer::ColorBuffer() :
     m_blitEGLImage(NULL),
     m_fbo(0),
     m_internalFormat(0),
-    m_warYInvertBug(false)
+    m_warYInvertBug(false),
+    m_untracked(false)
 {
 #if __APPLE__
     // On Macs running OS X 10.6 and 10.7 with Intel HD Graphics 3000, some
@@ -134,35 +149,26 @@ ColorBuffer::ColorBuffer() :
 
 ColorBuffer::~ColorBuffer()
 {
+    //
+    // the last reference may be released by any thread, with or without
+    // the FrameBuffer lock, let the FrameBuffer delete the objects.
+    //
     FrameBuffer *fb = FrameBuffer::getFB();
-    fb->bind_locked();
-
-    if (m_blitEGLImage) {
-        s_egl.eglDestroyImageKHR(fb->getDisplay(), m_blitEGLImage);
-    }
-    if (m_eglImage) {
-        s_egl.eglDestroyImageKHR(fb->getDisplay(), m_eglImage);
+    if (fb) {
+        fb->releaseColorBufferObjects(m_eglImage, m_blitEGLImage,
+                                      m_fbo, m_tex, m_blitTex);
     }
-
-    if (m_fbo) {
-        s_gl.glDeleteFramebuffersOES(1, &m_fbo);
-    }
-
-    GLuint tex[2] = {m_tex, m_blitTex};
-    s_gl.glDeleteTextures(2, tex);
-
-    fb->unbind_locked();
 }
 
 void ColorBuffer::subUpdate(int x, int y, int width, int height, GLenum p_format, GLenum p_type, void *pixels)
 {
-    FrameBuffer *fb = FrameBuffer::getFB();
-    if (!fb->bind_locked()) return;
     s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
     s_gl.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     s_gl.glTexSubImage2D(GL_TEXTURE_2D, 0, x, y,
                          width, height, p_format, p_type, pixels);
-    fb->unbind_locked();
+
+    android::Mutex::Autolock mutex(m_lock);
+    m_dirty.addRect(x, y, width, height);
 }
 
 bool ColorBuffer::blitFromCurrentReadBuffer()
@@ -197,43 +203,12 @@ bool ColorBuffer::blitFromCurrentReadBuffer()
                               0, 0, m_width, m_height, 0);
     }
 
-
     //
-    // Now bind the frame buffer context and blit from
-    // m_blitTex into m_tex
+    // The Compositor blits from m_blitTex into m_tex, once the copy
+    // is complete.
     //
-    FrameBuffer *fb = FrameBuffer::getFB();
-    if (fb->bind_locked()) {
-
-        //
-        // bind FBO object which has this colorbuffer as render target
-        //
-        if (bind_fbo()) {
-
-            //
-            // save current viewport and match it to the current
-            // colorbuffer size
-            //
-            GLint vport[4];
-            s_gl.glGetIntegerv(GL_VIEWPORT, vport);
-            s_gl.glViewport(0, 0, m_width, m_height);
-
-            // render m_blitTex
-            s_gl.glBindTexture(GL_TEXTURE_2D, m_blitTex);
-            s_gl.glEnable(GL_TEXTURE_2D);
-            s_gl.glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-            drawTexQuad(!m_warYInvertBug);
-
-            // unbind the fbo
-            s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
-
-            // restrore previous viewport
-            s_gl.glViewport(vport[0], vport[1], vport[2], vport[3]);
-        }
-
-        // unbind from the FrameBuffer context
-        fb->unbind_locked();
-    }
+    BlitTask task(this, insertGLFence());
+    FrameBuffer::getFB()->getCompositor()->runSync(&task);
 
     //
     // delete the temporary texture and restore the texture binding
@@ -251,6 +226,44 @@ bool ColorBuffer::blitFromCurrentReadBuffer()
     return true;
 }
 
+//
+// Second half of blitFromCurrentReadBuffer, run by the Compositor:
+// render m_blitTex into m_tex.
+//
+void ColorBuffer::blitFromBlitTexture()
+{
+    //
+    // bind FBO object which has this colorbuffer as render target
+    //
+    if (!bind_fbo()) {
+        return;
+    }
+
+    //
+    // save current viewport and match it to the current
+    // colorbuffer size
+    //
+    GLint vport[4];
+    s_gl.glGetIntegerv(GL_VIEWPORT, vport);
+    s_gl.glViewport(0, 0, m_width, m_height);
+
+    // render m_blitTex
+    s_gl.glBindTexture(GL_TEXTURE_2D, m_blitTex);
+    s_gl.glEnable(GL_TEXTURE_2D);
+    s_gl.glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    drawTexQuad(!m_warYInvertBug);
+
+    // unbind the fbo
+    s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+
+    m_lock.lock();
+    m_dirty.setFull(m_width, m_height);
+    m_lock.unlock();
+
+    // restrore previous viewport
+    s_gl.glViewport(vport[0], vport[1], vport[2], vport[3]);
+}
+
 bool ColorBuffer::bindToTexture()
 {
     if (m_eglImage) {
@@ -266,6 +279,9 @@ bool ColorBuffer::bindToTexture()
 #else
             s_gl.glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, m_eglImage);
 #endif
+            // the guest may now render to it, changes are no longer known
+            android::Mutex::Autolock mutex(m_lock);
+            m_untracked = true;
             return true;
         }
     }
@@ -287,6 +303,8 @@ bool ColorBuffer::bindToRenderbuffer()
 #else
             s_gl.glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER_OES, m_eglImage);
 #endif
+            android::Mutex::Autolock mutex(m_lock);
+            m_untracked = true;
             return true;
         }
     }
@@ -357,12 +375,78 @@ void ColorBuffer::drawTexQuad(bool flipy)
 
 void ColorBuffer::readback(unsigned char* img)
 {
-    FrameBuffer *fb = FrameBuffer::getFB();
-    if (fb->bind_locked()) {
-        if (bind_fbo()) {
-            s_gl.glReadPixels(0, 0, m_width, m_height,
-                    GL_RGBA, GL_UNSIGNED_BYTE, img);
+    if (bind_fbo()) {
+        s_gl.glReadPixels(0, 0, m_width, m_height,
+                GL_RGBA, GL_UNSIGNED_BYTE, img);
+        s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+    }
+}
+
+void ColorBuffer::readback(unsigned char* img, int imgWidth,
+                           const DirtyRegion &region)
+{
+    if (bind_fbo()) {
+        readPixels(img, imgWidth, region);
+        s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+    }
+}
+
+void ColorBuffer::readPixels(unsigned char* img, int imgWidth,
+                             const DirtyRegion &region)
+{
+    std::vector<unsigned char> rows;
+    size_t stride = 4 * imgWidth;
+
+    for (int i = 0; i < region.numRects(); i++) {
+        const RenderRect &r = region.rects()[i];
+        unsigned char *dst = img + r.y * stride + 4 * r.x;
+        if (r.x == 0 && r.width == imgWidth) {
+            // whole rows are contiguous in the image
+            s_gl.glReadPixels(0, r.y, r.width, r.height,
+                              GL_RGBA, GL_UNSIGNED_BYTE, dst);
+            continue;
+        }
+
+        //
+        // GLES has no GL_PACK_ROW_LENGTH, read the rectangle packed
+        // and copy its rows into place.
+        //
+        size_t rowLen = 4 * r.width;
+        rows.resize(rowLen * r.height);
+        s_gl.glReadPixels(r.x, r.y, r.width, r.height,
+                          GL_RGBA, GL_UNSIGNED_BYTE, &rows[0]);
+        for (int y = 0; y < r.height; y++) {
+            memcpy(dst + y * stride, &rows[y * rowLen], rowLen);
         }
-        fb->unbind_locked();
     }
 }
+
+void ColorBuffer::takeDirtyRegion(DirtyRegion *p_region)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    if (m_untracked) {
+        p_region->setFull(m_width, m_height);
+    } else {
+        *p_region = m_dirty;
+    }
+    m_dirty.clear();
+}
+
+//
+// Copy the color buffer into the top-left corner of p_tex, a
+// p_width x p_height texture of the FrameBuffer share group.
+//
+bool ColorBuffer::copyToTexture(GLuint p_tex, int p_width, int p_height)
+{
+    if (!bind_fbo()) {
+        return false;
+    }
+
+    int w = (int)m_width < p_width ? (int)m_width : p_width;
+    int h = (int)m_height < p_height ? (int)m_height : p_height;
+    s_gl.glBindTexture(GL_TEXTURE_2D, p_tex);
+    s_gl.glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, w, h);
+    s_gl.glBindTexture(GL_TEXTURE_2D, 0);
+    s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+    return true;
+}
@@ -20,7 +20,16 @@
 #include <EGL/eglext.h>
 #include <GLES/gl.h>
 #include <SmartPtr.h>
+#include <utils/threads.h>
+#include "DirtyRegion.h"
 
+//
+// The GL work of a color buffer is done by the Compositor, in the
+// FrameBuffer pbuffer context: create, subUpdate, post, readback and
+// copyToTexture must be called from a CompositorTask. bindToTexture,
+// bindToRenderbuffer and blitFromCurrentReadBuffer are called with
+// the guest context current.
+//
 class ColorBuffer
 {
 public:
@@ -38,9 +47,21 @@ public:
     bool bindToRenderbuffer();
     bool blitFromCurrentReadBuffer();
     void readback(unsigned char* img);
+    void readback(unsigned char* img, int imgWidth, const DirtyRegion &region);
+    bool copyToTexture(GLuint p_tex, int p_width, int p_height);
+
+    // the region changed since the last call, all of it if unknown
+    void takeDirtyRegion(DirtyRegion *p_region);
+
+    // read 'region' of the bound framebuffer into the RGBA image 'img'
+    static void readPixels(unsigned char* img, int imgWidth,
+                           const DirtyRegion &region);
 
 private:
+    class BlitTask;
+
     ColorBuffer();
+    void blitFromBlitTexture();
     void drawTexQuad(bool flipy);
     bool bind_fbo();  // binds a fbo which have this texture as render target
 
@@ -54,6 +75,9 @@ private:
     GLuint m_fbo;
     GLenum m_internalFormat;
     bool m_warYInvertBug;
+    android::Mutex m_lock;  // protects m_dirty and m_untracked
+    DirtyRegion m_dirty;
+    bool m_untracked;   // bound to a guest texture or renderbuffer
 };
 
 typedef SmartPtr<ColorBuffer> ColorBufferPtr;
@@ -0,0 +1,202 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "Compositor.h"
+#include "EGLDispatch.h"
+#include "GLDispatch.h"
+#include "GLSync.h"
+#include "ErrorLog.h"
+
+Compositor::Compositor(EGLDisplay p_dpy, EGLSurface p_surface,
+                       EGLContext p_context) :
+    osUtils::Thread(),
+    m_dpy(p_dpy),
+    m_surface(p_surface),
+    m_context(p_context),
+    m_nextFence(1),
+    m_lastSignaled(0),
+    m_state(STATE_STARTING),
+    m_exiting(false)
+{
+}
+
+Compositor *Compositor::create(EGLDisplay p_dpy, EGLSurface p_surface,
+                               EGLContext p_context)
+{
+    Compositor *c = new Compositor(p_dpy, p_surface, p_context);
+    if (!c->start()) {
+        ERR("Compositor: failed to start thread\n");
+        delete c;
+        return NULL;
+    }
+
+    c->m_lock.lock();
+    while (c->m_state == STATE_STARTING) {
+        c->m_cond.wait(c->m_lock);
+    }
+    bool ok = (c->m_state == STATE_RUNNING);
+    c->m_lock.unlock();
+
+    if (!ok) {
+        delete c;
+        return NULL;
+    }
+    return c;
+}
+
+Compositor::~Compositor()
+{
+    m_lock.lock();
+    m_exiting = true;
+    m_cond.broadcast();
+    m_lock.unlock();
+
+    int exitStatus;
+    wait(&exitStatus);
+
+    // tasks queued after the thread exited, or when it failed to start
+    while (!m_queue.empty()) {
+        if (m_queue.front().owned) {
+            delete m_queue.front().task;
+        }
+        m_queue.pop_front();
+    }
+}
+
+bool Compositor::isCompositorThread() const
+{
+#ifdef _WIN32
+    return GetCurrentThreadId() == m_threadId;
+#else
+    return pthread_equal(pthread_self(), m_threadId) != 0;
+#endif
+}
+
+unsigned int Compositor::queue_locked(CompositorTask *p_task, bool p_owned)
+{
+    Entry e;
+    e.task = p_task;
+    e.fence = m_nextFence++;
+    e.owned = p_owned;
+    m_queue.push_back(e);
+    m_cond.broadcast();
+    return e.fence;
+}
+
+unsigned int Compositor::submit(CompositorTask *p_task)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    return queue_locked(p_task, true);
+}
+
+void Compositor::waitFence(unsigned int p_fence)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    while ((int)(m_lastSignaled - p_fence) < 0 &&
+           m_state == STATE_RUNNING) {
+        m_cond.wait(m_lock);
+    }
+}
+
+void Compositor::waitIdle()
+{
+    if (isCompositorThread()) {
+        // the running task would wait for itself
+        return;
+    }
+
+    m_lock.lock();
+    unsigned int fence = m_nextFence - 1;
+    m_lock.unlock();
+
+    waitFence(fence);
+}
+
+void Compositor::runSync(CompositorTask *p_task)
+{
+    if (isCompositorThread()) {
+        p_task->run();
+        return;
+    }
+
+    m_lock.lock();
+    unsigned int fence = queue_locked(p_task, false);
+    m_lock.unlock();
+
+    waitFence(fence);
+}
+
+void Compositor::setState(State p_state)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    m_state = p_state;
+    m_cond.broadcast();
+}
+
+int Compositor::Main()
+{
+#ifdef _WIN32
+    m_threadId = GetCurrentThreadId();
+#else
+    m_threadId = pthread_self();
+#endif
+
+    if (!s_egl.eglMakeCurrent(m_dpy, m_surface, m_surface, m_context)) {
+        ERR("Compositor: eglMakeCurrent failed 0x%x\n", s_egl.eglGetError());
+        setState(STATE_FAILED);
+        return -1;
+    }
+    setState(STATE_RUNNING);
+
+    m_lock.lock();
+    while (1) {
+        while (!m_exiting && m_queue.empty()) {
+            m_cond.wait(m_lock);
+        }
+        if (m_queue.empty()) {
+            // exiting with nothing left to run
+            break;
+        }
+        Entry e = m_queue.front();
+        m_queue.pop_front();
+        m_lock.unlock();
+
+        e.task->run();
+        if (e.owned) {
+            delete e.task;
+            s_gl.glFlush();
+        }
+        else {
+            // the waiting thread uses the results from its own context
+            finishGLCommands();
+        }
+
+        m_lock.lock();
+        m_lastSignaled = e.fence;
+        m_cond.broadcast();
+    }
+
+    //
+    // leave the waiters, if any, and release the context so that it
+    // can be destroyed.
+    //
+    m_state = STATE_STOPPED;
+    m_cond.broadcast();
+    m_lock.unlock();
+
+    s_egl.eglMakeCurrent(m_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                         EGL_NO_CONTEXT);
+    return 0;
+}
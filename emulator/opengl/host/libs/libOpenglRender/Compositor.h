@@ -0,0 +1,113 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIBRENDER_COMPOSITOR_H
+#define _LIBRENDER_COMPOSITOR_H
+
+#include "osThread.h"
+#include <utils/threads.h>
+#include <EGL/egl.h>
+#include <deque>
+
+//
+// A piece of GL work for the Compositor, run with the FrameBuffer
+// pbuffer context current.
+//
+class CompositorTask
+{
+public:
+    virtual ~CompositorTask() {}
+    virtual void run() = 0;
+};
+
+//
+// The thread which owns the FrameBuffer pbuffer context and does all
+// the color buffer work of the FrameBuffer: creation, updates, blits,
+// readbacks and posts to the subwindow. RenderThreads queue the work
+// instead of making the FrameBuffer context current themselves, so
+// they never switch contexts and never wait on each other for it.
+//
+// Tasks run one at a time in submission order. Every task gets a
+// fence, a sequence number which is signaled once the task has run.
+// The GL commands of a runSync() task are complete by then, so that
+// the caller can use the results from its own context (GLSync.h).
+//
+class Compositor : public osUtils::Thread
+{
+public:
+    // p_context must not be current on any thread
+    static Compositor *create(EGLDisplay p_dpy, EGLSurface p_surface,
+                              EGLContext p_context);
+
+    // runs the queued tasks then stops the thread
+    ~Compositor();
+
+    //
+    // Queue a task, it is deleted once it has run. Returns its fence.
+    // May be called by any thread, the compositor one included.
+    //
+    unsigned int submit(CompositorTask *p_task);
+
+    // wait until the task of p_fence, and those before it, have run
+    void waitFence(unsigned int p_fence);
+
+    // wait until the tasks queued so far have run, no-op on the
+    // compositor thread
+    void waitIdle();
+
+    //
+    // Run a task and wait for it, the task is not deleted. Runs it
+    // right away when called by the compositor thread itself.
+    //
+    void runSync(CompositorTask *p_task);
+
+    bool isCompositorThread() const;
+
+    virtual int Main();
+
+private:
+    struct Entry {
+        CompositorTask *task;
+        unsigned int fence;
+        bool owned;
+    };
+
+    enum State { STATE_STARTING, STATE_RUNNING, STATE_FAILED, STATE_STOPPED };
+
+    Compositor(EGLDisplay p_dpy, EGLSurface p_surface, EGLContext p_context);
+
+    unsigned int queue_locked(CompositorTask *p_task, bool p_owned);
+    void setState(State p_state);
+
+private:
+    EGLDisplay m_dpy;
+    EGLSurface m_surface;
+    EGLContext m_context;
+
+    android::Mutex m_lock;
+    android::Condition m_cond;  // signaled on queue, fence or state change
+    std::deque<Entry> m_queue;
+    unsigned int m_nextFence;
+    unsigned int m_lastSignaled;
+    State m_state;
+    bool m_exiting;
+#ifdef _WIN32
+    DWORD m_threadId;
+#else
+    pthread_t m_threadId;
+#endif
+};
+
+#endif
@@ -0,0 +1,145 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "DecoderRouter.h"
+
+DecoderRouter::DecoderRouter() :
+    m_numRoutes(0),
+    m_lastRoute(0),
+    m_counting(false)
+{
+    m_routes[0].first = 0;
+    m_routes[0].last = 0;
+}
+
+bool DecoderRouter::addRoute(unsigned int p_first, unsigned int p_last,
+                             void *p_decoder, decode_proc_t p_decode)
+{
+    if (m_numRoutes >= MAX_ROUTES || p_first >= p_last) {
+        return false;
+    }
+
+    for (int i = 0; i < m_numRoutes; i++) {
+        if (p_first < m_routes[i].last && m_routes[i].first < p_last) {
+            ERR("DecoderRouter: opcode range [%u,%u) overlaps [%u,%u)\n",
+                p_first, p_last, m_routes[i].first, m_routes[i].last);
+            return false;
+        }
+    }
+
+    Route &r = m_routes[m_numRoutes++];
+    r.first = p_first;
+    r.last = p_last;
+    r.decoder = p_decoder;
+    r.decode = p_decode;
+    r.counts.assign(p_last - p_first, 0);
+    return true;
+}
+
+size_t DecoderRouter::decode(void *buf, size_t len, IOStream *stream)
+{
+    unsigned char *ptr = (unsigned char *)buf;
+    size_t pos = 0;
+
+    while (len - pos >= 8) {
+        unsigned int opcode = *(unsigned int *)(ptr + pos);
+
+        //
+        // consecutive packets usually belong to the same API,
+        // check the route used last time first.
+        //
+        Route *r = &m_routes[m_lastRoute];
+        if (opcode < r->first || opcode >= r->last) {
+            r = NULL;
+            for (int i = 0; i < m_numRoutes; i++) {
+                if (opcode >= m_routes[i].first && opcode < m_routes[i].last) {
+                    r = &m_routes[i];
+                    m_lastRoute = i;
+                    break;
+                }
+            }
+            if (!r) {
+                // unknown opcode
+                break;
+            }
+        }
+
+        //
+        // the decoder processes packets until it reaches an opcode it
+        // does not own or an incomplete packet.
+        //
+        size_t n = r->decode(r->decoder, ptr + pos, len - pos, stream);
+        if (n == 0) {
+            break;
+        }
+        if (m_counting) {
+            countPackets(r, ptr + pos, n);
+        }
+        pos += n;
+    }
+
+    return pos;
+}
+
+size_t DecoderRouter::packetsLength(const void *buf, size_t len)
+{
+    const unsigned char *ptr = (const unsigned char *)buf;
+    size_t pos = 0;
+
+    while (len - pos >= 8) {
+        unsigned int packetLen = *(const unsigned int *)(ptr + pos + 4);
+        if (packetLen < 8 || len - pos < packetLen) {
+            break;
+        }
+        pos += packetLen;
+    }
+    return pos;
+}
+
+//
+// The decoder of r consumed the whole packets in [buf, buf+len), all
+// of them with an opcode of r.
+//
+void DecoderRouter::countPackets(Route *r, const unsigned char *buf, size_t len)
+{
+    size_t pos = 0;
+    while (pos < len) {
+        unsigned int opcode = *(const unsigned int *)(buf + pos);
+        unsigned int packetLen = *(const unsigned int *)(buf + pos + 4);
+        if (packetLen < 8 || opcode < r->first || opcode >= r->last) {
+            break;
+        }
+        if (r->counts[opcode - r->first]++ == 0) {
+            m_counted.push_back(opcode);
+        }
+        pos += packetLen;
+    }
+}
+
+void DecoderRouter::takeCounts(count_proc_t p_count, void *p_context)
+{
+    for (size_t i = 0; i < m_counted.size(); i++) {
+        unsigned int opcode = m_counted[i];
+        for (int j = 0; j < m_numRoutes; j++) {
+            Route &r = m_routes[j];
+            if (opcode >= r.first && opcode < r.last) {
+                p_count(p_context, opcode, r.counts[opcode - r.first]);
+                r.counts[opcode - r.first] = 0;
+                break;
+            }
+        }
+    }
+    m_counted.clear();
+}
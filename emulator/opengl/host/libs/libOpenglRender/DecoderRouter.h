@@ -0,0 +1,100 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_DECODER_ROUTER_H
+#define _LIB_OPENGL_RENDER_DECODER_ROUTER_H
+
+#include "IOStream.h"
+#include <vector>
+
+//
+// DecoderRouter hands each packet of a command stream to the decoder
+// which owns its opcode, instead of offering the stream to every decoder
+// in turn. Decoders are registered with the opcode range emugen
+// generated for them (baseOpcode/lastOpcode of the decoder context).
+//
+class DecoderRouter
+{
+public:
+    typedef size_t (*decode_proc_t)(void *decoder, void *buf, size_t len,
+                                    IOStream *stream);
+
+    DecoderRouter();
+
+    //
+    // Register a decoder for opcodes in [p_first, p_last).
+    // Returns false if the route table is full or the range overlaps
+    // an already registered one.
+    //
+    bool addRoute(unsigned int p_first, unsigned int p_last,
+                  void *p_decoder, decode_proc_t p_decode);
+
+    template <class T>
+    bool addDecoder(T *p_decoder) {
+        return addRoute(T::baseOpcode, T::lastOpcode, p_decoder, &decodeWith<T>);
+    }
+
+    //
+    // Decode as many complete packets as possible from buf and return
+    // the number of bytes consumed. Stops on an incomplete packet or on
+    // an opcode no decoder owns.
+    //
+    size_t decode(void *buf, size_t len, IOStream *stream);
+
+    //
+    // The length of the complete packets at the start of buf, what
+    // decode() consumes when every opcode has a decoder.
+    //
+    static size_t packetsLength(const void *buf, size_t len);
+
+    //
+    // Packet counting, off by default: decode() counts the packets it
+    // consumes per opcode, without locking. takeCounts() hands the
+    // counts gathered since its last call to p_count, once per opcode
+    // seen, and clears them.
+    //
+    typedef void (*count_proc_t)(void *context, unsigned int opcode,
+                                 unsigned int count);
+
+    void setCounting(bool p_enable) { m_counting = p_enable; }
+    void takeCounts(count_proc_t p_count, void *p_context);
+
+private:
+    template <class T>
+    static size_t decodeWith(void *decoder, void *buf, size_t len,
+                             IOStream *stream) {
+        return ((T *)decoder)->decode(buf, len, stream);
+    }
+
+    struct Route {
+        unsigned int first;
+        unsigned int last;
+        void *decoder;
+        decode_proc_t decode;
+        std::vector<unsigned int> counts;   // per opcode, while counting
+    };
+
+    void countPackets(Route *r, const unsigned char *buf, size_t len);
+
+    enum { MAX_ROUTES = 8 };
+
+    Route m_routes[MAX_ROUTES];
+    int m_numRoutes;
+    int m_lastRoute;
+    bool m_counting;
+    std::vector<unsigned int> m_counted;    // opcodes with a count
+};
+
+#endif
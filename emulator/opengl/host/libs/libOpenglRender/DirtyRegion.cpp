@@ -0,0 +1,100 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "DirtyRegion.h"
+
+static bool rectsOverlap(const RenderRect &a, const RenderRect &b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+static void rectUnion(RenderRect &a, const RenderRect &b)
+{
+    int x0 = a.x < b.x ? a.x : b.x;
+    int y0 = a.y < b.y ? a.y : b.y;
+    int x1 = a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width;
+    int y1 = a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height;
+    a.x = x0;
+    a.y = y0;
+    a.width = x1 - x0;
+    a.height = y1 - y0;
+}
+
+void DirtyRegion::addRect(int x, int y, int width, int height)
+{
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    RenderRect r = { x, y, width, height };
+
+    //
+    // absorb every rectangle the new one overlaps, the grown rectangle
+    // may overlap ones that were checked already so start over.
+    //
+    int i = 0;
+    while (i < m_numRects) {
+        if (rectsOverlap(m_rects[i], r)) {
+            rectUnion(r, m_rects[i]);
+            m_rects[i] = m_rects[--m_numRects];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    if (m_numRects == MAX_RECTS) {
+        for (i = 0; i < m_numRects; i++) {
+            rectUnion(r, m_rects[i]);
+        }
+        m_numRects = 0;
+    }
+    m_rects[m_numRects++] = r;
+}
+
+void DirtyRegion::addRegion(const DirtyRegion &r)
+{
+    for (int i = 0; i < r.m_numRects; i++) {
+        const RenderRect &rect = r.m_rects[i];
+        addRect(rect.x, rect.y, rect.width, rect.height);
+    }
+}
+
+void DirtyRegion::setFull(int width, int height)
+{
+    clear();
+    addRect(0, 0, width, height);
+}
+
+void DirtyRegion::clip(int width, int height)
+{
+    int n = 0;
+    for (int i = 0; i < m_numRects; i++) {
+        RenderRect r = m_rects[i];
+        int x1 = r.x + r.width;
+        int y1 = r.y + r.height;
+        if (r.x < 0) r.x = 0;
+        if (r.y < 0) r.y = 0;
+        if (x1 > width) x1 = width;
+        if (y1 > height) y1 = height;
+        if (x1 > r.x && y1 > r.y) {
+            r.width = x1 - r.x;
+            r.height = y1 - r.y;
+            m_rects[n++] = r;
+        }
+    }
+    m_numRects = n;
+}
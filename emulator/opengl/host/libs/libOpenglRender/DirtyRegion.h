@@ -0,0 +1,52 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIBRENDER_DIRTY_REGION_H
+#define _LIBRENDER_DIRTY_REGION_H
+
+#include "libOpenglRender/render_api.h"
+
+//
+// A set of non overlapping rectangles, the 2D counterpart of the
+// Translator's RangeList. Overlapping rectangles are merged into their
+// bounding box when added, and the whole region collapses into a single
+// bounding box when it would need more than MAX_RECTS rectangles, so a
+// region never costs more than a fixed amount of memory and work.
+//
+class DirtyRegion
+{
+public:
+    enum { MAX_RECTS = 16 };
+
+    DirtyRegion() : m_numRects(0) {}
+
+    void clear() { m_numRects = 0; }
+    bool empty() const { return m_numRects == 0; }
+    int numRects() const { return m_numRects; }
+    const RenderRect *rects() const { return m_rects; }
+
+    void addRect(int x, int y, int width, int height);
+    void addRegion(const DirtyRegion &r);
+    void setFull(int width, int height);
+
+    // clip every rectangle to [0, width) x [0, height)
+    void clip(int width, int height);
+
+private:
+    RenderRect m_rects[MAX_RECTS];
+    int m_numRects;
+};
+
+#endif
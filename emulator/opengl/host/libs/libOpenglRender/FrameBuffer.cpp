@@ -24,7 +24,145 @@
 #include "TimeUtils.h"
 
 FrameBuffer *FrameBuffer::s_theFrameBuffer = NULL;
-HandleType FrameBuffer::s_nextHandle = 0;
+
+class FrameBuffer::CreateColorBufferTask : public CompositorTask
+{
+public:
+    CreateColorBufferTask(int p_width, int p_height, GLenum p_internalFormat) :
+        m_width(p_width), m_height(p_height),
+        m_internalFormat(p_internalFormat), m_cb(NULL) {}
+
+    virtual void run() {
+        m_cb = ColorBuffer::create(m_width, m_height, m_internalFormat);
+    }
+
+    ColorBuffer *result() const { return m_cb; }
+
+private:
+    int m_width;
+    int m_height;
+    GLenum m_internalFormat;
+    ColorBuffer *m_cb;
+};
+
+//
+// Synchronous, the pixels are in the RenderThread read buffer.
+//
+class FrameBuffer::UpdateColorBufferTask : public CompositorTask
+{
+public:
+    UpdateColorBufferTask(ColorBuffer *p_cb, int p_x, int p_y,
+                          int p_width, int p_height,
+                          GLenum p_format, GLenum p_type, void *p_pixels) :
+        m_cb(p_cb), m_x(p_x), m_y(p_y), m_width(p_width), m_height(p_height),
+        m_format(p_format), m_type(p_type), m_pixels(p_pixels) {}
+
+    virtual void run() {
+        m_cb->subUpdate(m_x, m_y, m_width, m_height,
+                        m_format, m_type, m_pixels);
+    }
+
+private:
+    ColorBuffer *m_cb;
+    int m_x;
+    int m_y;
+    int m_width;
+    int m_height;
+    GLenum m_format;
+    GLenum m_type;
+    void *m_pixels;
+};
+
+class FrameBuffer::SetupSubWindowTask : public CompositorTask
+{
+public:
+    SetupSubWindowTask(FrameBuffer *p_fb, int p_width, int p_height,
+                       float p_zRot) :
+        m_fb(p_fb), m_width(p_width), m_height(p_height), m_zRot(p_zRot),
+        m_success(false) {}
+
+    virtual void run() {
+        m_fb->m_lock.lock();
+        if (m_fb->m_subWin && m_fb->bindSubwin_locked()) {
+            // update viewport and z rotation and draw
+            // the last posted color buffer.
+            s_gl.glViewport(0, 0, m_width, m_height);
+            m_fb->m_zRot = m_zRot;
+            m_fb->unbindSubwin_locked();
+            m_success = true;
+        }
+        HandleType last = m_fb->m_lastPostedColorBuffer;
+        m_fb->m_lock.unlock();
+
+        ColorBufferPtr cb;
+        if (m_success && m_fb->getColorBuffer(last, &cb)) {
+            m_fb->postAndReadback(last, cb.Ptr());
+        }
+    }
+
+    bool success() const { return m_success; }
+
+private:
+    FrameBuffer *m_fb;
+    int m_width;
+    int m_height;
+    float m_zRot;
+    bool m_success;
+};
+
+//
+// Asynchronous, holds a reference to the posted color buffer.
+//
+class FrameBuffer::PostTask : public CompositorTask
+{
+public:
+    PostTask(FrameBuffer *p_fb, HandleType p_colorbuffer, ColorBufferPtr p_cb,
+             GLsync p_fence) :
+        m_fb(p_fb), m_colorbuffer(p_colorbuffer), m_cb(p_cb), m_fence(p_fence) {}
+
+    virtual void run() {
+        waitGLFence(m_fence);
+        m_fb->postAndReadback(m_colorbuffer, m_cb.Ptr());
+    }
+
+private:
+    FrameBuffer *m_fb;
+    HandleType m_colorbuffer;
+    ColorBufferPtr m_cb;
+    GLsync m_fence;
+};
+
+class FrameBuffer::ReleaseTask : public CompositorTask
+{
+public:
+    ReleaseTask(EGLDisplay p_dpy, EGLImageKHR p_eglImage,
+                EGLImageKHR p_blitEGLImage,
+                GLuint p_fbo, GLuint p_tex, GLuint p_blitTex) :
+        m_dpy(p_dpy), m_eglImage(p_eglImage), m_blitEGLImage(p_blitEGLImage),
+        m_fbo(p_fbo), m_tex(p_tex), m_blitTex(p_blitTex) {}
+
+    virtual void run() {
+        if (m_blitEGLImage) {
+            s_egl.eglDestroyImageKHR(m_dpy, m_blitEGLImage);
+        }
+        if (m_eglImage) {
+            s_egl.eglDestroyImageKHR(m_dpy, m_eglImage);
+        }
+        if (m_fbo) {
+            s_gl.glDeleteFramebuffersOES(1, &m_fbo);
+        }
+        GLuint tex[2] = {m_tex, m_blitTex};
+        s_gl.glDeleteTextures(2, tex);
+    }
+
+private:
+    EGLDisplay m_dpy;
+    EGLImageKHR m_eglImage;
+    EGLImageKHR m_blitEGLImage;
+    GLuint m_fbo;
+    GLuint m_tex;
+    GLuint m_blitTex;
+};
 
 #ifdef WITH_GLES2
 static const char *getGLES2ExtensionString(EGLDisplay p_dpy)
@@ -89,10 +227,22 @@ static const char *getGLES2ExtensionString(EGLDisplay p_dpy)
 
 void FrameBuffer::finalize(){
     if(s_theFrameBuffer){
+        // no post may still use what is torn down below
+        s_theFrameBuffer->m_compositor->waitIdle();
+
+        s_theFrameBuffer->m_lock.lock();
+        PostReadback *postReadback = s_theFrameBuffer->m_postReadback;
+        s_theFrameBuffer->m_postReadback = NULL;
+        s_theFrameBuffer->m_lock.unlock();
+        s_theFrameBuffer->releasePostReadback(postReadback);
+
         s_theFrameBuffer->removeSubWindow();
         s_theFrameBuffer->m_colorbuffers.clear();
         s_theFrameBuffer->m_windows.clear();
         s_theFrameBuffer->m_contexts.clear();
+        // runs the deletion of the color buffers released above
+        delete s_theFrameBuffer->m_compositor;
+        s_theFrameBuffer->m_compositor = NULL;
         s_egl.eglMakeCurrent(s_theFrameBuffer->m_eglDisplay, NULL, NULL, NULL);
         s_egl.eglDestroyContext(s_theFrameBuffer->m_eglDisplay,s_theFrameBuffer->m_eglContext);
         s_egl.eglDestroyContext(s_theFrameBuffer->m_eglDisplay,s_theFrameBuffer->m_pbufContext);
@@ -242,8 +392,9 @@ bool FrameBuffer::initialize(int width, int height)
         return false;
     }
 
-    // Make the context current
-    if (!fb->bind_locked()) {
+    // Make the context current, until the Compositor takes it
+    if (!s_egl.eglMakeCurrent(fb->m_eglDisplay, fb->m_pbufSurface,
+                              fb->m_pbufSurface, fb->m_pbufContext)) {
         ERR("Failed to make current\n");
         delete fb;
         return false;
@@ -343,7 +494,21 @@ bool FrameBuffer::initialize(int width, int height)
     fb->m_glVersion = (const char*)s_gl.glGetString(GL_VERSION);
 
     // release the FB context
-    fb->unbind_locked();
+    s_egl.eglMakeCurrent(fb->m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                         EGL_NO_CONTEXT);
+
+    //
+    // From now on all the work in the FB contexts is done by
+    // the Compositor thread.
+    //
+    fb->m_compositor = Compositor::create(fb->m_eglDisplay,
+                                          fb->m_pbufSurface,
+                                          fb->m_pbufContext);
+    if (!fb->m_compositor) {
+        ERR("Failed to start the compositor\n");
+        delete fb;
+        return false;
+    }
 
     //
     // Keep the singleton framebuffer pointer
@@ -356,22 +521,29 @@ FrameBuffer::FrameBuffer(int p_width, int p_height) :
     m_width(p_width),
     m_height(p_height),
     m_eglDisplay(EGL_NO_DISPLAY),
+    m_contexts(HANDLE_KIND_CONTEXT),
+    m_windows(HANDLE_KIND_WINDOW),
+    m_colorbuffers(HANDLE_KIND_COLORBUFFER),
     m_eglSurface(EGL_NO_SURFACE),
     m_eglContext(EGL_NO_CONTEXT),
     m_pbufContext(EGL_NO_CONTEXT),
-    m_prevContext(EGL_NO_CONTEXT),
-    m_prevReadSurf(EGL_NO_SURFACE),
-    m_prevDrawSurf(EGL_NO_SURFACE),
+    m_compositor(NULL),
     m_subWin((EGLNativeWindowType)0),
     m_subWinDisplay(NULL),
     m_lastPostedColorBuffer(0),
+    m_postFence(0),
     m_zRot(0.0f),
     m_eglContextInitialized(false),
     m_statsNumFrames(0),
     m_statsStartTime(0LL),
     m_onPost(NULL),
+    m_onPostDamage(NULL),
     m_onPostContext(NULL),
     m_fbImage(NULL),
+    m_postReadback(NULL),
+    m_postReadbackDepth(0),
+    m_postDropPolicy(RENDER_POST_DROP_NEWEST),
+    m_postHistoryCount(0),
     m_glVendor(NULL),
     m_glRenderer(NULL),
     m_glVersion(NULL)
@@ -384,67 +556,193 @@ FrameBuffer::~FrameBuffer()
     free(m_fbImage);
 }
 
-void FrameBuffer::setPostCallback(OnPostFn onPost, void* onPostContext)
+bool FrameBuffer::allocPostImage_locked()
 {
-    android::Mutex::Autolock mutex(m_lock);
-    m_onPost = onPost;
-    m_onPostContext = onPostContext;
-    if (m_onPost && !m_fbImage) {
+    if (!m_fbImage) {
         m_fbImage = (unsigned char*)malloc(4 * m_width * m_height);
         if (!m_fbImage) {
             ERR("out of memory, cancelling OnPost callback");
-            m_onPost = NULL;
-            m_onPostContext = NULL;
-            return;
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrameBuffer::setPostCallback(OnPostFn onPost, void* onPostContext)
+{
+    m_lock.lock();
+    m_onPost = onPost;
+    m_onPostDamage = NULL;
+    m_onPostContext = onPostContext;
+    if (m_onPost && !allocPostImage_locked()) {
+        m_onPost = NULL;
+        m_onPostContext = NULL;
+    }
+    PostReadback *old = updatePostReadback_locked();
+    m_lock.unlock();
+
+    releasePostReadback(old);
+}
+
+void FrameBuffer::setPostDamageCallback(OnPostDamageFn onPost, void* onPostContext)
+{
+    m_lock.lock();
+    m_onPost = NULL;
+    m_onPostDamage = onPost;
+    m_onPostContext = onPostContext;
+    if (m_onPostDamage && !allocPostImage_locked()) {
+        m_onPostDamage = NULL;
+        m_onPostContext = NULL;
+    }
+    PostReadback *old = updatePostReadback_locked();
+    m_lock.unlock();
+
+    releasePostReadback(old);
+}
+
+bool FrameBuffer::setPostReadbackMode(int depth, int dropPolicy)
+{
+    if (depth < 0 || depth > RENDER_POST_MAX_DEPTH) {
+        return false;
+    }
+    if (dropPolicy != RENDER_POST_DROP_NEWEST &&
+        dropPolicy != RENDER_POST_DROP_OLDEST &&
+        dropPolicy != RENDER_POST_BLOCK) {
+        return false;
+    }
+
+    m_lock.lock();
+    m_postReadbackDepth = depth;
+    m_postDropPolicy = dropPolicy;
+    PostReadback *old = updatePostReadback_locked();
+    m_lock.unlock();
+
+    releasePostReadback(old);
+    return true;
+}
+
+//
+// (re)create the asynchronous readback for the current callback and
+// mode. Posting falls back to a synchronous readback if it cannot be
+// created. Returns the replaced one, for releasePostReadback() once
+// m_lock is released: its thread may be in a callback which calls
+// back into the FrameBuffer.
+//
+PostReadback *FrameBuffer::updatePostReadback_locked()
+{
+    PostReadback *old = m_postReadback;
+    m_postReadback = NULL;
+
+    // the next frame is delivered into a new or stale image
+    m_postHistoryCount = 0;
+
+    if ((m_onPost || m_onPostDamage) && m_postReadbackDepth > 0) {
+        m_postReadback = PostReadback::create(m_eglDisplay, m_eglConfig,
+                                              m_eglContext,
+                                              m_width, m_height,
+                                              m_postReadbackDepth,
+                                              m_postDropPolicy,
+                                              m_onPost, m_onPostDamage,
+                                              m_onPostContext);
+        if (!m_postReadback) {
+            ERR("Failed to start the asynchronous post readback\n");
+        }
+    }
+    return old;
+}
+
+//
+// Posts use the PostReadback without m_lock held, wait for the queued
+// ones before deleting it.
+//
+void FrameBuffer::releasePostReadback(PostReadback *p_postReadback)
+{
+    if (p_postReadback) {
+        m_compositor->waitIdle();
+        delete p_postReadback;
+    }
+}
+
+//
+// The posted color buffer differs from the previous frame by what
+// changed in it since it was last posted, plus what changed between
+// the frames posted since then (the color buffers of a window surface
+// are posted in turn). If it was not posted recently, assume it all
+// changed.
+//
+void FrameBuffer::computePostDamage_locked(HandleType p_colorbuffer,
+                                           ColorBuffer *p_cb,
+                                           DirtyRegion *p_damage)
+{
+    p_cb->takeDirtyRegion(p_damage);
+
+    int i = m_postHistoryCount - 1;
+    while (i >= 0 && m_postHistory[i].cb != p_colorbuffer) {
+        p_damage->addRegion(m_postHistory[i].damage);
+        i--;
+    }
+    if (i < 0) {
+        p_damage->setFull(m_width, m_height);
+    }
+    p_damage->clip(m_width, m_height);
+
+    if (m_postHistoryCount == POST_HISTORY_SIZE) {
+        for (i = 1; i < POST_HISTORY_SIZE; i++) {
+            m_postHistory[i - 1] = m_postHistory[i];
         }
+        m_postHistoryCount--;
     }
+    m_postHistory[m_postHistoryCount].cb = p_colorbuffer;
+    m_postHistory[m_postHistoryCount].damage = *p_damage;
+    m_postHistoryCount++;
 }
 
 bool FrameBuffer::setupSubWindow(FBNativeWindowType p_window,
                                   int p_x, int p_y,
                                   int p_width, int p_height, float zRot)
 {
-    bool success = false;
+    FrameBuffer *fb = s_theFrameBuffer;
+    if (!fb) {
+        return false;
+    }
 
-    if (s_theFrameBuffer) {
-        s_theFrameBuffer->m_lock.lock();
-        FrameBuffer *fb = s_theFrameBuffer;
-        if (!fb->m_subWin) {
-
-            // create native subwindow for FB display output
-            fb->m_subWin = createSubWindow(p_window,
-                                           &fb->m_subWinDisplay,
-                                           p_x,p_y,p_width,p_height);
-            if (fb->m_subWin) {
-                fb->m_nativeWindow = p_window;
-
-                // create EGLSurface from the generated subwindow
-                fb->m_eglSurface = s_egl.eglCreateWindowSurface(fb->m_eglDisplay, 
-                                                    fb->m_eglConfig,
-                                                    fb->m_subWin,
-                                                    NULL);
-
-                if (fb->m_eglSurface == EGL_NO_SURFACE) {
-                    ERR("Failed to create surface\n");
-                    destroySubWindow(fb->m_subWinDisplay, fb->m_subWin);
-                    fb->m_subWin = (EGLNativeWindowType)0;
-                }
-                else if (fb->bindSubwin_locked()) {
-                    // Subwin creation was successfull,
-                    // update viewport and z rotation and draw
-                    // the last posted color buffer.
-                    s_gl.glViewport(0, 0, p_width, p_height);
-                    fb->m_zRot = zRot;
-                    fb->post( fb->m_lastPostedColorBuffer, false );
-                    fb->unbind_locked();
-                    success = true;
-                }
-             }
+    fb->m_lock.lock();
+    bool created = false;
+    if (!fb->m_subWin) {
+
+        // create native subwindow for FB display output
+        fb->m_subWin = createSubWindow(p_window,
+                                       &fb->m_subWinDisplay,
+                                       p_x,p_y,p_width,p_height);
+        if (fb->m_subWin) {
+            fb->m_nativeWindow = p_window;
+
+            // create EGLSurface from the generated subwindow
+            fb->m_eglSurface = s_egl.eglCreateWindowSurface(fb->m_eglDisplay,
+                                                fb->m_eglConfig,
+                                                fb->m_subWin,
+                                                NULL);
+
+            if (fb->m_eglSurface == EGL_NO_SURFACE) {
+                ERR("Failed to create surface\n");
+                destroySubWindow(fb->m_subWinDisplay, fb->m_subWin);
+                fb->m_subWin = (EGLNativeWindowType)0;
+            }
+            else {
+                created = true;
+            }
         }
-        s_theFrameBuffer->m_lock.unlock();
-     }
+    }
+    fb->m_lock.unlock();
 
-    return success;
+    if (!created) {
+        return false;
+    }
+
+    // Subwin creation was successfull, the Compositor draws in it
+    SetupSubWindowTask task(fb, p_width, p_height, zRot);
+    fb->m_compositor->runSync(&task);
+    return task.success();
 }
 
 bool FrameBuffer::removeSubWindow()
@@ -453,7 +751,7 @@ bool FrameBuffer::removeSubWindow()
     if (s_theFrameBuffer) {
         s_theFrameBuffer->m_lock.lock();
         if (s_theFrameBuffer->m_subWin) {
-            s_egl.eglMakeCurrent(s_theFrameBuffer->m_eglDisplay, NULL, NULL, NULL);
+            // the Compositor only has it current while holding m_lock
             s_egl.eglDestroySurface(s_theFrameBuffer->m_eglDisplay,
                                     s_theFrameBuffer->m_eglSurface);
             destroySubWindow(s_theFrameBuffer->m_subWinDisplay,
@@ -468,29 +766,30 @@ bool FrameBuffer::removeSubWindow()
     return removed;
 }
 
-HandleType FrameBuffer::genHandle()
+bool FrameBuffer::getColorBuffer(HandleType p_colorbuffer, ColorBufferPtr *p_cb)
 {
-    HandleType id;
-    do {
-        id = ++s_nextHandle;
-    } while( id == 0 ||
-             m_contexts.find(id) != m_contexts.end() ||
-             m_windows.find(id) != m_windows.end() );
-
-    return id;
+    ColorBufferRef ref;
+    if (!m_colorbuffers.get(p_colorbuffer, &ref)) {
+        // bad colorbuffer handle
+        return false;
+    }
+    *p_cb = ref.cb;
+    return true;
 }
 
 HandleType FrameBuffer::createColorBuffer(int p_width, int p_height,
                                           GLenum p_internalFormat)
 {
-    android::Mutex::Autolock mutex(m_lock);
-    HandleType ret = 0;
+    CreateColorBufferTask task(p_width, p_height, p_internalFormat);
+    m_compositor->runSync(&task);
 
-    ColorBufferPtr cb( ColorBuffer::create(p_width, p_height, p_internalFormat) );
-    if (cb.Ptr() != NULL) {
-        ret = genHandle();
-        m_colorbuffers[ret].cb = cb;
-        m_colorbuffers[ret].refcount = 1;
+    ColorBufferRef ref;
+    ref.cb = ColorBufferPtr( task.result() );
+
+    HandleType ret = 0;
+    if (ref.cb.Ptr() != NULL) {
+        ref.refcount = 1;
+        ret = m_colorbuffers.add(ref);
     }
     return ret;
 }
@@ -498,35 +797,28 @@ HandleType FrameBuffer::createColorBuffer(int p_width, int p_height,
 HandleType FrameBuffer::createRenderContext(int p_config, HandleType p_share,
                                             bool p_isGL2)
 {
-    android::Mutex::Autolock mutex(m_lock);
     HandleType ret = 0;
 
     RenderContextPtr share(NULL);
     if (p_share != 0) {
-        RenderContextMap::iterator s( m_contexts.find(p_share) );
-        if (s == m_contexts.end()) {
+        if (!m_contexts.get(p_share, &share)) {
             return 0;
         }
-        share = (*s).second;
     }
 
     RenderContextPtr rctx( RenderContext::create(p_config, share, p_isGL2) );
     if (rctx.Ptr() != NULL) {
-        ret = genHandle();
-        m_contexts[ret] = rctx;
+        ret = m_contexts.add(rctx);
     }
     return ret;
 }
 
 HandleType FrameBuffer::createWindowSurface(int p_config, int p_width, int p_height)
 {
-    android::Mutex::Autolock mutex(m_lock);
-
     HandleType ret = 0;
     WindowSurfacePtr win( WindowSurface::create(p_config, p_width, p_height) );
     if (win.Ptr() != NULL) {
-        ret = genHandle();
-        m_windows[ret] = win;
+        ret = m_windows.add(win);
     }
 
     return ret;
@@ -534,51 +826,50 @@ HandleType FrameBuffer::createWindowSurface(int p_config, int p_width, int p_hei
 
 void FrameBuffer::DestroyRenderContext(HandleType p_context)
 {
-    android::Mutex::Autolock mutex(m_lock);
-    m_contexts.erase(p_context);
+    m_contexts.remove(p_context);
 }
 
 void FrameBuffer::DestroyWindowSurface(HandleType p_surface)
 {
-    android::Mutex::Autolock mutex(m_lock);
-    m_windows.erase(p_surface);
+    m_windows.remove(p_surface);
 }
 
 void FrameBuffer::openColorBuffer(HandleType p_colorbuffer)
 {
-    android::Mutex::Autolock mutex(m_lock);
-    ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-    if (c == m_colorbuffers.end()) {
+    ColorBufferTable::Stripe &s = m_colorbuffers.stripeFor(p_colorbuffer);
+    android::Mutex::Autolock mutex(s.lock);
+    ColorBufferRef *ref = s.registry.lookup(p_colorbuffer);
+    if (!ref) {
         // bad colorbuffer handle
         return;
     }
-    (*c).second.refcount++;
+    ref->refcount++;
 }
 
 void FrameBuffer::closeColorBuffer(HandleType p_colorbuffer)
 {
-    android::Mutex::Autolock mutex(m_lock);
-    ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
-    if (c == m_colorbuffers.end()) {
+    ColorBufferTable::Stripe &s = m_colorbuffers.stripeFor(p_colorbuffer);
+    android::Mutex::Autolock mutex(s.lock);
+    ColorBufferRef *ref = s.registry.lookup(p_colorbuffer);
+    if (!ref) {
         // bad colorbuffer handle
         return;
     }
-    if (--(*c).second.refcount == 0) {
-        m_colorbuffers.erase(c);
+    if (--ref->refcount == 0) {
+        s.registry.remove(p_colorbuffer);
     }
 }
 
 bool FrameBuffer::flushWindowSurfaceColorBuffer(HandleType p_surface)
 {
-    android::Mutex::Autolock mutex(m_lock);
-
-    WindowSurfaceMap::iterator w( m_windows.find(p_surface) );
-    if (w == m_windows.end()) {
+    WindowSurfacePtr win;
+    if (!m_windows.get(p_surface, &win)) {
         // bad surface handle
         return false;
     }
 
-    (*w).second->flushColorBuffer();
+    // the blit renders with the Compositor
+    win->flushColorBuffer();
 
     return true;
 }
@@ -586,21 +877,18 @@ bool FrameBuffer::flushWindowSurfaceColorBuffer(HandleType p_surface)
 bool FrameBuffer::setWindowSurfaceColorBuffer(HandleType p_surface,
                                               HandleType p_colorbuffer)
 {
-    android::Mutex::Autolock mutex(m_lock);
-
-    WindowSurfaceMap::iterator w( m_windows.find(p_surface) );
-    if (w == m_windows.end()) {
+    WindowSurfacePtr win;
+    if (!m_windows.get(p_surface, &win)) {
         // bad surface handle
         return false;
     }
 
-    ColorBufferMap::iterator c( m_colorbuffers.find(p_colorbuffer) );
-    if (c == m_colorbuffers.end()) {
-        // bad colorbuffer handle
+    ColorBufferPtr cb;
+    if (!getColorBuffer(p_colorbuffer, &cb)) {
         return false;
     }
 
-    (*w).second->setColorBuffer( (*c).second.cb );
+    win->setColorBuffer(cb);
 
     return true;
 }
@@ -609,51 +897,42 @@ bool FrameBuffer::updateColorBuffer(HandleType p_colorbuffer,
                                     int x, int y, int width, int height,
                                     GLenum format, GLenum type, void *pixels)
 {
-    android::Mutex::Autolock mutex(m_lock);
-
-    ColorBufferMap::iterator c( m_colorbuffers.find(p_colorbuffer) );
-    if (c == m_colorbuffers.end()) {
-        // bad colorbuffer handle
+    ColorBufferPtr cb;
+    if (!getColorBuffer(p_colorbuffer, &cb)) {
         return false;
     }
 
-    (*c).second.cb->subUpdate(x, y, width, height, format, type, pixels);
+    UpdateColorBufferTask task(cb.Ptr(), x, y, width, height,
+                               format, type, pixels);
+    m_compositor->runSync(&task);
 
     return true;
 }
 
 bool FrameBuffer::bindColorBufferToTexture(HandleType p_colorbuffer)
 {
-    android::Mutex::Autolock mutex(m_lock);
-
-    ColorBufferMap::iterator c( m_colorbuffers.find(p_colorbuffer) );
-    if (c == m_colorbuffers.end()) {
-        // bad colorbuffer handle
+    ColorBufferPtr cb;
+    if (!getColorBuffer(p_colorbuffer, &cb)) {
         return false;
     }
 
-    return (*c).second.cb->bindToTexture();
+    return cb->bindToTexture();
 }
 
 bool FrameBuffer::bindColorBufferToRenderbuffer(HandleType p_colorbuffer)
 {
-    android::Mutex::Autolock mutex(m_lock);
-
-    ColorBufferMap::iterator c( m_colorbuffers.find(p_colorbuffer) );
-    if (c == m_colorbuffers.end()) {
-        // bad colorbuffer handle
+    ColorBufferPtr cb;
+    if (!getColorBuffer(p_colorbuffer, &cb)) {
         return false;
     }
 
-    return (*c).second.cb->bindToRenderbuffer();
+    return cb->bindToRenderbuffer();
 }
 
 bool FrameBuffer::bindContext(HandleType p_context,
                               HandleType p_drawSurface,
                               HandleType p_readSurface)
 {
-    android::Mutex::Autolock mutex(m_lock);
-
     WindowSurfacePtr draw(NULL), read(NULL);
     RenderContextPtr ctx(NULL);
 
@@ -661,27 +940,21 @@ bool FrameBuffer::bindContext(HandleType p_context,
     // if this is not an unbind operation - make sure all handles are good
     //
     if (p_context || p_drawSurface || p_readSurface) {
-        RenderContextMap::iterator r( m_contexts.find(p_context) );
-        if (r == m_contexts.end()) {
+        if (!m_contexts.get(p_context, &ctx)) {
             // bad context handle
             return false;
         }
 
-        ctx = (*r).second;
-        WindowSurfaceMap::iterator w( m_windows.find(p_drawSurface) );
-        if (w == m_windows.end()) {
+        if (!m_windows.get(p_drawSurface, &draw)) {
             // bad surface handle
             return false;
         }
-        draw = (*w).second;
 
         if (p_readSurface != p_drawSurface) {
-            WindowSurfaceMap::iterator w( m_windows.find(p_readSurface) );
-            if (w == m_windows.end()) {
+            if (!m_windows.get(p_readSurface, &read)) {
                 // bad surface handle
                 return false;
             }
-            read = (*w).second;
         }
         else {
             read = draw;
@@ -735,32 +1008,11 @@ bool FrameBuffer::bindContext(HandleType p_context,
 }
 
 //
-// The framebuffer lock should be held when calling this function !
+// Called by the Compositor, with m_lock held. Until the matching
+// unbindSubwin_locked() the pbuffer context is not current.
 //
-bool FrameBuffer::bind_locked()
-{
-    EGLContext prevContext = s_egl.eglGetCurrentContext();
-    EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
-    EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
-
-    if (!s_egl.eglMakeCurrent(m_eglDisplay, m_pbufSurface,
-                              m_pbufSurface, m_pbufContext)) {
-        ERR("eglMakeCurrent failed\n");
-        return false;
-    }
-
-    m_prevContext = prevContext;
-    m_prevReadSurf = prevReadSurf;
-    m_prevDrawSurf = prevDrawSurf;
-    return true;
-}
-
 bool FrameBuffer::bindSubwin_locked()
 {
-    EGLContext prevContext = s_egl.eglGetCurrentContext();
-    EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
-    EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
-
     if (!s_egl.eglMakeCurrent(m_eglDisplay, m_eglSurface,
                               m_eglSurface, m_eglContext)) {
         ERR("eglMakeCurrent failed\n");
@@ -775,93 +1027,165 @@ bool FrameBuffer::bindSubwin_locked()
         m_eglContextInitialized = true;
     }
 
-    m_prevContext = prevContext;
-    m_prevReadSurf = prevReadSurf;
-    m_prevDrawSurf = prevDrawSurf;
     return true;
 }
 
-bool FrameBuffer::unbind_locked()
+bool FrameBuffer::unbindSubwin_locked()
+{
+    return s_egl.eglMakeCurrent(m_eglDisplay, m_pbufSurface,
+                                m_pbufSurface, m_pbufContext);
+}
+
+void FrameBuffer::releaseColorBufferObjects(EGLImageKHR p_eglImage,
+                                            EGLImageKHR p_blitEGLImage,
+                                            GLuint p_fbo,
+                                            GLuint p_tex,
+                                            GLuint p_blitTex)
+{
+    if (m_compositor) {
+        m_compositor->submit(new ReleaseTask(m_eglDisplay,
+                                             p_eglImage, p_blitEGLImage,
+                                             p_fbo, p_tex, p_blitTex));
+    }
+}
+
+bool FrameBuffer::post(HandleType p_colorbuffer, GLsync p_fence)
 {
-    if (!s_egl.eglMakeCurrent(m_eglDisplay, m_prevDrawSurf,
-                              m_prevReadSurf, m_prevContext)) {
+    ColorBufferPtr cb;
+    if (!getColorBuffer(p_colorbuffer, &cb)) {
+        deleteGLFence(p_fence);
+        return false;
+    }
+
+    m_lock.lock();
+    m_lastPostedColorBuffer = p_colorbuffer;
+    bool hasSubWin = m_subWin != 0;
+    unsigned int prevFence = m_postFence;
+    m_lock.unlock();
+
+    if (!hasSubWin) {
+        // no subwindow created for the FB output
+        // cannot post the colorbuffer
+        deleteGLFence(p_fence);
         return false;
     }
 
-    m_prevContext = EGL_NO_CONTEXT;
-    m_prevReadSurf = EGL_NO_SURFACE;
-    m_prevDrawSurf = EGL_NO_SURFACE;
+    if (prevFence) {
+        m_compositor->waitFence(prevFence);
+    }
+
+    unsigned int fence = m_compositor->submit(new PostTask(this, p_colorbuffer, cb,
+                                                             p_fence));
+
+    m_lock.lock();
+    m_postFence = fence;
+    m_lock.unlock();
     return true;
 }
 
-bool FrameBuffer::post(HandleType p_colorbuffer, bool needLock)
+//
+// Called by the Compositor. The asynchronous readback may wait for a
+// free slot, it gets the frame once m_lock is released.
+//
+bool FrameBuffer::postAndReadback(HandleType p_colorbuffer, ColorBuffer *p_cb)
 {
-    if (needLock) m_lock.lock();
-    bool ret = false;
+    PostReadback *postReadback = NULL;
+    DirtyRegion damage;
 
-    ColorBufferMap::iterator c( m_colorbuffers.find(p_colorbuffer) );
-    if (c != m_colorbuffers.end()) {
+    m_lock.lock();
+    bool ret = post_locked(p_colorbuffer, p_cb, &postReadback, &damage);
+    m_lock.unlock();
 
-        m_lastPostedColorBuffer = p_colorbuffer;
-        if (!m_subWin) {
-            // no subwindow created for the FB output
-            // cannot post the colorbuffer
-            if (needLock) m_lock.unlock();
-            return ret;
-        }
+    if (postReadback) {
+        postReadback->post(p_cb, damage);
+    }
+    return ret;
+}
+
+//
+// Called by the Compositor with m_lock held. When the frame goes to
+// the asynchronous readback, sets *p_postReadback and *p_damage for
+// the caller to post it there without m_lock.
+//
+bool FrameBuffer::post_locked(HandleType p_colorbuffer, ColorBuffer *p_cb,
+                              PostReadback **p_postReadback,
+                              DirtyRegion *p_damage)
+{
+    bool ret = false;
+    if (!m_subWin) {
+        // removed since the post was queued
+        return false;
+    }
 
+    // bind the subwindow eglSurface
+    if (!bindSubwin_locked()) {
+        ERR("FrameBuffer::post eglMakeCurrent failed\n");
+        return false;
+    }
 
-        // bind the subwindow eglSurface
-        if (!bindSubwin_locked()) {
-            ERR("FrameBuffer::post eglMakeCurrent failed\n");
-            if (needLock) m_lock.unlock();
-            return false;
-        }
+    //
+    // render the color buffer to the window
+    //
+    s_gl.glPushMatrix();
+    s_gl.glRotatef(m_zRot, 0.0f, 0.0f, 1.0f);
+    if (m_zRot != 0.0f) {
+        s_gl.glClear(GL_COLOR_BUFFER_BIT);
+    }
+    ret = p_cb->post();
+    s_gl.glPopMatrix();
 
+    if (ret) {
         //
-        // render the color buffer to the window
+        // output FPS statistics
         //
-        s_gl.glPushMatrix();
-        s_gl.glRotatef(m_zRot, 0.0f, 0.0f, 1.0f);
-        if (m_zRot != 0.0f) {
-            s_gl.glClear(GL_COLOR_BUFFER_BIT);
-        }
-        ret = (*c).second.cb->post();
-        s_gl.glPopMatrix();
-
-        if (ret) {
-            //
-            // output FPS statistics
-            //
-            if (m_fpsStats) {
-                long long currTime = GetCurrentTimeMS();
-                m_statsNumFrames++;
-                if (currTime - m_statsStartTime >= 1000) {
-                    float dt = (float)(currTime - m_statsStartTime) / 1000.0f;
-                    printf("FPS: %5.3f\n", (float)m_statsNumFrames / dt);
-                    m_statsStartTime = currTime;
-                    m_statsNumFrames = 0;
-                }
+        if (m_fpsStats) {
+            long long currTime = GetCurrentTimeMS();
+            m_statsNumFrames++;
+            if (currTime - m_statsStartTime >= 1000) {
+                float dt = (float)(currTime - m_statsStartTime) / 1000.0f;
+                printf("FPS: %5.3f\n", (float)m_statsNumFrames / dt);
+                m_statsStartTime = currTime;
+                m_statsNumFrames = 0;
             }
-
-            s_egl.eglSwapBuffers(m_eglDisplay, m_eglSurface);
         }
- 
-        // restore previous binding
-        unbind_locked();
 
+        s_egl.eglSwapBuffers(m_eglDisplay, m_eglSurface);
+    }
+
+    // back to the pbuffer context
+    unbindSubwin_locked();
+
+    //
+    // Send framebuffer (without FPS overlay) to callback
+    //
+    if (m_onPost || m_onPostDamage) {
         //
-        // Send framebuffer (without FPS overlay) to callback
+        // OnPostFn callbacks may modify the pixels, they always
+        // get a whole frame.
         //
-        if (m_onPost) {
-            (*c).second.cb->readback(m_fbImage);
+        DirtyRegion &damage = *p_damage;
+        if (m_onPostDamage) {
+            computePostDamage_locked(p_colorbuffer, p_cb, &damage);
+        } else {
+            damage.setFull(m_width, m_height);
+        }
+
+        if (m_postReadback) {
+            *p_postReadback = m_postReadback;
+        }
+        else if (m_onPostDamage) {
+            p_cb->readback(m_fbImage, m_width, damage);
+            m_onPostDamage(m_onPostContext, m_width, m_height, -1,
+                           GL_RGBA, GL_UNSIGNED_BYTE, m_fbImage,
+                           damage.rects(), damage.numRects());
+        }
+        else {
+            p_cb->readback(m_fbImage);
             m_onPost(m_onPostContext, m_width, m_height, -1,
                     GL_RGBA, GL_UNSIGNED_BYTE, m_fbImage);
         }
-
     }
 
-    if (needLock) m_lock.unlock();
     return ret;
 }
 
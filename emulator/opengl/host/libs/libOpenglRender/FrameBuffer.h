@@ -20,19 +20,28 @@
 #include "ColorBuffer.h"
 #include "RenderContext.h"
 #include "WindowSurface.h"
+#include "PostReadback.h"
+#include "Compositor.h"
+#include "GLSync.h"
+#include "HandleTable.h"
 #include <utils/threads.h>
-#include <map>
 #include <EGL/egl.h>
 #include <stdint.h>
 
-typedef uint32_t HandleType;
 struct ColorBufferRef {
     ColorBufferPtr cb;
     uint32_t refcount;  // number of client-side references
 };
-typedef std::map<HandleType, RenderContextPtr> RenderContextMap;
-typedef std::map<HandleType, WindowSurfacePtr> WindowSurfaceMap;
-typedef std::map<HandleType, ColorBufferRef> ColorBufferMap;
+typedef HandleTable<RenderContextPtr> RenderContextTable;
+typedef HandleTable<WindowSurfacePtr> WindowSurfaceTable;
+typedef HandleTable<ColorBufferRef> ColorBufferTable;
+
+// handle table kinds, handles of different kinds never collide
+enum {
+    HANDLE_KIND_CONTEXT,
+    HANDLE_KIND_WINDOW,
+    HANDLE_KIND_COLORBUFFER
+};
 
 struct FrameBufferCaps
 {
@@ -60,6 +69,8 @@ public:
     int getHeight() const { return m_height; }
 
     void setPostCallback(OnPostFn onPost, void* onPostContext);
+    void setPostDamageCallback(OnPostDamageFn onPost, void* onPostContext);
+    bool setPostReadbackMode(int depth, int dropPolicy);
 
     void getGLStrings(const char** vendor, const char** renderer, const char** version) const {
         *vendor = m_glVendor;
@@ -84,13 +95,27 @@ public:
                            int x, int y, int width, int height,
                            GLenum format, GLenum type, void *pixels);
 
-    bool post(HandleType p_colorbuffer, bool needLock = true);
+    //
+    // Queues the post of the color buffer to the Compositor, returns
+    // false if it cannot be posted. Only one post is in flight: this
+    // first waits for the previous one, so that a guest rendering to
+    // its color buffers in turn never renders to one being posted.
+    // p_fence, from the current context, is what the post waits for.
+    //
+    bool post(HandleType p_colorbuffer, GLsync p_fence = NULL);
     bool repost();
 
     EGLDisplay getDisplay() const { return m_eglDisplay; }
     EGLNativeWindowType getSubWindow() const { return m_subWin; }
-    bool bind_locked();
-    bool unbind_locked();
+    Compositor *getCompositor() const { return m_compositor; }
+
+    //
+    // Color buffers can be released by any thread, their GL objects are
+    // deleted by the Compositor.
+    //
+    void releaseColorBufferObjects(EGLImageKHR p_eglImage,
+                                   EGLImageKHR p_blitEGLImage,
+                                   GLuint p_fbo, GLuint p_tex, GLuint p_blitTex);
 
     void setDisplayRotation(float zRot) {
         m_zRot = zRot;
@@ -98,39 +123,61 @@ public:
     }
 
 private:
+    class CreateColorBufferTask;
+    class UpdateColorBufferTask;
+    class SetupSubWindowTask;
+    class PostTask;
+    class ReleaseTask;
+
     FrameBuffer(int p_width, int p_height);
     ~FrameBuffer();
-    HandleType genHandle();
+    bool getColorBuffer(HandleType p_colorbuffer, ColorBufferPtr *p_cb);
+    bool postAndReadback(HandleType p_colorbuffer, ColorBuffer *p_cb);
+    bool post_locked(HandleType p_colorbuffer, ColorBuffer *p_cb,
+                     PostReadback **p_postReadback, DirtyRegion *p_damage);
     bool bindSubwin_locked();
+    bool unbindSubwin_locked();
     void initGLState();
+    bool allocPostImage_locked();
+    PostReadback *updatePostReadback_locked();
+    void releasePostReadback(PostReadback *p_postReadback);
+    void computePostDamage_locked(HandleType p_colorbuffer, ColorBuffer *p_cb,
+                                  DirtyRegion *p_damage);
 
 private:
     static FrameBuffer *s_theFrameBuffer;
-    static HandleType s_nextHandle;
     int m_x;
     int m_y;
     int m_width;
     int m_height;
+
+    //
+    // The FrameBuffer own contexts, the pbuffer one and the subwindow
+    // one, are only used by the Compositor thread. m_lock serializes
+    // the posting state and the subwindow, posts hold it on the
+    // Compositor thread so it is never held while waiting for a
+    // Compositor task. The handle tables have their own locks and the
+    // objects in them lock themselves.
+    //
     android::Mutex m_lock;
     FBNativeWindowType m_nativeWindow;
     FrameBufferCaps m_caps;
     EGLDisplay m_eglDisplay;
-    RenderContextMap m_contexts;
-    WindowSurfaceMap m_windows;
-    ColorBufferMap m_colorbuffers;
+    RenderContextTable m_contexts;
+    WindowSurfaceTable m_windows;
+    ColorBufferTable m_colorbuffers;
 
     EGLSurface m_eglSurface;
     EGLContext m_eglContext;
     EGLSurface m_pbufSurface;
     EGLContext m_pbufContext;
+    Compositor *m_compositor;
 
-    EGLContext m_prevContext;
-    EGLSurface m_prevReadSurf;
-    EGLSurface m_prevDrawSurf;
     EGLNativeWindowType m_subWin;
     EGLNativeDisplayType m_subWinDisplay;
     EGLConfig  m_eglConfig;
     HandleType m_lastPostedColorBuffer;
+    unsigned int m_postFence;   // of the post in flight, 0 if none
     float      m_zRot;
     bool       m_eglContextInitialized;
 
@@ -139,8 +186,24 @@ private:
     bool m_fpsStats;
 
     OnPostFn m_onPost;
+    OnPostDamageFn m_onPostDamage;
     void* m_onPostContext;
     unsigned char* m_fbImage;
+    PostReadback* m_postReadback;
+    int m_postReadbackDepth;
+    int m_postDropPolicy;
+
+    //
+    // the last posted frames, newest last, to compute how a posted
+    // color buffer differs from the previous frame.
+    //
+    enum { POST_HISTORY_SIZE = 4 };
+    struct PostHistory {
+        HandleType cb;
+        DirtyRegion damage;
+    };
+    PostHistory m_postHistory[POST_HISTORY_SIZE];
+    int m_postHistoryCount;
 
     const char* m_glVendor;
     const char* m_glRenderer;
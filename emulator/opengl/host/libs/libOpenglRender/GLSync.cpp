@@ -0,0 +1,149 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "GLSync.h"
+#include "osDynLibrary.h"
+#include <utils/threads.h>
+#include <GLES/gl.h>
+#include <string.h>
+
+#define GL_SYNC_GPU_COMMANDS_COMPLETE_ARB   0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT_ARB      0x00000001
+#define GL_TIMEOUT_IGNORED_ARB              0xFFFFFFFFFFFFFFFFull
+
+#ifndef GL_APIENTRY
+#define GL_APIENTRY
+#endif
+
+//
+// desktop GL entry points, loaded from the host GL library rather
+// than the Translator one.
+//
+typedef GLsync (GL_APIENTRY *glFenceSync_t)(GLenum, GLbitfield);
+typedef GLenum (GL_APIENTRY *glClientWaitSync_t)(GLsync, GLbitfield, unsigned long long);
+typedef void (GL_APIENTRY *glWaitSync_t)(GLsync, GLbitfield, unsigned long long);
+typedef void (GL_APIENTRY *glDeleteSync_t)(GLsync);
+typedef void (GL_APIENTRY *glFlush_t)(void);
+typedef void (GL_APIENTRY *glFinish_t)(void);
+typedef const GLubyte *(GL_APIENTRY *glGetString_t)(GLenum);
+typedef osUtils::dynFuncPtr (GL_APIENTRY *getProcAddress_t)(const char *);
+
+static android::Mutex s_lock;
+static bool s_loaded = false;
+static glFenceSync_t s_glFenceSync = NULL;
+static glClientWaitSync_t s_glClientWaitSync = NULL;
+static glWaitSync_t s_glWaitSync = NULL;
+static glDeleteSync_t s_glDeleteSync = NULL;
+static glFlush_t s_glFlush = NULL;
+static glFinish_t s_glFinish = NULL;
+
+//
+// Loaded on first use: wglGetProcAddress needs a current context,
+// and the extension string tells if the fences can be used.
+//
+static void loadSyncFunctions()
+{
+    android::Mutex::Autolock mutex(s_lock);
+    if (s_loaded) {
+        return;
+    }
+    s_loaded = true;
+
+#if defined(_WIN32)
+    osUtils::dynLibrary *lib = osUtils::dynLibrary::open("opengl32");
+    const char *getProcName = "wglGetProcAddress";
+#elif defined(__APPLE__)
+    osUtils::dynLibrary *lib = osUtils::dynLibrary::open(
+            "/System/Library/Frameworks/OpenGL.framework/OpenGL");
+    const char *getProcName = NULL;
+#else
+    osUtils::dynLibrary *lib = osUtils::dynLibrary::open("libGL.so");
+    const char *getProcName = "glXGetProcAddressARB";
+#endif
+    if (!lib) {
+        return;
+    }
+
+    getProcAddress_t getProc = NULL;
+    if (getProcName) {
+        getProc = (getProcAddress_t)lib->findSymbol(getProcName);
+    }
+
+#define LOAD_SYNC_FUNC(name) \
+    s_##name = (name##_t)(getProc ? getProc(#name) : NULL); \
+    if (!s_##name) s_##name = (name##_t)lib->findSymbol(#name);
+
+    LOAD_SYNC_FUNC(glFlush);
+    LOAD_SYNC_FUNC(glFinish);
+
+    glGetString_t getString = (glGetString_t)lib->findSymbol("glGetString");
+    const char *ext = getString ? (const char *)getString(GL_EXTENSIONS) : NULL;
+    if (!ext || !strstr(ext, "GL_ARB_sync")) {
+        return;
+    }
+
+    LOAD_SYNC_FUNC(glFenceSync);
+    LOAD_SYNC_FUNC(glClientWaitSync);
+    LOAD_SYNC_FUNC(glWaitSync);
+    LOAD_SYNC_FUNC(glDeleteSync);
+    if (!s_glFenceSync || !s_glClientWaitSync ||
+        !s_glWaitSync || !s_glDeleteSync) {
+        s_glFenceSync = NULL;
+    }
+#undef LOAD_SYNC_FUNC
+}
+
+GLsync insertGLFence()
+{
+    loadSyncFunctions();
+    if (!s_glFenceSync) {
+        if (s_glFinish) s_glFinish();
+        return NULL;
+    }
+
+    GLsync fence = s_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE_ARB, 0);
+    // the fence must reach the GPU before another context waits for it
+    s_glFlush();
+    return fence;
+}
+
+void waitGLFence(GLsync p_fence)
+{
+    if (p_fence) {
+        s_glWaitSync(p_fence, 0, GL_TIMEOUT_IGNORED_ARB);
+        s_glDeleteSync(p_fence);
+    }
+}
+
+void deleteGLFence(GLsync p_fence)
+{
+    if (p_fence) {
+        s_glDeleteSync(p_fence);
+    }
+}
+
+void finishGLCommands()
+{
+    loadSyncFunctions();
+    if (!s_glFenceSync) {
+        if (s_glFinish) s_glFinish();
+        return;
+    }
+
+    GLsync fence = s_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE_ARB, 0);
+    s_glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT_ARB,
+                       GL_TIMEOUT_IGNORED_ARB);
+    s_glDeleteSync(fence);
+}
@@ -0,0 +1,51 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIBRENDER_GLSYNC_H
+#define _LIBRENDER_GLSYNC_H
+
+//
+// Handing GL results from one context to another.
+//
+// The guest contexts, the Compositor and the PostReadback thread use
+// each other's textures. A glFlush in the producing context does not
+// make its commands complete for the consuming one, only a fence or a
+// glFinish does. The Translator runs on the host desktop GL, whose
+// GL_ARB_sync fences are used here; every Translator context, GLES 1
+// or 2, is a desktop context so these work with any of them current.
+// Without GL_ARB_sync the producer falls back to glFinish.
+//
+// All functions must be called with a context current.
+//
+
+typedef struct __GLsync *GLsync;
+
+//
+// Called in the producing context after the commands to hand over,
+// returns the fence for waitGLFence(), or NULL when the commands are
+// already complete.
+//
+GLsync insertGLFence();
+
+// Makes the consuming context wait for p_fence, then deletes it
+void waitGLFence(GLsync p_fence);
+
+// Deletes a fence which will not be waited for
+void deleteGLFence(GLsync p_fence);
+
+// Waits on the CPU until the commands issued so far are complete
+void finishGLCommands();
+
+#endif
@@ -0,0 +1,116 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIBRENDER_HANDLE_TABLE_H
+#define _LIBRENDER_HANDLE_TABLE_H
+
+#include <utils/threads.h>
+#include <cutils/atomic.h>
+#include <stdint.h>
+#include "HandleRegistry.h"
+
+typedef uint32_t HandleType;
+
+//
+// A handle registry split into NUM_STRIPES independently locked stripes,
+// so that threads looking up different handles rarely wait for each
+// other. The stripe index and the table kind are the registry tag of a
+// handle: tables of different kinds never hand out the same handle, and
+// a lookup goes straight to the right slot of the right stripe.
+// New values are spread over the stripes in turn.
+//
+// Values are copied out of the table (T is normally a SmartPtr), a
+// value removed from the table stays valid for whoever got a copy.
+// Operations on several values at once must go through a stripe
+// explicitly, see stripeFor().
+//
+template <class T>
+class HandleTable
+{
+public:
+    enum { STRIPE_BITS = 4, NUM_STRIPES = 1 << STRIPE_BITS };
+
+    typedef HandleRegistry<T> Registry;
+
+    struct Stripe {
+        android::Mutex lock;
+        Registry registry;
+    };
+
+    // p_kind must be below 1 << (Registry::TAG_BITS - STRIPE_BITS)
+    explicit HandleTable(uint32_t p_kind) : m_nextStripe(0) {
+        for (int i = 0; i < NUM_STRIPES; i++) {
+            m_stripes[i].registry = Registry((p_kind << STRIPE_BITS) | i);
+        }
+    }
+
+    Stripe &stripeFor(HandleType p_handle) {
+        return m_stripes[Registry::tagOf(p_handle) & (NUM_STRIPES - 1)];
+    }
+
+    // returns 0 when the table is full
+    HandleType add(const T &p_value) {
+        int32_t first = android_atomic_inc(&m_nextStripe);
+        for (int i = 0; i < NUM_STRIPES; i++) {
+            Stripe &s = m_stripes[(first + i) & (NUM_STRIPES - 1)];
+            android::Mutex::Autolock mutex(s.lock);
+            HandleType h = s.registry.add(p_value);
+            if (h) {
+                return h;
+            }
+        }
+        return 0;
+    }
+
+    bool get(HandleType p_handle, T *p_value) {
+        Stripe &s = stripeFor(p_handle);
+        android::Mutex::Autolock mutex(s.lock);
+        T *v = s.registry.lookup(p_handle);
+        if (!v) {
+            return false;
+        }
+        *p_value = *v;
+        return true;
+    }
+
+    bool contains(HandleType p_handle) {
+        Stripe &s = stripeFor(p_handle);
+        android::Mutex::Autolock mutex(s.lock);
+        return s.registry.lookup(p_handle) != NULL;
+    }
+
+    //
+    // The removed value is copied to p_value if not NULL, so that the
+    // caller controls where the last reference is released.
+    //
+    bool remove(HandleType p_handle, T *p_value = NULL) {
+        Stripe &s = stripeFor(p_handle);
+        android::Mutex::Autolock mutex(s.lock);
+        return s.registry.remove(p_handle, p_value);
+    }
+
+    void clear() {
+        for (int i = 0; i < NUM_STRIPES; i++) {
+            android::Mutex::Autolock mutex(m_stripes[i].lock);
+            m_stripes[i].registry.clear();
+        }
+    }
+
+private:
+    Stripe m_stripes[NUM_STRIPES];
+    volatile int32_t m_nextStripe;
+};
+
+#endif
@@ -0,0 +1,339 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "PostReadback.h"
+#include "EGLDispatch.h"
+#include "GLDispatch.h"
+#include "ErrorLog.h"
+#include <stdlib.h>
+
+PostReadback::PostReadback(EGLDisplay p_dpy, EGLConfig p_config,
+                           EGLContext p_shareContext,
+                           int p_width, int p_height,
+                           int p_depth, int p_dropPolicy,
+                           OnPostFn p_onPost, OnPostDamageFn p_onPostDamage,
+                           void *p_onPostContext) :
+    osUtils::Thread(),
+    m_dpy(p_dpy),
+    m_config(p_config),
+    m_shareContext(p_shareContext),
+    m_context(EGL_NO_CONTEXT),
+    m_pbufSurface(EGL_NO_SURFACE),
+    m_fbo(0),
+    m_width(p_width),
+    m_height(p_height),
+    m_depth(p_depth),
+    m_dropPolicy(p_dropPolicy),
+    m_onPost(p_onPost),
+    m_onPostDamage(p_onPostDamage),
+    m_onPostContext(p_onPostContext),
+    m_image(NULL),
+    m_nextSeq(0),
+    m_dropped(0),
+    m_initState(INIT_PENDING),
+    m_exiting(false)
+{
+    for (int i = 0; i < RENDER_POST_MAX_DEPTH; i++) {
+        m_slots[i].tex = 0;
+        m_slots[i].state = SLOT_FREE;
+        m_slots[i].seq = 0;
+        m_slots[i].fence = NULL;
+    }
+}
+
+PostReadback *PostReadback::create(EGLDisplay p_dpy, EGLConfig p_config,
+                                   EGLContext p_shareContext,
+                                   int p_width, int p_height,
+                                   int p_depth, int p_dropPolicy,
+                                   OnPostFn p_onPost,
+                                   OnPostDamageFn p_onPostDamage,
+                                   void *p_onPostContext)
+{
+    if (p_depth < 1 || p_depth > RENDER_POST_MAX_DEPTH) {
+        return NULL;
+    }
+
+    PostReadback *pr = new PostReadback(p_dpy, p_config, p_shareContext,
+                                        p_width, p_height,
+                                        p_depth, p_dropPolicy,
+                                        p_onPost, p_onPostDamage,
+                                        p_onPostContext);
+    if (!pr->start()) {
+        ERR("PostReadback: failed to start thread\n");
+        delete pr;
+        return NULL;
+    }
+
+    //
+    // the GL objects are created by the thread, in its own context
+    //
+    pr->m_lock.lock();
+    while (pr->m_initState == INIT_PENDING) {
+        pr->m_cond.wait(pr->m_lock);
+    }
+    bool ok = (pr->m_initState == INIT_DONE);
+    pr->m_lock.unlock();
+
+    if (!ok) {
+        delete pr;
+        return NULL;
+    }
+    return pr;
+}
+
+PostReadback::~PostReadback()
+{
+    m_lock.lock();
+    m_exiting = true;
+    m_cond.broadcast();
+    m_lock.unlock();
+
+    int exitStatus;
+    wait(&exitStatus);
+}
+
+PostReadback::Slot *PostReadback::findSlot_locked(SlotState p_state)
+{
+    Slot *found = NULL;
+    for (int i = 0; i < m_depth; i++) {
+        Slot *s = &m_slots[i];
+        if (s->state == p_state &&
+            (!found || (int)(s->seq - found->seq) < 0)) {
+            found = s;
+        }
+    }
+    return found;
+}
+
+void PostReadback::post(ColorBuffer *p_cb, const DirtyRegion &p_damage)
+{
+    m_lock.lock();
+
+    DirtyRegion damage = m_lostDamage;
+    damage.addRegion(p_damage);
+    m_lostDamage.clear();
+
+    Slot *slot = findSlot_locked(SLOT_FREE);
+    if (!slot) {
+        if (m_dropPolicy == RENDER_POST_BLOCK) {
+            while (!slot && !m_exiting) {
+                m_cond.wait(m_lock);
+                slot = findSlot_locked(SLOT_FREE);
+            }
+        } else if (m_dropPolicy == RENDER_POST_DROP_OLDEST) {
+            slot = findSlot_locked(SLOT_PENDING);
+            if (slot) {
+                //
+                // the replaced frame's damage goes to the frame now
+                // following the last delivered one.
+                //
+                slot->state = SLOT_COPYING;
+                Slot *next = findSlot_locked(SLOT_PENDING);
+                if (next) {
+                    next->damage.addRegion(slot->damage);
+                } else {
+                    damage.addRegion(slot->damage);
+                }
+                m_dropped++;
+            }
+        }
+
+        if (!slot) {
+            // the new frame is lost
+            m_lostDamage = damage;
+            m_dropped++;
+            m_lock.unlock();
+            return;
+        }
+    }
+    slot->state = SLOT_COPYING;
+    slot->damage = damage;
+    GLsync dropped = slot->fence;
+    slot->fence = NULL;
+    m_lock.unlock();
+
+    deleteGLFence(dropped);
+    bool copied = p_cb->copyToTexture(slot->tex, m_width, m_height);
+    GLsync fence = copied ? insertGLFence() : NULL;
+
+    m_lock.lock();
+    if (copied) {
+        slot->fence = fence;
+        slot->state = SLOT_PENDING;
+        slot->seq = m_nextSeq++;
+    } else {
+        slot->state = SLOT_FREE;
+        m_lostDamage.addRegion(slot->damage);
+    }
+    m_cond.broadcast();
+    m_lock.unlock();
+}
+
+void PostReadback::setInitState(InitState p_state)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    m_initState = p_state;
+    m_cond.broadcast();
+}
+
+bool PostReadback::initGL()
+{
+    GLint glContextAttribs[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 1,
+        EGL_NONE
+    };
+
+    m_context = s_egl.eglCreateContext(m_dpy, m_config, m_shareContext,
+                                       glContextAttribs);
+    if (m_context == EGL_NO_CONTEXT) {
+        ERR("PostReadback: failed to create context 0x%x\n", s_egl.eglGetError());
+        return false;
+    }
+
+    EGLint pbufAttribs[] = {
+        EGL_WIDTH, 1,
+        EGL_HEIGHT, 1,
+        EGL_NONE
+    };
+
+    m_pbufSurface = s_egl.eglCreatePbufferSurface(m_dpy, m_config, pbufAttribs);
+    if (m_pbufSurface == EGL_NO_SURFACE) {
+        ERR("PostReadback: failed to create pbuf surface 0x%x\n", s_egl.eglGetError());
+        return false;
+    }
+
+    if (!s_egl.eglMakeCurrent(m_dpy, m_pbufSurface, m_pbufSurface, m_context)) {
+        ERR("PostReadback: eglMakeCurrent failed\n");
+        return false;
+    }
+
+    m_image = (unsigned char *)malloc(4 * m_width * m_height);
+    if (!m_image) {
+        ERR("PostReadback: out of memory\n");
+        return false;
+    }
+
+    for (int i = 0; i < m_depth; i++) {
+        s_gl.glGenTextures(1, &m_slots[i].tex);
+        s_gl.glBindTexture(GL_TEXTURE_2D, m_slots[i].tex);
+        s_gl.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0,
+                          GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    }
+    s_gl.glBindTexture(GL_TEXTURE_2D, 0);
+
+    s_gl.glGenFramebuffersOES(1, &m_fbo);
+
+    // the slot textures must exist before post() copies into them
+    s_gl.glFinish();
+    return true;
+}
+
+void PostReadback::finalizeGL()
+{
+    if (m_context != EGL_NO_CONTEXT && m_pbufSurface != EGL_NO_SURFACE &&
+        s_egl.eglGetCurrentContext() == m_context) {
+        if (m_fbo) {
+            s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+            s_gl.glDeleteFramebuffersOES(1, &m_fbo);
+        }
+        for (int i = 0; i < m_depth; i++) {
+            if (m_slots[i].tex) {
+                s_gl.glDeleteTextures(1, &m_slots[i].tex);
+            }
+            deleteGLFence(m_slots[i].fence);
+            m_slots[i].fence = NULL;
+        }
+        s_egl.eglMakeCurrent(m_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                             EGL_NO_CONTEXT);
+    }
+    if (m_pbufSurface != EGL_NO_SURFACE) {
+        s_egl.eglDestroySurface(m_dpy, m_pbufSurface);
+    }
+    if (m_context != EGL_NO_CONTEXT) {
+        s_egl.eglDestroyContext(m_dpy, m_context);
+    }
+    free(m_image);
+    m_image = NULL;
+}
+
+int PostReadback::Main()
+{
+    if (!initGL()) {
+        finalizeGL();
+        setInitState(INIT_FAILED);
+        return -1;
+    }
+    setInitState(INIT_DONE);
+
+    while (1) {
+        m_lock.lock();
+        Slot *slot = NULL;
+        while (!m_exiting && !(slot = findSlot_locked(SLOT_PENDING))) {
+            m_cond.wait(m_lock);
+        }
+        if (m_exiting) {
+            m_lock.unlock();
+            break;
+        }
+        slot->state = SLOT_READING;
+        DirtyRegion damage = slot->damage;
+        GLsync fence = slot->fence;
+        slot->fence = NULL;
+        m_lock.unlock();
+
+        //
+        // the slot texture is attached again for every frame so that
+        // this context picks up what post() copied in the other one.
+        //
+        waitGLFence(fence);
+        bool ok = false;
+        s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, m_fbo);
+        s_gl.glFramebufferTexture2DOES(GL_FRAMEBUFFER_OES,
+                                       GL_COLOR_ATTACHMENT0_OES,
+                                       GL_TEXTURE_2D, slot->tex, 0);
+        if (s_gl.glCheckFramebufferStatusOES(GL_FRAMEBUFFER_OES) ==
+                GL_FRAMEBUFFER_COMPLETE_OES) {
+            ColorBuffer::readPixels(m_image, m_width, damage);
+            ok = true;
+        }
+
+        m_lock.lock();
+        slot->state = SLOT_FREE;
+        if (!ok) {
+            m_lostDamage.addRegion(damage);
+        }
+        m_cond.broadcast();
+        m_lock.unlock();
+
+        //
+        // the callback runs without any lock held, the slot is already
+        // available to the next post.
+        //
+        if (ok && m_onPostDamage) {
+            m_onPostDamage(m_onPostContext, m_width, m_height, -1,
+                           GL_RGBA, GL_UNSIGNED_BYTE, m_image,
+                           damage.rects(), damage.numRects());
+        }
+        else if (ok) {
+            m_onPost(m_onPostContext, m_width, m_height, -1,
+                     GL_RGBA, GL_UNSIGNED_BYTE, m_image);
+        }
+    }
+
+    finalizeGL();
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIBRENDER_POST_READBACK_H
+#define _LIBRENDER_POST_READBACK_H
+
+#include "libOpenglRender/render_api.h"
+#include "ColorBuffer.h"
+#include "GLSync.h"
+#include "osThread.h"
+#include <utils/threads.h>
+
+//
+// Delivers posted frames to the FrameBuffer OnPostFn callback without
+// stalling the posting thread on glReadPixels.
+//
+// post() only copies the color buffer into a free slot texture on the
+// GPU. A thread with its own context, shared with the FrameBuffer ones,
+// reads the slots back in posting order and calls the callback, so that
+// frame K is read back while frame K+1 renders. When no slot is free
+// the drop policy (RENDER_POST_*) picks the frame which is lost, or
+// makes post() wait.
+//
+// Each frame comes with its damage, the region which changed since the
+// previous posted frame, and only that region is read back into the
+// image handed to the callback. The damage of a lost frame is added to
+// the next delivered one.
+//
+class PostReadback : public osUtils::Thread
+{
+public:
+    static PostReadback *create(EGLDisplay p_dpy, EGLConfig p_config,
+                                EGLContext p_shareContext,
+                                int p_width, int p_height,
+                                int p_depth, int p_dropPolicy,
+                                OnPostFn p_onPost,
+                                OnPostDamageFn p_onPostDamage,
+                                void *p_onPostContext);
+
+    // stops the thread, frames not read back yet are dropped
+    ~PostReadback();
+
+    //
+    // queue a color buffer, called by the Compositor without the
+    // FrameBuffer lock held: with RENDER_POST_BLOCK it waits for a
+    // free slot.
+    //
+    void post(ColorBuffer *p_cb, const DirtyRegion &p_damage);
+
+    unsigned int droppedFrames() const { return m_dropped; }
+
+    virtual int Main();
+
+private:
+    enum SlotState {
+        SLOT_FREE,
+        SLOT_COPYING,   // being written by post()
+        SLOT_PENDING,   // waiting to be read back
+        SLOT_READING
+    };
+
+    struct Slot {
+        GLuint tex;
+        SlotState state;
+        unsigned int seq;
+        DirtyRegion damage;
+        GLsync fence;   // of the copy, waited for by the reading thread
+    };
+
+    enum InitState { INIT_PENDING, INIT_DONE, INIT_FAILED };
+
+    PostReadback(EGLDisplay p_dpy, EGLConfig p_config,
+                 EGLContext p_shareContext,
+                 int p_width, int p_height,
+                 int p_depth, int p_dropPolicy,
+                 OnPostFn p_onPost, OnPostDamageFn p_onPostDamage,
+                 void *p_onPostContext);
+
+    bool initGL();
+    void finalizeGL();
+    Slot *findSlot_locked(SlotState p_state);
+    void setInitState(InitState p_state);
+
+private:
+    EGLDisplay m_dpy;
+    EGLConfig m_config;
+    EGLContext m_shareContext;
+    EGLContext m_context;
+    EGLSurface m_pbufSurface;
+    GLuint m_fbo;
+    int m_width;
+    int m_height;
+    int m_depth;
+    int m_dropPolicy;
+    OnPostFn m_onPost;
+    OnPostDamageFn m_onPostDamage;
+    void *m_onPostContext;
+    unsigned char *m_image;
+
+    android::Mutex m_lock;
+    android::Condition m_cond;  // signaled on any slot or state change
+    Slot m_slots[RENDER_POST_MAX_DEPTH];
+    unsigned int m_nextSeq;
+    DirtyRegion m_lostDamage;   // of frames dropped since the last queued
+    unsigned int m_dropped;
+    InitState m_initState;
+    bool m_exiting;
+};
+
+#endif
@@ -19,46 +19,279 @@
 #include <limits.h>
 #include "ErrorLog.h"
 
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+// a larger staging buffer is freed once its packet is consumed
+#define STAGING_KEEP_SIZE (16*1024*1024)
+
+#ifndef _WIN32
+//
+// Allocate a ring of *p_size bytes (rounded up to the page size) whose
+// storage is mapped twice, back-to-back. Returns NULL if the platform
+// does not let us build such a mapping.
+//
+static unsigned char *allocMirrored(size_t *p_size)
+{
+    static unsigned int s_seq = 0;
+
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (*p_size + pageSize - 1) & ~(pageSize - 1);
+    if (size < *p_size || size * 2 < size) {
+        return NULL;
+    }
+
+    int fd = -1;
+    char name[64];
+    for (int i = 0; i < 16 && fd < 0; i++) {
+        snprintf(name, sizeof(name), "/emugl-readbuf-%d-%u",
+                 (int)getpid(), __sync_fetch_and_add(&s_seq, 1));
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno != EEXIST) {
+            return NULL;
+        }
+    }
+    if (fd < 0) {
+        return NULL;
+    }
+    shm_unlink(name);
+
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    //
+    // reserve twice the size of address space then map the same
+    // pages into both halves of the reservation.
+    //
+    unsigned char *base = (unsigned char *)mmap(NULL, size * 2, PROT_NONE,
+                                                MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    void *lo = mmap(base, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, 0);
+    void *hi = mmap(base + size, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+
+    if (lo != base || hi != base + size) {
+        munmap(base, size * 2);
+        return NULL;
+    }
+
+    *p_size = size;
+    return base;
+}
+
+static void freeMirrored(unsigned char *buf, size_t size)
+{
+    munmap(buf, size * 2);
+}
+#else
+static unsigned char *allocMirrored(size_t *p_size)
+{
+    return NULL;
+}
+
+static void freeMirrored(unsigned char *buf, size_t size)
+{
+}
+#endif
+
 ReadBuffer::ReadBuffer(IOStream *stream, size_t bufsize)
 {
-    m_size = bufsize;
-    m_stream = stream;
-    m_buf = (unsigned char*)malloc(m_size*sizeof(unsigned char));
+    m_buf = NULL;
+    m_staging = NULL;
+    m_stagingSize = 0;
+    m_readPos = 0;
+    m_size = 0;
     m_validData = 0;
-    m_readPtr = m_buf;
+    m_mirrored = false;
+    m_stream = stream;
+    if (!allocStorage(bufsize)) {
+        ERR("Failed to alloc %zu bytes for ReadBuffer\n", bufsize);
+    }
+    m_initialSize = m_size;
+    m_data = m_buf;
 }
 
 ReadBuffer::~ReadBuffer()
 {
-    free(m_buf);
+    freeStorage();
+    free(m_staging);
+}
+
+bool ReadBuffer::allocStorage(size_t size)
+{
+    size_t mirrorSize = size;
+    unsigned char *buf = allocMirrored(&mirrorSize);
+    if (buf) {
+        m_buf = buf;
+        m_size = mirrorSize;
+        m_mirrored = true;
+        return true;
+    }
+
+    buf = (unsigned char*)malloc(size*sizeof(unsigned char));
+    if (!buf) {
+        return false;
+    }
+    m_buf = buf;
+    m_size = size;
+    m_mirrored = false;
+    return true;
+}
+
+void ReadBuffer::freeStorage()
+{
+    if (m_mirrored) {
+        freeMirrored(m_buf, m_size);
+    } else {
+        free(m_buf);
+    }
+    m_buf = NULL;
+}
+
+//
+// Move the valid data into a newly allocated buffer of newSize bytes.
+// On failure the current buffer is left untouched.
+//
+bool ReadBuffer::resize(size_t newSize)
+{
+    unsigned char *oldBuf = m_buf;
+    size_t oldSize = m_size;
+    bool oldMirrored = m_mirrored;
+
+    if (!allocStorage(newSize)) {
+        m_buf = oldBuf;
+        m_size = oldSize;
+        m_mirrored = oldMirrored;
+        return false;
+    }
+
+    if (m_validData > 0) {
+        memcpy(m_buf, oldBuf + m_readPos, m_validData);
+    }
+    m_readPos = 0;
+
+    if (oldMirrored) {
+        freeMirrored(oldBuf, oldSize);
+    } else {
+        free(oldBuf);
+    }
+    m_data = m_buf;
+    return true;
+}
+
+//
+// Receive the rest of a packet larger than the buffer into the staging
+// buffer, after the part of it the buffer holds, which leaves the buffer
+// empty. Returns the number of bytes read from the stream.
+//
+int ReadBuffer::getLargePacket(size_t packetLen)
+{
+    if (packetLen > m_stagingSize) {
+        // nothing to preserve, don't let realloc copy the old content
+        free(m_staging);
+        m_staging = (unsigned char *)malloc(packetLen);
+        m_stagingSize = m_staging ? packetLen : 0;
+        if (!m_staging) {
+            return -1;
+        }
+    }
+
+    size_t have = m_validData;
+    memcpy(m_staging, m_buf + m_readPos, have);
+    m_data = m_staging;
+    m_readPos = 0;
+
+    while (m_validData < packetLen) {
+        size_t len = packetLen - m_validData;
+        if (NULL == m_stream->read(m_staging + m_validData, &len)) {
+            return -1;
+        }
+        m_validData += len;
+    }
+    return m_validData - have;
 }
 
 int ReadBuffer::getData()
 {
-    if ((m_validData > 0) && (m_readPtr > m_buf)) {
-        memmove(m_buf, m_readPtr, m_validData);
+    if (!m_buf) {
+        return -1;
     }
-    // get fresh data into the buffer;
-    size_t len = m_size - m_validData;
-    if (len==0) {
+
+    if (m_data == m_staging) {
+        // the decoders could not make sense of the large packet
+        ERR("ReadBuffer: %zu bytes of a large packet were not consumed\n",
+            m_validData);
+        return -1;
+    }
+
+    if (m_validData >= 8) {
+        unsigned int packetLen;
+        memcpy(&packetLen, m_buf + m_readPos + 4, 4);
+        if (packetLen > m_size) {
+            int stat = getLargePacket(packetLen);
+            if (stat >= 0) {
+                return stat;
+            }
+            if (m_data == m_staging) {
+                return -1; // the stream failed
+            }
+            ERR("Failed to alloc %u bytes for a large packet\n", packetLen);
+        }
+    }
+
+    if (m_validData == m_size) {
         //we need to inc our buffer
         size_t new_size = m_size*2;
-        unsigned char* new_buf;
         if (new_size < m_size) { // overflow check
             new_size = INT_MAX;
         }
 
-        new_buf = (unsigned char*)realloc(m_buf, new_size);
-        if (!new_buf) {
+        if (!resize(new_size)) {
             ERR("Failed to alloc %zu bytes for ReadBuffer\n", new_size);
             return -1;
         }
-        m_size = new_size;
-        m_buf  = new_buf;
-        len    = m_size - m_validData;
     }
-    m_readPtr = m_buf;
-    if (NULL != m_stream->read(m_buf + m_validData, &len)) {
+    else if (m_size > m_initialSize && m_validData <= m_initialSize / 2) {
+        // a large packet has been consumed, give the memory back.
+        // failing to shrink is harmless, we just keep the big buffer.
+        resize(m_initialSize);
+    }
+
+    // get fresh data into the buffer;
+    size_t writePos = m_readPos + m_validData;
+    size_t len;
+    if (m_mirrored) {
+        // the free part of the ring is contiguous in the mirrored view
+        if (writePos >= m_size) {
+            writePos -= m_size;
+        }
+        len = m_size - m_validData;
+    }
+    else {
+        // compact only when most of the free space sits in front
+        // of the unconsumed data.
+        if (m_size - writePos < m_readPos) {
+            memmove(m_buf, m_buf + m_readPos, m_validData);
+            m_readPos = 0;
+            writePos = m_validData;
+        }
+        len = m_size - writePos;
+    }
+
+    if (NULL != m_stream->read(m_buf + writePos, &len)) {
         m_validData += len;
         return len;
     }
@@ -69,5 +302,25 @@ void ReadBuffer::consume(size_t amount)
 {
     assert(amount <= m_validData);
     m_validData -= amount;
-    m_readPtr += amount;
+    m_readPos += amount;
+    if (m_data == m_staging) {
+        if (m_validData == 0) {
+            // back to the buffer, which was left empty
+            m_data = m_buf;
+            m_readPos = 0;
+            if (m_stagingSize > STAGING_KEEP_SIZE) {
+                free(m_staging);
+                m_staging = NULL;
+                m_stagingSize = 0;
+            }
+        }
+    }
+    else if (m_mirrored) {
+        if (m_readPos >= m_size) {
+            m_readPos -= m_size;
+        }
+    }
+    else if (m_validData == 0) {
+        m_readPos = 0;
+    }
 }
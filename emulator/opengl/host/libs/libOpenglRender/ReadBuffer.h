@@ -18,19 +18,55 @@
 
 #include "IOStream.h"
 
+//
+// ReadBuffer is the receive buffer of a RenderThread.
+//
+// Where the platform allows it, the buffer is a ring whose storage is
+// mapped twice back-to-back in the address space (a "mirrored" ring).
+// Any window of up to size() bytes starting inside the ring is therefore
+// contiguous in memory, so unconsumed data never needs to be moved to the
+// front of the buffer and decoders always see whole packets in place.
+//
+// When a mirrored mapping cannot be created, the buffer falls back to a
+// linear heap buffer which only compacts when its tail is exhausted.
+//
+// A packet larger than the buffer is not received in it: once its header
+// is in, the part already read is copied to a separate staging buffer and
+// the rest of the packet is read from the stream straight behind it.
+// buf() then returns the whole packet in the staging buffer until it is
+// consumed. The staging buffer is kept for the next large packet unless
+// it is bigger than STAGING_KEEP_SIZE.
+//
+// Should the staging buffer fail, the buffer grows to hold the data and
+// shrinks back to its initial size once it has been consumed.
+//
 class ReadBuffer {
 public:
     ReadBuffer(IOStream *stream, size_t bufSize);
     ~ReadBuffer();
     int getData(); // get fresh data from the stream
-    unsigned char *buf() { return m_readPtr; } // return the next read location
+    unsigned char *buf() { return m_data + m_readPos; } // return the next read location
     size_t validData() { return m_validData; } // return the amount of valid data in readptr
     void consume(size_t amount); // notify that 'amount' data has been consumed;
+    size_t size() const { return m_size; }
+    bool isMirrored() const { return m_mirrored; }
+    size_t stagingSize() const { return m_stagingSize; }
+
 private:
+    bool allocStorage(size_t size);
+    void freeStorage();
+    bool resize(size_t newSize);
+    int getLargePacket(size_t packetLen);
+
+    unsigned char *m_data; // m_buf, or m_staging while it holds a packet
     unsigned char *m_buf;
-    unsigned char *m_readPtr;
+    unsigned char *m_staging;
+    size_t m_stagingSize;
+    size_t m_readPos;
     size_t m_size;
+    size_t m_initialSize;
     size_t m_validData;
+    bool m_mirrored;
     IOStream *m_stream;
 };
 #endif
@@ -20,6 +20,8 @@
 #include "GLDispatch.h"
 #include "GL2Dispatch.h"
 #include "ThreadInfo.h"
+#include "GLSync.h"
+#include "TimeUtils.h"
 
 static const GLint rendererVersion = 1;
 
@@ -273,7 +275,20 @@ static void rcFBPost(uint32_t colorBuffer)
         return;
     }
 
-    fb->post(colorBuffer);
+    long long t0 = GetCurrentTimeUS();
+
+    //
+    // the Compositor draws the color buffer from its own context, once
+    // what the guest rendered to it through an EGLImage is complete.
+    //
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    GLsync fence = tInfo->currContext.Ptr() ? insertGLFence() : NULL;
+    fb->post(colorBuffer, fence);
+
+    ConnectionStats *stats = tInfo->m_stats;
+    if (stats) {
+        stats->addPost(GetCurrentTimeUS() - t0);
+    }
 }
 
 static void rcFBSetSwapInterval(EGLint interval)
@@ -20,6 +20,9 @@
 #else
 #include "UnixStream.h"
 #endif
+#ifdef __linux__
+#include "SharedMemoryStream.h"
+#endif
 #include "RenderThread.h"
 #include "FrameBuffer.h"
 #include <set>
@@ -49,6 +52,10 @@ RenderServer *RenderServer::create(char* addr, size_t addrLen)
 
     if (gRendererStreamMode == STREAM_MODE_TCP) {
         server->m_listenSock = new TcpStream();
+#ifdef __linux__
+    } else if (gRendererStreamMode == STREAM_MODE_SHM) {
+        server->m_listenSock = new SharedMemoryStream();
+#endif
     } else {
 #ifdef _WIN32
         server->m_listenSock = new Win32PipeStream();
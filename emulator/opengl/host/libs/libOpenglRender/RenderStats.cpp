@@ -0,0 +1,375 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "RenderStats.h"
+#include "gl_dec.h"
+#include "gl2_dec.h"
+#include "renderControl_dec.h"
+#include "TimeUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <algorithm>
+
+#define RATE_WINDOW_US 1000000LL
+
+//
+// The decoders whose packets are counted, indexed by the
+// RENDER_STATS_DECODER_* values.
+//
+static const struct {
+    const char *name;
+    unsigned int base;
+    unsigned int last;
+    const char *(*opcodeName)(unsigned int opcode);
+} s_decoders[RENDER_STATS_NUM_DECODERS] = {
+    { "gles1",
+      gl_decoder_context_t::baseOpcode,
+      gl_decoder_context_t::lastOpcode,
+      gl_decoder_context_t::opcodeName },
+    { "gles2",
+      gl2_decoder_context_t::baseOpcode,
+      gl2_decoder_context_t::lastOpcode,
+      gl2_decoder_context_t::opcodeName },
+    { "renderControl",
+      renderControl_decoder_context_t::baseOpcode,
+      renderControl_decoder_context_t::lastOpcode,
+      renderControl_decoder_context_t::opcodeName },
+};
+
+//
+// Appends formatted text to a caller buffer, keeping count of the
+// size the whole text would need.
+//
+class TextWriter
+{
+public:
+    TextWriter(char *buf, size_t bufLen) :
+        m_buf(buf), m_bufLen(bufLen), m_pos(0) {
+        if (m_bufLen > 0) {
+            m_buf[0] = '\0';
+        }
+    }
+
+    void append(const char *fmt, ...) {
+        char tmp[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n >= sizeof(tmp)) {
+            n = sizeof(tmp) - 1;
+        }
+        if (m_pos + 1 < m_bufLen) {
+            size_t room = m_bufLen - m_pos - 1;
+            size_t len = (size_t)n < room ? (size_t)n : room;
+            memcpy(m_buf + m_pos, tmp, len);
+            m_buf[m_pos + len] = '\0';
+        }
+        m_pos += n;
+    }
+
+    // size needed for the whole text, including the terminating NUL
+    size_t needed() const { return m_pos + 1; }
+
+private:
+    char *m_buf;
+    size_t m_bufLen;
+    size_t m_pos;
+};
+
+ConnectionStats::ConnectionStats(unsigned int p_id) :
+    m_id(p_id),
+    m_rateStart(GetCurrentTimeUS()),
+    m_rateBytes(0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.id = p_id;
+    for (int i = 0; i < RENDER_STATS_NUM_DECODERS; i++) {
+        m_calls[i].assign(s_decoders[i].last - s_decoders[i].base, 0);
+        m_profiles[i] = new DecoderProfile(s_decoders[i].base,
+                                           s_decoders[i].last,
+                                           s_decoders[i].opcodeName);
+    }
+}
+
+ConnectionStats::~ConnectionStats()
+{
+    for (int i = 0; i < RENDER_STATS_NUM_DECODERS; i++) {
+        delete m_profiles[i];
+    }
+}
+
+void ConnectionStats::addRead(size_t bytes, long long us)
+{
+    long long now = GetCurrentTimeUS();
+    android::Mutex::Autolock mutex(m_lock);
+
+    m_stats.bytes += bytes;
+    m_stats.readTimeUs += us;
+
+    m_rateBytes += bytes;
+    long long dt = now - m_rateStart;
+    if (dt >= RATE_WINDOW_US) {
+        m_stats.bytesPerSec = (double)m_rateBytes * 1000000.0 / dt;
+        m_rateBytes = 0;
+        m_rateStart = now;
+    }
+}
+
+// called by DecoderRouter::takeCounts() with m_lock held
+void ConnectionStats::countPackets(void *p_context, unsigned int p_opcode,
+                                   unsigned int p_count)
+{
+    ConnectionStats *self = (ConnectionStats *)p_context;
+    for (int i = 0; i < RENDER_STATS_NUM_DECODERS; i++) {
+        if (p_opcode >= s_decoders[i].base && p_opcode < s_decoders[i].last) {
+            self->m_calls[i][p_opcode - s_decoders[i].base] += p_count;
+            self->m_stats.packets[i] += p_count;
+            return;
+        }
+    }
+}
+
+void ConnectionStats::addDecode(DecoderRouter *p_router, long long us)
+{
+    android::Mutex::Autolock mutex(m_lock);
+
+    m_stats.decodeTimeUs += us;
+    p_router->takeCounts(countPackets, this);
+}
+
+void ConnectionStats::addPost(long long us)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    m_stats.posts++;
+    m_stats.postTimeUs += us;
+    if ((unsigned long long)us > m_stats.postMaxUs) {
+        m_stats.postMaxUs = us;
+    }
+}
+
+void ConnectionStats::getStats(RenderConnectionStats *p_stats)
+{
+    long long now = GetCurrentTimeUS();
+    android::Mutex::Autolock mutex(m_lock);
+
+    *p_stats = m_stats;
+
+    //
+    // the window is only closed by a read, report the rate since it
+    // started if the connection has been quiet for longer than that.
+    //
+    long long dt = now - m_rateStart;
+    if (dt >= RATE_WINDOW_US) {
+        p_stats->bytesPerSec = (double)m_rateBytes * 1000000.0 / dt;
+    }
+}
+
+int ConnectionStats::getOpcodeStats(RenderOpcodeStats *p_stats, int maxCount)
+{
+    android::Mutex::Autolock mutex(m_lock);
+
+    int n = 0;
+    for (int i = 0; i < RENDER_STATS_NUM_DECODERS; i++) {
+        for (size_t j = 0; j < m_calls[i].size(); j++) {
+            if (m_calls[i][j] == 0) {
+                continue;
+            }
+            if (n < maxCount) {
+                RenderOpcodeStats &s = p_stats[n];
+                s.opcode = s_decoders[i].base + j;
+                s.name = s_decoders[i].opcodeName(s.opcode);
+                s.calls = m_calls[i][j];
+                s.timeUs = m_profiles[i]->entry(j).timeNs / 1000;
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+namespace {
+
+struct ProfileRow {
+    const char *name;
+    DecoderProfile::Entry entry;
+};
+
+bool slowerThan(const ProfileRow &a, const ProfileRow &b)
+{
+    return a.entry.timeNs > b.entry.timeNs;
+}
+
+} // anonymous namespace
+
+void ConnectionStats::writeProfile(TextWriter &out, int maxCalls)
+{
+    //
+    // the profiles are updated while we read them, work on a copy of
+    // the entries so that the order and the totals agree
+    //
+    std::vector<ProfileRow> rows;
+    unsigned long long packets = 0;
+    unsigned long long totalNs = 0;
+    for (int i = 0; i < RENDER_STATS_NUM_DECODERS; i++) {
+        const DecoderProfile *p = m_profiles[i];
+        for (unsigned int j = 0; j < p->size(); j++) {
+            if (p->entry(j).calls == 0) {
+                continue;
+            }
+            ProfileRow row;
+            row.name = p->name(j);
+            row.entry = p->entry(j);
+            rows.push_back(row);
+            packets += row.entry.calls;
+            totalNs += row.entry.timeNs;
+        }
+    }
+    if (packets == 0) {
+        return;
+    }
+    std::sort(rows.begin(), rows.end(), slowerThan);
+
+    out.append("connection %u: %llu packets profiled, %.1f ms\n",
+               m_id, packets, totalNs / 1000000.0);
+    out.append("  %-32s %10s %12s %10s %8s %8s %8s %6s\n", "call", "calls",
+               "bytes", "total ms", "avg us", "p50 us", "p99 us", "share");
+    for (size_t i = 0; i < rows.size() && (int)i < maxCalls; i++) {
+        const DecoderProfile::Entry &e = rows[i].entry;
+        out.append("  %-32s %10llu %12llu %10.2f %8.2f %8.2f %8.2f %5.1f%%\n",
+                   rows[i].name, e.calls, e.bytes, e.timeNs / 1000000.0,
+                   e.timeNs / 1000.0 / e.calls,
+                   DecoderProfile::percentileNs(e, 50) / 1000.0,
+                   DecoderProfile::percentileNs(e, 99) / 1000.0,
+                   totalNs ? e.timeNs * 100.0 / totalNs : 0.0);
+    }
+}
+
+//
+// RenderStats
+//
+
+volatile bool RenderStats::s_opcodeTiming = getenv("RENDERER_OPCODE_PROFILE") != NULL;
+bool RenderStats::s_printProfiles = getenv("RENDERER_OPCODE_PROFILE") != NULL;
+
+static android::Mutex s_lock;
+static std::vector<ConnectionStats *> s_connections;
+static unsigned int s_nextId = 1;
+
+ConnectionStats *RenderStats::openConnection()
+{
+    android::Mutex::Autolock mutex(s_lock);
+    ConnectionStats *conn = new ConnectionStats(s_nextId++);
+    s_connections.push_back(conn);
+    return conn;
+}
+
+void RenderStats::closeConnection(ConnectionStats *p_conn)
+{
+    android::Mutex::Autolock mutex(s_lock);
+    for (size_t i = 0; i < s_connections.size(); i++) {
+        if (s_connections[i] == p_conn) {
+            s_connections.erase(s_connections.begin() + i);
+            break;
+        }
+    }
+    delete p_conn;
+}
+
+int RenderStats::getConnectionStats(RenderConnectionStats *p_stats, int maxCount)
+{
+    android::Mutex::Autolock mutex(s_lock);
+    int n = (int)s_connections.size();
+    for (int i = 0; i < n && i < maxCount; i++) {
+        s_connections[i]->getStats(&p_stats[i]);
+    }
+    return n;
+}
+
+int RenderStats::getOpcodeStats(unsigned int id, RenderOpcodeStats *p_stats,
+                                int maxCount)
+{
+    android::Mutex::Autolock mutex(s_lock);
+    for (size_t i = 0; i < s_connections.size(); i++) {
+        if (s_connections[i]->id() == id) {
+            return s_connections[i]->getOpcodeStats(p_stats, maxCount);
+        }
+    }
+    return 0;
+}
+
+size_t RenderStats::dumpJSON(char *buf, size_t bufLen)
+{
+    TextWriter out(buf, bufLen);
+    android::Mutex::Autolock mutex(s_lock);
+
+    out.append("{\"opcodeTiming\":%s,\"connections\":[",
+               s_opcodeTiming ? "true" : "false");
+
+    std::vector<RenderOpcodeStats> opcodes;
+    for (size_t i = 0; i < s_connections.size(); i++) {
+        RenderConnectionStats s;
+        s_connections[i]->getStats(&s);
+
+        out.append("%s{\"id\":%u,\"bytes\":%llu,\"bytesPerSec\":%.0f,",
+                   i ? "," : "", s.id, s.bytes, s.bytesPerSec);
+        out.append("\"packets\":{");
+        for (int d = 0; d < RENDER_STATS_NUM_DECODERS; d++) {
+            out.append("%s\"%s\":%llu", d ? "," : "",
+                       s_decoders[d].name, s.packets[d]);
+        }
+        out.append("},\"decodeTimeUs\":%llu,\"readTimeUs\":%llu,",
+                   s.decodeTimeUs, s.readTimeUs);
+        out.append("\"posts\":%llu,\"postTimeUs\":%llu,\"postMaxUs\":%llu,",
+                   s.posts, s.postTimeUs, s.postMaxUs);
+
+        int n = s_connections[i]->getOpcodeStats(NULL, 0);
+        opcodes.resize(n > 0 ? n : 1);
+        n = s_connections[i]->getOpcodeStats(&opcodes[0], n);
+        if (n > (int)opcodes.size()) {
+            n = (int)opcodes.size();
+        }
+        out.append("\"opcodes\":[");
+        for (int j = 0; j < n; j++) {
+            const RenderOpcodeStats &o = opcodes[j];
+            out.append("%s{\"opcode\":%u,\"name\":\"%s\",\"calls\":%llu,\"timeUs\":%llu}",
+                       j ? "," : "", o.opcode, o.name ? o.name : "",
+                       o.calls, o.timeUs);
+        }
+        out.append("]}");
+    }
+    out.append("]}");
+
+    return out.needed();
+}
+
+size_t RenderStats::dumpProfile(unsigned int id, int maxCalls,
+                                char *buf, size_t bufLen)
+{
+    TextWriter out(buf, bufLen);
+    android::Mutex::Autolock mutex(s_lock);
+    for (size_t i = 0; i < s_connections.size(); i++) {
+        if (s_connections[i]->id() == id) {
+            s_connections[i]->writeProfile(out, maxCalls);
+            break;
+        }
+    }
+    return out.needed();
+}
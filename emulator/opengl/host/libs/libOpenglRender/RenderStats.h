@@ -0,0 +1,109 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_RENDER_STATS_H
+#define _LIB_OPENGL_RENDER_RENDER_STATS_H
+
+#include "libOpenglRender/render_api.h"
+#include "DecoderProfile.h"
+#include "DecoderRouter.h"
+#include <utils/threads.h>
+#include <vector>
+
+class TextWriter;
+
+//
+// Counters of a single guest connection. They are updated by the
+// connection's RenderThread and read by whichever thread queries the
+// render_api statistics, hence the lock. The RenderThread updates them
+// once per chunk of data read, not once per packet: its DecoderRouter
+// counts the packets and they are added by addDecode().
+//
+// The per-opcode times are kept apart, in a DecoderProfile per decoder
+// which the RenderThread attaches to its decoders while per-opcode
+// timing is enabled. The decoders fill them without locking.
+//
+class ConnectionStats
+{
+public:
+    explicit ConnectionStats(unsigned int p_id);
+    ~ConnectionStats();
+
+    unsigned int id() const { return m_id; }
+
+    // 'bytes' were read from the stream after blocking for 'us'
+    void addRead(size_t bytes, long long us);
+
+    // p_router decoded a chunk in 'us', takes the packets it counted
+    void addDecode(DecoderRouter *p_router, long long us);
+
+    //
+    // a color buffer was posted to the display, the guest was blocked
+    // 'us', waiting for the previous post to complete included.
+    //
+    void addPost(long long us);
+
+    // p_decoder is one of RENDER_STATS_DECODER_*
+    DecoderProfile *profile(int p_decoder) { return m_profiles[p_decoder]; }
+
+    void getStats(RenderConnectionStats *p_stats);
+    int getOpcodeStats(RenderOpcodeStats *p_stats, int maxCount);
+
+    // the 'maxCalls' opcodes which took the most time, as a text table
+    void writeProfile(TextWriter &out, int maxCalls);
+
+private:
+    static void countPackets(void *p_context, unsigned int p_opcode,
+                             unsigned int p_count);
+
+private:
+    android::Mutex m_lock;
+    unsigned int m_id;
+    RenderConnectionStats m_stats;
+    std::vector<unsigned long long> m_calls[RENDER_STATS_NUM_DECODERS];
+    DecoderProfile *m_profiles[RENDER_STATS_NUM_DECODERS];
+    long long m_rateStart;           // start of the bytes/s window
+    unsigned long long m_rateBytes;  // bytes read in that window
+};
+
+//
+// Registry of the open connections, backing the render_api statistics
+// functions.
+//
+class RenderStats
+{
+public:
+    static ConnectionStats *openConnection();
+    static void closeConnection(ConnectionStats *p_conn);
+
+    static bool opcodeTiming() { return s_opcodeTiming; }
+    static void setOpcodeTiming(bool p_enable) { s_opcodeTiming = p_enable; }
+
+    // true if RenderThreads print their opcode profile when they exit
+    static bool printProfiles() { return s_printProfiles; }
+
+    static int getConnectionStats(RenderConnectionStats *p_stats, int maxCount);
+    static int getOpcodeStats(unsigned int id, RenderOpcodeStats *p_stats,
+                              int maxCount);
+    static size_t dumpJSON(char *buf, size_t bufLen);
+    static size_t dumpProfile(unsigned int id, int maxCalls,
+                              char *buf, size_t bufLen);
+
+private:
+    static volatile bool s_opcodeTiming;
+    static bool s_printProfiles;
+};
+
+#endif
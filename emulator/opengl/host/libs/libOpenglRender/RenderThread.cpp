@@ -17,6 +17,9 @@
 #include "RenderControl.h"
 #include "ThreadInfo.h"
 #include "ReadBuffer.h"
+#include "DecoderRouter.h"
+#include "RenderStats.h"
+#include "StreamCapture.h"
 #include "TimeUtils.h"
 #include "GLDispatch.h"
 #include "GL2Dispatch.h"
@@ -24,6 +27,24 @@
 
 #define STREAM_BUFFER_SIZE 4*1024*1024
 
+#define PROFILE_REPORT_CALLS 20
+
+//
+// Attach the connection's opcode profiles to the decoders, or detach
+// them with NULL stats.
+//
+static void attachProfiles(RenderThreadInfo *tInfo,
+                           renderControl_decoder_context_t *rcDec,
+                           ConnectionStats *stats)
+{
+    tInfo->m_glDec.profile =
+            stats ? stats->profile(RENDER_STATS_DECODER_GLES1) : NULL;
+    tInfo->m_gl2Dec.profile =
+            stats ? stats->profile(RENDER_STATS_DECODER_GLES2) : NULL;
+    rcDec->profile =
+            stats ? stats->profile(RENDER_STATS_DECODER_RENDER_CONTROL) : NULL;
+}
+
 RenderThread::RenderThread() :
     osUtils::Thread(),
     m_stream(NULL),
@@ -53,10 +74,19 @@ int RenderThread::Main()
     tInfo->m_gl2Dec.initGL( gl2_dispatch_get_proc_func, NULL );
     initRenderControlContext( &m_rcDec );
 
+    //
+    // route each packet to the decoder owning its opcode
+    //
+    DecoderRouter router;
+    router.addDecoder(&tInfo->m_glDec);
+    router.addDecoder(&tInfo->m_gl2Dec);
+    router.addDecoder(&m_rcDec);
+    router.setCounting(true);
+
     ReadBuffer readBuf(m_stream, STREAM_BUFFER_SIZE);
 
-    int stats_totalBytes = 0;
-    long long stats_t0 = GetCurrentTimeMS();
+    ConnectionStats *stats = RenderStats::openConnection();
+    tInfo->m_stats = stats;
 
     //
     // open dump file if RENDER_DUMP_DIR is defined
@@ -74,24 +104,29 @@ int RenderThread::Main()
         delete [] fname;
     }
 
+    //
+    // record the connection for replay if RENDERER_CAPTURE_FILE is
+    // defined, the decoders reply through the capture
+    //
+    IOStream *stream = m_stream;
+    StreamCapture *capture = StreamCapture::get();
+    unsigned int captureConn = 0;
+    if (capture) {
+        captureConn = capture->openConnection();
+        stream = new CaptureStream(m_stream, capture, captureConn);
+    }
+
+    size_t captured = 0;    // bytes at the start of readBuf already captured
+    bool profiling = false;
     while (1) {
 
+        long long t0 = GetCurrentTimeUS();
         int stat = readBuf.getData();
         if (stat <= 0) {
             break;
         }
-
-        //
-        // log received bandwidth statistics
-        //
-        stats_totalBytes += readBuf.validData();
-        long long dt = GetCurrentTimeMS() - stats_t0;
-        if (dt > 1000) {
-            float dts = (float)dt / 1000.0f;
-            //printf("Used Bandwidth %5.3f MB/s\n", ((float)stats_totalBytes / dts) / (1024.0f*1024.0f));
-            stats_totalBytes = 0;
-            stats_t0 = GetCurrentTimeMS();
-        }
+        long long readTime = GetCurrentTimeUS();
+        stats->addRead(stat, readTime - t0);
 
         //
         // dump stream to file if needed
@@ -102,39 +137,37 @@ int RenderThread::Main()
             fflush(dumpFP);
         }
 
-        bool progress;
-        do {
-            progress = false;
-
-            //
-            // try to process some of the command buffer using the GLESv1 decoder
-            //
-            size_t last = tInfo->m_glDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-            if (last > 0) {
-                progress = true;
-                readBuf.consume(last);
-            }
-
-            //
-            // try to process some of the command buffer using the GLESv2 decoder
-            //
-            last = tInfo->m_gl2Dec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-            if (last > 0) {
-                progress = true;
-                readBuf.consume(last);
-            }
+        //
+        // the decoders time each packet while per-opcode timing is on
+        //
+        bool timing = RenderStats::opcodeTiming();
+        if (timing != profiling) {
+            attachProfiles(tInfo, &m_rcDec, timing ? stats : NULL);
+            profiling = timing;
+        }
 
-            //
-            // try to process some of the command buffer using the
-            // renderControl decoder
-            //
-            last = m_rcDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-            if (last > 0) {
-                readBuf.consume(last);
-                progress = true;
+        //
+        // the packets are captured before they are decoded: once a reply
+        // is sent the guest may go on and another connection's data may
+        // be captured.
+        //
+        if (capture) {
+            size_t whole = DecoderRouter::packetsLength(readBuf.buf(),
+                                                        readBuf.validData());
+            if (whole > captured) {
+                capture->addData(captureConn, readBuf.buf() + captured,
+                                 whole - captured, readTime);
+                captured = whole;
             }
+        }
 
-        } while( progress );
+        t0 = GetCurrentTimeUS();
+        size_t last = router.decode(readBuf.buf(), readBuf.validData(), stream);
+        stats->addDecode(&router, GetCurrentTimeUS() - t0);
+        if (last > 0) {
+            captured = captured > last ? captured - last : 0;
+            readBuf.consume(last);
+        }
 
     }
 
@@ -142,6 +175,26 @@ int RenderThread::Main()
         fclose(dumpFP);
     }
 
+    if (capture) {
+        capture->closeConnection(captureConn);
+        delete stream;
+    }
+
+    if (RenderStats::printProfiles()) {
+        size_t len = RenderStats::dumpProfile(stats->id(), PROFILE_REPORT_CALLS,
+                                              NULL, 0);
+        if (len > 1) {
+            char *report = new char[len];
+            RenderStats::dumpProfile(stats->id(), PROFILE_REPORT_CALLS, report, len);
+            fprintf(stderr, "%s", report);
+            delete [] report;
+        }
+    }
+
+    attachProfiles(tInfo, &m_rcDec, NULL);
+    tInfo->m_stats = NULL;
+    RenderStats::closeConnection(stats);
+
     //
     // release the thread from any EGL context
     // if bound to context.
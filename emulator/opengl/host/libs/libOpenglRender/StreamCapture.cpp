@@ -0,0 +1,404 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "StreamCapture.h"
+#include "FrameBuffer.h"
+#include "TimeUtils.h"
+#include <stdlib.h>
+#include <string.h>
+
+// what the guest connection streams use
+#define CAPTURE_STREAM_BUFFER_SIZE 10000
+
+#ifdef _WIN32
+#define fseeko fseeko64
+#define ftello ftello64
+#endif
+
+static android::Mutex s_captureLock;
+static bool           s_captureInitialized = false;
+static StreamCapture *s_capture = NULL;
+
+//
+// The capture lives until the process exits, RenderThreads may still
+// hold it after close().
+//
+StreamCapture *StreamCapture::get()
+{
+    android::Mutex::Autolock mutex(s_captureLock);
+    if (s_captureInitialized) {
+        return s_capture;
+    }
+    s_captureInitialized = true;
+
+    const char *fname = getenv("RENDERER_CAPTURE_FILE");
+    if (!fname) {
+        return NULL;
+    }
+    FILE *fp = fopen(fname, "wb");
+    if (!fp) {
+        fprintf(stderr, "Warning: stream capture failed to open file %s\n", fname);
+        return NULL;
+    }
+
+    CaptureHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (fb) {
+        header.fbWidth = fb->getWidth();
+        header.fbHeight = fb->getHeight();
+    }
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+        fprintf(stderr, "Warning: stream capture failed to write %s\n", fname);
+        fclose(fp);
+        return NULL;
+    }
+
+    s_capture = new StreamCapture(fp, GetCurrentTimeUS());
+    return s_capture;
+}
+
+void StreamCapture::close()
+{
+    android::Mutex::Autolock mutex(s_captureLock);
+    if (s_capture) {
+        android::Mutex::Autolock captureMutex(s_capture->m_lock);
+        s_capture->closeLocked();
+    }
+}
+
+StreamCapture::StreamCapture(FILE *p_fp, long long p_startUs) :
+    m_fp(p_fp),
+    m_startUs(p_startUs),
+    m_offset(sizeof(CaptureHeader)),
+    m_records(0),
+    m_nextConn(1),
+    m_nextIndexUs(0)
+{
+}
+
+unsigned int StreamCapture::openConnection()
+{
+    android::Mutex::Autolock mutex(m_lock);
+    unsigned int conn = m_nextConn++;
+    writeRecordLocked(CAPTURE_OPEN, conn, GetCurrentTimeUS(), NULL, 0);
+    return conn;
+}
+
+void StreamCapture::closeConnection(unsigned int p_conn)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    writeRecordLocked(CAPTURE_CLOSE, p_conn, GetCurrentTimeUS(), NULL, 0);
+    if (m_fp) {
+        fflush(m_fp);
+    }
+}
+
+void StreamCapture::addData(unsigned int p_conn, const void *p_buf, size_t p_len,
+                            long long p_timeUs)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    writeRecordLocked(CAPTURE_DATA, p_conn, p_timeUs, p_buf, p_len);
+}
+
+void StreamCapture::addReply(unsigned int p_conn, const void *p_buf, size_t p_len)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    writeRecordLocked(CAPTURE_REPLY, p_conn, GetCurrentTimeUS(), p_buf, p_len);
+}
+
+void StreamCapture::writeRecordLocked(uint32_t p_type, unsigned int p_conn,
+                                      long long p_timeUs,
+                                      const void *p_buf, size_t p_len)
+{
+    if (!m_fp) {
+        return;
+    }
+
+    // data read before the capture started is stamped at its start
+    uint64_t timeUs = p_timeUs > m_startUs ? p_timeUs - m_startUs : 0;
+
+    if (p_type == CAPTURE_DATA && timeUs >= m_nextIndexUs) {
+        CaptureIndexEntry e;
+        e.timeUs = timeUs;
+        e.offset = m_offset;
+        e.record = m_records;
+        m_index.push_back(e);
+        m_nextIndexUs = timeUs - timeUs % CAPTURE_INDEX_INTERVAL_US +
+                        CAPTURE_INDEX_INTERVAL_US;
+    }
+
+    CaptureRecord rec;
+    rec.type = p_type;
+    rec.connection = p_conn;
+    rec.timeUs = timeUs;
+    rec.length = p_len;
+    rec.reserved = 0;
+    if (fwrite(&rec, sizeof(rec), 1, m_fp) != 1 ||
+        (p_len > 0 && fwrite(p_buf, 1, p_len, m_fp) != p_len)) {
+        fprintf(stderr, "Warning: stream capture write failed, capture stopped\n");
+        fclose(m_fp);
+        m_fp = NULL;
+        return;
+    }
+    m_offset += sizeof(rec) + p_len;
+    m_records++;
+}
+
+void StreamCapture::closeLocked()
+{
+    if (!m_fp) {
+        return;
+    }
+
+    CaptureTrailer trailer;
+    trailer.indexOffset = m_offset;
+    trailer.indexCount = m_index.size();
+    memcpy(trailer.magic, CAPTURE_TRAILER_MAGIC, sizeof(trailer.magic));
+
+    std::vector<CaptureIndexEntry> index;
+    index.swap(m_index);
+    writeRecordLocked(CAPTURE_INDEX, 0, GetCurrentTimeUS(),
+                      index.size() ? &index[0] : NULL,
+                      index.size() * sizeof(CaptureIndexEntry));
+    if (m_fp) {
+        fwrite(&trailer, sizeof(trailer), 1, m_fp);
+        fclose(m_fp);
+        m_fp = NULL;
+    }
+}
+
+CaptureStream::CaptureStream(IOStream *p_stream, StreamCapture *p_capture,
+                             unsigned int p_conn) :
+    IOStream(CAPTURE_STREAM_BUFFER_SIZE),
+    m_stream(p_stream),
+    m_capture(p_capture),
+    m_conn(p_conn),
+    m_allocated(NULL)
+{
+}
+
+void *CaptureStream::allocBuffer(size_t minSize)
+{
+    m_allocated = m_stream->allocBuffer(minSize);
+    return m_allocated;
+}
+
+int CaptureStream::commitBuffer(size_t size)
+{
+    if (m_allocated) {
+        m_capture->addReply(m_conn, m_allocated, size);
+        m_allocated = NULL;
+    }
+    return m_stream->commitBuffer(size);
+}
+
+const unsigned char *CaptureStream::readFully(void *buf, size_t len)
+{
+    return m_stream->readFully(buf, len);
+}
+
+const unsigned char *CaptureStream::read(void *buf, size_t *inout_len)
+{
+    return m_stream->read(buf, inout_len);
+}
+
+int CaptureStream::writeFully(const void *buf, size_t len)
+{
+    m_capture->addReply(m_conn, buf, len);
+    return m_stream->writeFully(buf, len);
+}
+
+int CaptureStream::flushPending()
+{
+    return m_stream->flushPending();
+}
+
+CaptureReader::CaptureReader() :
+    m_fp(NULL),
+    m_hasIndex(false),
+    m_records(0),
+    m_durationUs(0),
+    m_dataEnd(0),
+    m_offset(0)
+{
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+CaptureReader::~CaptureReader()
+{
+    if (m_fp) {
+        fclose(m_fp);
+    }
+}
+
+bool CaptureReader::open(const char *p_fileName)
+{
+    m_fp = fopen(p_fileName, "rb");
+    if (!m_fp) {
+        return false;
+    }
+    if (fread(&m_header, sizeof(m_header), 1, m_fp) != 1 ||
+        memcmp(m_header.magic, CAPTURE_MAGIC, sizeof(m_header.magic)) != 0 ||
+        m_header.version != CAPTURE_VERSION) {
+        fclose(m_fp);
+        m_fp = NULL;
+        return false;
+    }
+
+    fseeko(m_fp, 0, SEEK_END);
+    long long fileSize = ftello(m_fp);
+    m_hasIndex = readIndex(fileSize);
+    if (!m_hasIndex) {
+        m_dataEnd = fileSize;
+        buildIndex();
+    }
+    rewind();
+    return true;
+}
+
+//
+// The index record tells the number of records and the capture
+// duration too: it is the last record and is stamped at close time.
+//
+bool CaptureReader::readIndex(long long p_fileSize)
+{
+    CaptureTrailer trailer;
+    CaptureRecord rec;
+    if (p_fileSize < (long long)(sizeof(CaptureHeader) + sizeof(rec) + sizeof(trailer))) {
+        return false;
+    }
+    fseeko(m_fp, p_fileSize - sizeof(trailer), SEEK_SET);
+    if (fread(&trailer, sizeof(trailer), 1, m_fp) != 1 ||
+        memcmp(trailer.magic, CAPTURE_TRAILER_MAGIC, sizeof(trailer.magic)) != 0 ||
+        trailer.indexOffset < sizeof(CaptureHeader) ||
+        trailer.indexOffset + sizeof(rec) +
+            trailer.indexCount * sizeof(CaptureIndexEntry) +
+            sizeof(trailer) != (uint64_t)p_fileSize) {
+        return false;
+    }
+
+    fseeko(m_fp, trailer.indexOffset, SEEK_SET);
+    if (fread(&rec, sizeof(rec), 1, m_fp) != 1 || rec.type != CAPTURE_INDEX) {
+        return false;
+    }
+    m_index.resize(trailer.indexCount);
+    if (trailer.indexCount > 0 &&
+        fread(&m_index[0], sizeof(CaptureIndexEntry), trailer.indexCount,
+              m_fp) != trailer.indexCount) {
+        m_index.clear();
+        return false;
+    }
+
+    m_dataEnd = trailer.indexOffset;
+    m_durationUs = rec.timeUs;
+    m_records = 0;
+    if (m_index.size() > 0) {
+        // count the records after the last entry
+        const CaptureIndexEntry &last = m_index[m_index.size() - 1];
+        m_records = last.record;
+        m_offset = last.offset;
+        fseeko(m_fp, m_offset, SEEK_SET);
+        CaptureRecord r;
+        const unsigned char *data;
+        while (next(&r, &data)) {
+            m_records++;
+        }
+    }
+    return true;
+}
+
+void CaptureReader::buildIndex()
+{
+    uint64_t nextIndexUs = 0;
+    CaptureRecord rec;
+    const unsigned char *data;
+
+    m_index.clear();
+    m_records = 0;
+    m_durationUs = 0;
+    rewind();
+    for (;;) {
+        uint64_t offset = m_offset;
+        if (!next(&rec, &data)) {
+            break;
+        }
+        if (rec.type == CAPTURE_DATA && rec.timeUs >= nextIndexUs) {
+            CaptureIndexEntry e;
+            e.timeUs = rec.timeUs;
+            e.offset = offset;
+            e.record = m_records;
+            m_index.push_back(e);
+            nextIndexUs = rec.timeUs - rec.timeUs % CAPTURE_INDEX_INTERVAL_US +
+                          CAPTURE_INDEX_INTERVAL_US;
+        }
+        if ((long long)rec.timeUs > m_durationUs) {
+            m_durationUs = rec.timeUs;
+        }
+        m_records++;
+    }
+}
+
+const CaptureIndexEntry *CaptureReader::findIndex(long long p_timeUs) const
+{
+    if (m_index.size() == 0) {
+        return NULL;
+    }
+    size_t lo = 0;
+    size_t hi = m_index.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if ((long long)m_index[mid].timeUs <= p_timeUs) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return &m_index[lo];
+}
+
+void CaptureReader::rewind()
+{
+    m_offset = sizeof(CaptureHeader);
+    fseeko(m_fp, m_offset, SEEK_SET);
+}
+
+void CaptureReader::seek(const CaptureIndexEntry *p_entry)
+{
+    m_offset = p_entry->offset;
+    fseeko(m_fp, m_offset, SEEK_SET);
+}
+
+bool CaptureReader::next(CaptureRecord *p_rec, const unsigned char **p_data)
+{
+    if (m_offset + sizeof(CaptureRecord) > m_dataEnd ||
+        fread(p_rec, sizeof(CaptureRecord), 1, m_fp) != 1 ||
+        p_rec->type == CAPTURE_INDEX ||
+        m_offset + sizeof(CaptureRecord) + p_rec->length > m_dataEnd) {
+        return false;
+    }
+    if (m_data.size() < p_rec->length) {
+        m_data.resize(p_rec->length);
+    }
+    if (p_rec->length > 0 &&
+        fread(&m_data[0], 1, p_rec->length, m_fp) != p_rec->length) {
+        return false;
+    }
+    m_offset += sizeof(CaptureRecord) + p_rec->length;
+    *p_data = m_data.size() ? &m_data[0] : NULL;
+    return true;
+}
@@ -0,0 +1,212 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_STREAM_CAPTURE_H
+#define _LIB_OPENGL_RENDER_STREAM_CAPTURE_H
+
+#include "IOStream.h"
+#include <utils/threads.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+//
+// Capture file format
+//
+// A capture holds the data of every guest connection of a renderer
+// session, in the order the RenderThreads decoded it, so that it can
+// be replayed against a FrameBuffer (tests/renderer_bench/StreamReplay).
+// All values are in host byte order.
+//
+//   CaptureHeader
+//   CaptureRecord + data, repeated
+//   CaptureRecord of type CAPTURE_INDEX + CaptureIndexEntry array
+//   CaptureTrailer
+//
+// A CAPTURE_DATA record holds whole packets, the ones completed by a
+// read of the connection. It is written before they are decoded, so
+// that the records of all the connections are in the order the host
+// received them. A CAPTURE_REPLY record holds what decoding sent back
+// to the guest; the replies to a data record follow it, up to the next
+// data record of the same connection. Record times are in microseconds
+// from the start of the capture.
+//
+// The index has an entry for the first data record of every
+// CAPTURE_INDEX_INTERVAL_US of the capture. The index and the trailer
+// are written when the renderer is stopped, a capture without them
+// (the emulator was killed) is indexed again when it is read.
+//
+#define CAPTURE_MAGIC              "EMUGLCAP"
+#define CAPTURE_TRAILER_MAGIC      "CIDX"
+#define CAPTURE_VERSION            2
+#define CAPTURE_INDEX_INTERVAL_US  10000
+
+enum CaptureRecordType {
+    CAPTURE_OPEN = 1,       // a connection was opened, no data
+    CAPTURE_CLOSE,          // a connection was closed, no data
+    CAPTURE_DATA,           // guest to host packets
+    CAPTURE_REPLY,          // host to guest bytes
+    CAPTURE_INDEX           // CaptureIndexEntry array
+};
+
+struct CaptureHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t fbWidth;       // FrameBuffer size of the session
+    uint32_t fbHeight;
+    uint32_t reserved;
+};
+
+struct CaptureRecord {
+    uint32_t type;
+    uint32_t connection;
+    uint64_t timeUs;
+    uint32_t length;        // of the data following the record
+    uint32_t reserved;
+};
+
+struct CaptureIndexEntry {
+    uint64_t timeUs;
+    uint64_t offset;        // file offset of the record
+    uint64_t record;        // record number, the header is not counted
+};
+
+struct CaptureTrailer {
+    uint64_t indexOffset;   // file offset of the CAPTURE_INDEX record
+    uint32_t indexCount;
+    char     magic[4];
+};
+
+//
+// Writes the capture of the current renderer session, to the file
+// named by the RENDERER_CAPTURE_FILE environment variable. Called by
+// every RenderThread, hence the lock.
+//
+class StreamCapture
+{
+public:
+    // NULL when RENDERER_CAPTURE_FILE is not set or can't be written
+    static StreamCapture *get();
+
+    // writes the index, later records are dropped
+    static void close();
+
+    unsigned int openConnection();
+    void closeConnection(unsigned int p_conn);
+
+    // p_timeUs is the time the data was read, from GetCurrentTimeUS().
+    // Called before decoding the data.
+    void addData(unsigned int p_conn, const void *p_buf, size_t p_len,
+                 long long p_timeUs);
+    void addReply(unsigned int p_conn, const void *p_buf, size_t p_len);
+
+private:
+    StreamCapture(FILE *p_fp, long long p_startUs);
+
+    void writeRecordLocked(uint32_t p_type, unsigned int p_conn,
+                           long long p_timeUs,
+                           const void *p_buf, size_t p_len);
+    void closeLocked();
+
+private:
+    android::Mutex m_lock;
+    FILE *m_fp;
+    long long m_startUs;
+    uint64_t m_offset;
+    uint64_t m_records;
+    unsigned int m_nextConn;
+    uint64_t m_nextIndexUs;
+    std::vector<CaptureIndexEntry> m_index;
+};
+
+//
+// The stream a RenderThread decodes with while capturing: everything
+// sent back to the guest is added to the capture as replies.
+//
+class CaptureStream : public IOStream
+{
+public:
+    CaptureStream(IOStream *p_stream, StreamCapture *p_capture,
+                  unsigned int p_conn);
+
+    virtual void *allocBuffer(size_t minSize);
+    virtual int commitBuffer(size_t size);
+    virtual const unsigned char *readFully(void *buf, size_t len);
+    virtual const unsigned char *read(void *buf, size_t *inout_len);
+    virtual int writeFully(const void *buf, size_t len);
+    virtual int flushPending();
+
+private:
+    IOStream *m_stream;
+    StreamCapture *m_capture;
+    unsigned int m_conn;
+    void *m_allocated;
+};
+
+//
+// Reads a capture, record by record. The CAPTURE_REPLY records read
+// after a CAPTURE_DATA record, until the next data record of the same
+// connection, are the replies to it.
+//
+class CaptureReader
+{
+public:
+    CaptureReader();
+    ~CaptureReader();
+
+    bool open(const char *p_fileName);
+
+    int fbWidth() const { return m_header.fbWidth; }
+    int fbHeight() const { return m_header.fbHeight; }
+
+    // false when the index was rebuilt because the capture has none
+    bool hasIndex() const { return m_hasIndex; }
+    const std::vector<CaptureIndexEntry> &index() const { return m_index; }
+
+    uint64_t records() const { return m_records; }
+    long long durationUs() const { return m_durationUs; }
+
+    // the last entry at or before p_timeUs, the first entry if none
+    const CaptureIndexEntry *findIndex(long long p_timeUs) const;
+
+    // goes back to the first record
+    void rewind();
+
+    // goes to the record of an index entry
+    void seek(const CaptureIndexEntry *p_entry);
+
+    //
+    // Reads the next record, the data stays valid until the next call.
+    // Returns false at the end of the records or on a truncated one.
+    //
+    bool next(CaptureRecord *p_rec, const unsigned char **p_data);
+
+private:
+    bool readIndex(long long p_fileSize);
+    void buildIndex();
+
+private:
+    FILE *m_fp;
+    CaptureHeader m_header;
+    bool m_hasIndex;
+    std::vector<CaptureIndexEntry> m_index;
+    uint64_t m_records;
+    long long m_durationUs;
+    uint64_t m_dataEnd;         // offset of the index record or file end
+    uint64_t m_offset;
+    std::vector<unsigned char> m_data;
+};
+
+#endif
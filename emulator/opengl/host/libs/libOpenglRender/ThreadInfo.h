@@ -20,14 +20,18 @@
 #include "WindowSurface.h"
 #include "GLDecoder.h"
 #include "GL2Decoder.h"
+#include "RenderStats.h"
 
 struct RenderThreadInfo
 {
+    RenderThreadInfo() : m_stats(NULL) {}
+
     RenderContextPtr currContext;
     WindowSurfacePtr currDrawSurf;
     WindowSurfacePtr currReadSurf;
     GLDecoder        m_glDec;
     GL2Decoder       m_gl2Dec;
+    ConnectionStats *m_stats;
 };
 
 RenderThreadInfo *getRenderThreadInfo();
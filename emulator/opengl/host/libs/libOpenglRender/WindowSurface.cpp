@@ -83,6 +83,7 @@ WindowSurface *WindowSurface::create(int p_config, int p_width, int p_height)
 //
 void WindowSurface::flushColorBuffer()
 {
+    android::Mutex::Autolock mutex(m_lock);
     if (m_attachedColorBuffer.Ptr() != NULL) {
         blitToColorBuffer();
     }
@@ -95,6 +96,7 @@ void WindowSurface::flushColorBuffer()
 //
 void WindowSurface::setColorBuffer(ColorBufferPtr p_colorBuffer)
 {
+    android::Mutex::Autolock mutex(m_lock);
     m_attachedColorBuffer = p_colorBuffer;
 
     //
@@ -124,6 +126,7 @@ void WindowSurface::setColorBuffer(ColorBufferPtr p_colorBuffer)
 //
 void WindowSurface::bind(RenderContextPtr p_ctx, SurfaceBindType p_bindType)
 {
+    android::Mutex::Autolock mutex(m_lock);
     if (p_bindType == SURFACE_BIND_READ) {
         m_readContext = p_ctx;
     }
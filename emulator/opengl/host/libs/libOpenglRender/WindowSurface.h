@@ -23,6 +23,7 @@
 #include "FixedBuffer.h"
 #include <EGL/egl.h>
 #include <GLES/gl.h>
+#include <utils/threads.h>
 
 enum SurfaceBindType {
     SURFACE_BIND_READ,
@@ -48,6 +49,7 @@ private:
     bool resizePbuffer(unsigned int p_width, unsigned int p_height);
 
 private:
+    android::Mutex m_lock;
     GLuint m_fbObj;   // GLES Framebuffer object (when EGLimage is used)
     GLuint m_depthRB;
     GLuint m_stencilRB;
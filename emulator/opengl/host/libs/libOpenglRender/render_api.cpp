@@ -17,6 +17,8 @@
 #include "IOStream.h"
 #include "FrameBuffer.h"
 #include "RenderServer.h"
+#include "RenderStats.h"
+#include "StreamCapture.h"
 #include "osProcess.h"
 #include "TimeUtils.h"
 
@@ -26,6 +28,9 @@
 #else
 #include "UnixStream.h"
 #endif
+#ifdef __linux__
+#include "SharedMemoryStream.h"
+#endif
 
 #include "EGLDispatch.h"
 #include "GLDispatch.h"
@@ -210,6 +215,27 @@ void setPostCallback(OnPostFn onPost, void* onPostContext)
 #endif
 }
 
+void setPostDamageCallback(OnPostDamageFn onPost, void* onPostContext)
+{
+#ifdef RENDER_API_USE_THREAD
+    FrameBuffer* fb = FrameBuffer::getFB();
+    if (fb) {
+        fb->setPostDamageCallback(onPost, onPostContext);
+    }
+#endif
+}
+
+int setPostReadbackMode(int depth, int dropPolicy)
+{
+#ifdef RENDER_API_USE_THREAD
+    FrameBuffer* fb = FrameBuffer::getFB();
+    if (fb) {
+        return fb->setPostReadbackMode(depth, dropPolicy);
+    }
+#endif
+    return false;
+}
+
 void getHardwareStrings(const char** vendor, const char** renderer, const char** version)
 {
     FrameBuffer* fb = FrameBuffer::getFB();
@@ -250,6 +276,8 @@ int stopOpenGLRenderer(void)
         s_renderThread = NULL;
     }
 
+    StreamCapture::close();
+
     return ret;
 }
 
@@ -318,6 +346,31 @@ void repaintOpenGLDisplay(void)
     }
 }
 
+int getRenderConnectionStats(RenderConnectionStats* stats, int maxCount)
+{
+    return RenderStats::getConnectionStats(stats, maxCount);
+}
+
+int getRenderOpcodeStats(unsigned int id, RenderOpcodeStats* stats, int maxCount)
+{
+    return RenderStats::getOpcodeStats(id, stats, maxCount);
+}
+
+void setRenderOpcodeTiming(int enable)
+{
+    RenderStats::setOpcodeTiming(enable != 0);
+}
+
+size_t dumpRenderStatsJSON(char* buf, size_t bufLen)
+{
+    return RenderStats::dumpJSON(buf, bufLen);
+}
+
+size_t dumpRenderOpcodeProfile(unsigned int id, int maxCalls, char* buf, size_t bufLen)
+{
+    return RenderStats::dumpProfile(id, maxCalls, buf, bufLen);
+}
+
 
 /* NOTE: For now, always use TCP mode by default, until the emulator
  *        has been updated to support Unix and Win32 pipes
@@ -332,6 +385,10 @@ IOStream *createRenderThread(int p_stream_buffer_size, unsigned int clientFlags)
 
     if (gRendererStreamMode == STREAM_MODE_TCP) {
         stream = new TcpStream(p_stream_buffer_size);
+#ifdef __linux__
+    } else if (gRendererStreamMode == STREAM_MODE_SHM) {
+        stream = new SharedMemoryStream(p_stream_buffer_size);
+#endif
     } else {
 #ifdef _WIN32
         stream = new Win32PipeStream(p_stream_buffer_size);
@@ -375,6 +432,10 @@ setStreamMode(int mode)
 #ifndef _WIN32
         case STREAM_MODE_UNIX:
             break;
+#ifdef __linux__
+        case STREAM_MODE_SHM:
+            break;
+#endif
 #else /* _WIN32 */
         case STREAM_MODE_PIPE:
             break;
@@ -44,6 +44,27 @@ EntryPoint * ApiGen::findEntryByName(const std::string & name)
     return entry;
 }
 
+size_t ApiGen::numOpcodes()
+{
+    size_t n = size();
+    for (size_t i = 0; i < size(); i++) {
+        if (at(i).batched()) n++;
+    }
+    return n;
+}
+
+bool ApiGen::parseDecoderBackend(const std::string & name, DecoderBackend *backend)
+{
+    if (name == "switch") {
+        *backend = DECODER_SWITCH;
+    } else if (name == "table") {
+        *backend = DECODER_TABLE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 void ApiGen::printHeader(FILE *fp) const
 {
     fprintf(fp, "// Generated Code - DO NOT EDIT !!\n");
@@ -279,7 +300,15 @@ int ApiGen::genOpcodes(const std::string &filename)
     for (size_t i = 0; i < size(); i++) {
         fprintf(fp, "#define OP_%s \t\t\t\t\t%u\n", at(i).name().c_str(), (unsigned int)i + m_baseOpcode);
     }
-    fprintf(fp, "#define OP_last \t\t\t\t\t%u\n", (unsigned int)size() + m_baseOpcode);
+    // packets of coalesced calls of the 'batched' entry points
+    size_t opcode = size();
+    for (size_t i = 0; i < size(); i++) {
+        if (at(i).batched()) {
+            fprintf(fp, "#define OP_%s_batch \t\t\t\t\t%u\n", at(i).name().c_str(),
+                    (unsigned int)opcode++ + m_baseOpcode);
+        }
+    }
+    fprintf(fp, "#define OP_last \t\t\t\t\t%u\n", (unsigned int)opcode + m_baseOpcode);
     fprintf(fp,"\n\n#endif\n");
     fclose(fp);
     return 0;
@@ -446,6 +475,48 @@ static void writeVarLargeEncodingExpression(Var& var, FILE* fp)
 }
 #endif /* WITH_LARGE_SUPPORT */
 
+//
+// Encodes a call of a 'batched' entry point. When the packet the stream
+// allocated last is a call of the same entry point, and nothing was
+// allocated or committed since, the arguments are appended to it and it
+// becomes an OP_<name>_batch packet; a single call is sent as usual.
+//
+static void writeBatchedEncode(EntryPoint *e, FILE *fp)
+{
+    VarsArray & evars = e->vars();
+    const char *name = e->name().c_str();
+    size_t argBytes = 0;
+    for (size_t j = 0; j < evars.size(); j++) {
+        argBytes += evars[j].type()->bytes();
+    }
+
+    fprintf(fp, "\tconst size_t argSize = %u;\n", (uint) argBytes);
+    fprintf(fp, "\tunsigned char *ptr = NULL;\n");
+    fprintf(fp, "\tunsigned char *packet = stream->openPacket();\n");
+    fprintf(fp, "\tint op = 0;\n");
+    fprintf(fp, "\tif (packet != NULL) {\n");
+    fprintf(fp, "\t\tmemcpy(&op, packet, 4);\n");
+    fprintf(fp, "\t\tif (op == OP_%s || op == OP_%s_batch) ptr = stream->appendPacket(argSize);\n",
+            name, name);
+    fprintf(fp, "\t}\n");
+    fprintf(fp, "\tif (ptr != NULL) {\n");
+    fprintf(fp, "\t\tunsigned int packetSize;\n");
+    fprintf(fp, "\t\tmemcpy(&packetSize, packet + 4, 4);\n");
+    fprintf(fp, "\t\tpacketSize += argSize;\n");
+    fprintf(fp, "\t\top = OP_%s_batch; memcpy(packet, &op, 4);\n", name);
+    fprintf(fp, "\t\tmemcpy(packet + 4, &packetSize, 4);\n");
+    fprintf(fp, "\t} else {\n");
+    fprintf(fp, "\t\tconst size_t packetSize = 8 + argSize;\n");
+    fprintf(fp, "\t\tptr = stream->allocPacket(packetSize);\n");
+    fprintf(fp, "\t\tint tmp = OP_%s;memcpy(ptr, &tmp, 4); ptr += 4;\n", name);
+    fprintf(fp, "\t\tmemcpy(ptr, &packetSize, 4);  ptr += 4;\n");
+    fprintf(fp, "\t}\n\n");
+
+    for (size_t j = 0; j < evars.size(); j++) {
+        writeVarEncodingExpression(evars[j], fp);
+    }
+}
+
 int ApiGen::genEncoderImpl(const std::string &filename)
 {
     FILE *fp = fopen(filename.c_str(), "wt");
@@ -481,6 +552,13 @@ int ApiGen::genEncoderImpl(const std::string &filename)
                 classname.c_str(),
                 classname.c_str());
         fprintf(fp, "\tIOStream *stream = ctx->m_stream;\n\n");
+
+        if (e->batched() && m_encoderBatching) {
+            writeBatchedEncode(e, fp);
+            fprintf(fp, "}\n\n");
+            continue;
+        }
+
         VarsArray & evars = e->vars();
         size_t  maxvars = evars.size();
         size_t  j;
@@ -583,9 +661,10 @@ int ApiGen::genEncoderImpl(const std::string &filename)
                     writeVarEncodingExpression(evars[j],fp);
                 }
 
-                // Ensure the fragment is commited if it is followed by a large variable
+                // Ensure the fragment is commited if it is followed by a large variable,
+                // a batching stream sends it along with the large variable.
                 if (j < maxvars) {
-                    fprintf(fp, "\tstream->flush();\n");
+                    fprintf(fp, "\tstream->commit();\n");
                 }
             }
 
@@ -694,6 +773,7 @@ int ApiGen::genDecoderHeader(const std::string &filename)
     fprintf(fp, "#define GUARD_%s\n\n", classname.c_str());
 
     fprintf(fp, "#include \"IOStream.h\" \n");
+    fprintf(fp, "#include \"DecoderProfile.h\"\n");
     fprintf(fp, "#include \"%s_%s_context.h\"\n\n\n", m_basename.c_str(), sideString(SERVER_SIDE));
 
     for (size_t i = 0; i < m_decoderHeaders.size(); i++) {
@@ -703,7 +783,15 @@ int ApiGen::genDecoderHeader(const std::string &filename)
 
     fprintf(fp, "struct %s : public %s_%s_context_t {\n\n",
             classname.c_str(), m_basename.c_str(), sideString(SERVER_SIDE));
+    // opcode range owned by this decoder, same values as in <basename>_opcodes.h
+    fprintf(fp, "\tstatic const unsigned int baseOpcode = %u;\n", (unsigned int)m_baseOpcode);
+    fprintf(fp, "\tstatic const unsigned int lastOpcode = %u; // one past the last opcode\n\n",
+            (unsigned int)numOpcodes() + m_baseOpcode);
+    fprintf(fp, "\t%s() : profile(NULL) {}\n\n", classname.c_str());
     fprintf(fp, "\tsize_t decode(void *buf, size_t bufsize, IOStream *stream);\n");
+    fprintf(fp, "\tstatic const char *opcodeName(unsigned int opcode); // NULL if not ours\n\n");
+    // runtime per opcode profiling, see DecoderProfile.h
+    fprintf(fp, "\tDecoderProfile *profile; // packets are profiled when not NULL\n");
     fprintf(fp, "\n};\n\n");
     fprintf(fp, "#endif\n");
 
@@ -744,6 +832,51 @@ int ApiGen::genContextImpl(const std::string &filename, SideType side)
     return 0;
 }
 
+//
+// Decodes a packet of a 'batched' entry point. The arguments of the
+// calls coalesced by the encoder follow the header back to back, their
+// count is the payload size over the size of one call's arguments. The
+// server proc is read once for the whole packet.
+//
+static void writeBatchedDecode(FILE *fp, EntryPoint *e, const std::string &basename,
+                               const char *ctx, const char *indent)
+{
+    VarsArray & evars = e->vars();
+    const char *name = e->name().c_str();
+    size_t argBytes = 0;
+    for (size_t j = 0; j < evars.size(); j++) {
+        argBytes += evars[j].type()->bytes();
+    }
+
+    fprintf(fp, "%s%s_server_proc_t proc = %s->%s;\n", indent, name, ctx, name);
+    fprintf(fp, "%sunsigned char *end = ptr + *(unsigned int *)(ptr + 4);\n", indent);
+    fprintf(fp, "%sfor (unsigned char *args = ptr + 8; args + %u <= end; args += %u) {\n",
+            indent, (uint) argBytes, (uint) argBytes);
+
+    std::string printString = "";
+    std::string printArgs = "";
+    std::string callArgs = e->customDecoder() ? ctx : "";
+    size_t offset = 0;
+    for (size_t j = 0; j < evars.size(); j++) {
+        Var *v = &evars[j];
+        if (v->isVoid()) continue;
+        const char *type = v->type()->name().c_str();
+        std::string var = "var_" + v->name();
+        fprintf(fp, "%s\t%s %s = *(%s *)(args + %u);\n", indent, type, var.c_str(), type, (uint) offset);
+        offset += v->type()->bytes();
+        printString += v->type()->printFormat() + " ";
+        printArgs += ", " + var;
+        callArgs += (callArgs.size() ? ", " : "") + var;
+    }
+
+    fprintf(fp, "#ifdef DEBUG_PRINTOUT\n");
+    fprintf(fp, "%s\tfprintf(stderr, \"%s: %s(%s)\\n\"%s);\n",
+            indent, basename.c_str(), name, printString.c_str(), printArgs.c_str());
+    fprintf(fp, "#endif\n");
+    fprintf(fp, "%s\tproc(%s);\n", indent, callArgs.c_str());
+    fprintf(fp, "%s}\n", indent);
+}
+
 int ApiGen::genDecoderImpl(const std::string &filename)
 {
     FILE *fp = fopen(filename.c_str(), "wt");
@@ -764,6 +897,28 @@ int ApiGen::genDecoderImpl(const std::string &filename)
     fprintf(fp, "#include <stdio.h>\n\n");
     fprintf(fp, "typedef unsigned int tsize_t; // Target \"size_t\", which is 32-bit for now. It may or may not be the same as host's size_t when emugen is compiled.\n\n");
 
+    // opcode names
+    fprintf(fp, "static const char *s_opcodeNames[%u] = {\n", (uint) numOpcodes());
+    for (size_t f = 0; f < n; f++) {
+        fprintf(fp, "\t\"%s\",\n", at(f).name().c_str());
+    }
+    for (size_t f = 0; f < n; f++) {
+        if (at(f).batched()) {
+            fprintf(fp, "\t\"%s_batch\",\n", at(f).name().c_str());
+        }
+    }
+    fprintf(fp, "};\n\n");
+    fprintf(fp, "const char *%s::opcodeName(unsigned int opcode)\n{\n", classname.c_str());
+    fprintf(fp, "\tif (opcode < baseOpcode || opcode >= lastOpcode) return NULL;\n");
+    fprintf(fp, "\treturn s_opcodeNames[opcode - baseOpcode];\n");
+    fprintf(fp, "}\n\n");
+
+    if (m_decoderBackend == DECODER_TABLE) {
+        int ret = genDecoderTableImpl(fp);
+        fclose(fp);
+        return ret;
+    }
+
     // decoder switch;
     fprintf(fp, "size_t %s::decode(void *buf, size_t len, IOStream *stream)\n{\n", classname.c_str());
     fprintf(fp,
@@ -780,6 +935,7 @@ int ApiGen::genDecoderImpl(const std::string &filename)
 \t\tint opcode = *(int *)ptr;   \n\
 \t\tunsigned int packetLen = *(int *)(ptr + 4);\n\
 \t\tif (len - pos < packetLen)  return pos; \n\
+\t\tlong long profileStart = this->profile ? DecoderProfile::now() : 0;\n\
 \t\tswitch(opcode) {\n",
             (uint) m_maxEntryPointsParams);
 
@@ -934,9 +1090,27 @@ int ApiGen::genDecoderImpl(const std::string &filename)
 
         delete [] tmpBufOffset;
     }
+    for (size_t f = 0; f < n; f++) {
+        EntryPoint *e = &at(f);
+        if (!e->batched()) continue;
+
+        fprintf(fp, "\t\t\tcase OP_%s_batch:\n", e->name().c_str());
+        fprintf(fp, "\t\t\t{\n");
+        writeBatchedDecode(fp, e, m_basename, "this", "\t\t\t");
+        fprintf(fp, "\t\t\tpos += *(int *)(ptr + 4);\n");
+        fprintf(fp, "\t\t\tptr += *(int *)(ptr + 4);\n");
+        fprintf(fp, "\t\t\t}\n");
+        fprintf(fp, "#ifdef CHECK_GL_ERROR\n");
+        fprintf(fp, "\t\t\tsprintf(lastCall, \"%s_batch\");\n", e->name().c_str());
+        fprintf(fp, "#endif\n");
+        fprintf(fp, "\t\t\tbreak;\n");
+    }
     fprintf(fp, "\t\t\tdefault:\n");
     fprintf(fp, "\t\t\t\tunknownOpcode = true;\n");
     fprintf(fp, "\t\t} //switch\n");
+    fprintf(fp, "\t\tif (this->profile && !unknownOpcode) {\n");
+    fprintf(fp, "\t\t\tthis->profile->add(opcode - baseOpcode, packetLen, DecoderProfile::now() - profileStart);\n");
+    fprintf(fp, "\t\t}\n");
     if (strstr(m_basename.c_str(), "gl")) {
         fprintf(fp, "#ifdef CHECK_GL_ERROR\n");
         fprintf(fp, "\tint err = this->glGetError();\n");
@@ -951,6 +1125,188 @@ int ApiGen::genDecoderImpl(const std::string &filename)
     return 0;
 }
 
+//
+// Table driven decoder: every entry point gets its own handler with the
+// argument offsets laid out at generation time, and decode() indexes a
+// handler table with (opcode - base_opcode). Arguments up to the first
+// 'in' pointer are read at constant offsets from the packet start, the
+// following ones at constant offsets from the end of that pointer data.
+//
+int ApiGen::genDecoderTableImpl(FILE *fp)
+{
+    std::string classname = m_basename + "_decoder_context_t";
+    size_t n = size();
+
+    for (size_t f = 0; f < n; f++) {
+        EntryPoint *e = &at(f);
+        VarsArray & evars = e->vars();
+
+        fprintf(fp, "static void decode_%s(%s *ctx, unsigned char *ptr, IOStream *stream)\n{\n",
+                e->name().c_str(), classname.c_str());
+
+        // argument layout
+        std::string base = "ptr";
+        size_t offset = 8; // skip the header
+        std::string tmpSize = "";
+        std::string printString = "";
+        std::string printArgs = "";
+        std::vector<std::string> callArgs;
+
+        for (size_t j = 0; j < evars.size(); j++) {
+            Var *v = &evars[j];
+            if (v->isVoid()) continue;
+
+            std::string at = base + " + " + toString(offset);
+            std::string var = "var_" + v->name();
+            const char *type = v->type()->name().c_str();
+
+            if (!v->isPointer()) {
+                fprintf(fp, "\t%s %s = *(%s *)(%s);\n", type, var.c_str(), type, at.c_str());
+                callArgs.push_back(var);
+                printString += v->type()->printFormat() + " ";
+                printArgs += ", " + var;
+                offset += v->type()->bytes();
+                continue;
+            }
+
+            //
+            // the size of an 'in' pointer is only needed to locate the
+            // arguments after it or to pass NULL, otherwise it is read
+            // in place by the debug printout.
+            //
+            bool isIn = v->pointerDir() == Var::POINTER_IN ||
+                        v->pointerDir() == Var::POINTER_INOUT;
+            bool sizeUsed = !isIn || v->nullAllowed();
+            for (size_t k = j + 1; k < evars.size() && !sizeUsed; k++) {
+                sizeUsed = !evars[k].isVoid();
+            }
+            std::string sizeVar = "size_" + v->name();
+            if (sizeUsed) {
+                fprintf(fp, "\ttsize_t %s = *(tsize_t *)(%s);\n", sizeVar.c_str(), at.c_str());
+            } else {
+                sizeVar = "*(tsize_t *)(" + at + ")";
+            }
+            if (isIn) {
+                fprintf(fp, "\tunsigned char *%s = %s + 4;\n", var.c_str(), at.c_str());
+                base = var + " + " + sizeVar;
+                offset = 0;
+            } else { // out pointer
+                fprintf(fp, "\tsize_t %s_offset = %s;\n", var.c_str(),
+                        tmpSize.size() ? tmpSize.c_str() : "0");
+                tmpSize += (tmpSize.size() ? " + " : "") + sizeVar;
+                offset += 4;
+            }
+            if (v->nullAllowed()) {
+                callArgs.push_back(sizeVar + " == 0 ? NULL : (" + v->type()->name() + ")(" + var + ")");
+            } else {
+                callArgs.push_back("(" + v->type()->name() + ")(" + var + ")");
+            }
+            printString += "%p(%u) ";
+            printArgs += ", " + var + ", " + sizeVar;
+        }
+
+        // out pointers and the return value go back through a single reply buffer
+        bool hasRetval = !e->retval().isVoid() && !e->retval().isPointer();
+        std::string retvalType;
+        if (hasRetval) {
+            retvalType = e->retval().type()->name();
+        }
+        bool hasReply = tmpSize.size() || hasRetval;
+        if (hasReply) {
+            std::string total = tmpSize.size() ? tmpSize : "0";
+            if (hasRetval) total += " + sizeof(" + retvalType + ")";
+            fprintf(fp, "\tunsigned char *tmpBuf = stream->alloc(%s);\n", total.c_str());
+            for (size_t j = 0; j < evars.size(); j++) {
+                Var *v = &evars[j];
+                if (v->isVoid() || !v->isPointer() || v->pointerDir() != Var::POINTER_OUT) continue;
+                fprintf(fp, "\tunsigned char *var_%s = tmpBuf + var_%s_offset;\n",
+                        v->name().c_str(), v->name().c_str());
+            }
+        }
+
+        fprintf(fp, "#ifdef DEBUG_PRINTOUT\n");
+        fprintf(fp, "\tfprintf(stderr, \"%s: %s(%s)\\n\"%s);\n",
+                m_basename.c_str(), e->name().c_str(), printString.c_str(), printArgs.c_str());
+        fprintf(fp, "#endif\n");
+
+        fprintf(fp, "\t");
+        if (hasRetval) {
+            fprintf(fp, "*(%s *)(tmpBuf + %s) = ", retvalType.c_str(),
+                    tmpSize.size() ? tmpSize.c_str() : "0");
+        }
+        fprintf(fp, "ctx->%s(", e->name().c_str());
+        if (e->customDecoder()) {
+            fprintf(fp, "ctx"); // add a context to the call
+        }
+        for (size_t j = 0; j < callArgs.size(); j++) {
+            if (j != 0 || e->customDecoder()) fprintf(fp, ", ");
+            fprintf(fp, "%s", callArgs[j].c_str());
+        }
+        fprintf(fp, ");\n");
+
+        if (hasReply) {
+            fprintf(fp, "\tstream->flush();\n");
+        }
+        fprintf(fp, "}\n\n");
+    }
+
+    // batched opcodes, see writeBatchedDecode()
+    for (size_t f = 0; f < n; f++) {
+        EntryPoint *e = &at(f);
+        if (!e->batched()) continue;
+
+        fprintf(fp, "static void decode_%s_batch(%s *ctx, unsigned char *ptr, IOStream *stream)\n{\n",
+                e->name().c_str(), classname.c_str());
+        writeBatchedDecode(fp, e, m_basename, "ctx", "\t");
+        fprintf(fp, "}\n\n");
+    }
+
+    fprintf(fp, "typedef void (*decode_handler_t)(%s *ctx, unsigned char *ptr, IOStream *stream);\n\n",
+            classname.c_str());
+    fprintf(fp, "static const decode_handler_t s_decodeTable[%u] = {\n", (uint) numOpcodes());
+    for (size_t f = 0; f < n; f++) {
+        fprintf(fp, "\tdecode_%s,\n", at(f).name().c_str());
+    }
+    for (size_t f = 0; f < n; f++) {
+        if (at(f).batched()) {
+            fprintf(fp, "\tdecode_%s_batch,\n", at(f).name().c_str());
+        }
+    }
+    fprintf(fp, "};\n\n");
+
+    bool checkGLError = strstr(m_basename.c_str(), "gl") != NULL;
+
+    fprintf(fp, "size_t %s::decode(void *buf, size_t len, IOStream *stream)\n{\n", classname.c_str());
+    fprintf(fp, "\tsize_t pos = 0;\n");
+    fprintf(fp, "\tunsigned char *ptr = (unsigned char *)buf;\n");
+    fprintf(fp, "\twhile (len - pos >= 8) {\n");
+    fprintf(fp, "\t\tunsigned int index = *(unsigned int *)ptr - %u;\n", (uint) m_baseOpcode);
+    fprintf(fp, "\t\tunsigned int packetLen = *(unsigned int *)(ptr + 4);\n");
+    fprintf(fp, "\t\tif (len - pos < packetLen) return pos;\n");
+    fprintf(fp, "\t\tif (index >= %u) return pos; // unknown opcode\n", (uint) numOpcodes());
+    fprintf(fp, "\t\tif (this->profile) {\n");
+    fprintf(fp, "\t\t\tlong long t0 = DecoderProfile::now();\n");
+    fprintf(fp, "\t\t\ts_decodeTable[index](this, ptr, stream);\n");
+    fprintf(fp, "\t\t\tthis->profile->add(index, packetLen, DecoderProfile::now() - t0);\n");
+    fprintf(fp, "\t\t} else {\n");
+    fprintf(fp, "\t\t\ts_decodeTable[index](this, ptr, stream);\n");
+    fprintf(fp, "\t\t}\n");
+    if (checkGLError) {
+        fprintf(fp, "#ifdef CHECK_GL_ERROR\n");
+        fprintf(fp, "\t\tint err = this->glGetError();\n");
+        fprintf(fp, "\t\tif (err) fprintf(stderr, \"%s Error: 0x%%X in %%s\\n\", err, s_opcodeNames[index]);\n",
+                m_basename.c_str());
+        fprintf(fp, "#endif\n");
+    }
+    fprintf(fp, "\t\tpos += packetLen;\n");
+    fprintf(fp, "\t\tptr += packetLen;\n");
+    fprintf(fp, "\t}\n");
+    fprintf(fp, "\treturn pos;\n");
+    fprintf(fp, "}\n");
+
+    return 0;
+}
+
 int ApiGen::readSpec(const std::string & filename)
 {
     FILE *specfp = fopen(filename.c_str(), "rt");
@@ -1072,6 +1428,11 @@ int ApiGen::setGlobalAttribute(const std::string & line, size_t lc)
             str = getNextToken(line, pos, &last, WHITESPACE);
             pos = last;
         }
+    } else if (token == "decoder_backend") {
+        std::string str = getNextToken(line, pos, &last, WHITESPACE);
+        if (!parseDecoderBackend(str, &m_decoderBackend)) {
+            fprintf(stderr, "line %u: unknown decoder backend '%s'\n", (uint) lc, str.c_str());
+        }
     }
     else {
         fprintf(stderr, "WARNING: %u : unknown global attribute %s\n", (unsigned int)lc, line.c_str());
@@ -26,11 +26,14 @@ class ApiGen : public std::vector<EntryPoint> {
 public:
     typedef std::vector<std::string> StringVec;
     typedef enum { CLIENT_SIDE, SERVER_SIDE, WRAPPER_SIDE } SideType;
+    typedef enum { DECODER_SWITCH, DECODER_TABLE } DecoderBackend;
 
     ApiGen(const std::string & basename) :
         m_basename(basename),
         m_maxEntryPointsParams(0),
-        m_baseOpcode(0)
+        m_baseOpcode(0),
+        m_decoderBackend(DECODER_SWITCH),
+        m_encoderBatching(false)
     { }
     virtual ~ApiGen() {}
     int readSpec(const std::string & filename);
@@ -41,6 +44,13 @@ public:
     }
     int baseOpcode() { return m_baseOpcode; }
     void setBaseOpcode(int base) { m_baseOpcode = base; }
+    DecoderBackend decoderBackend() { return m_decoderBackend; }
+    void setDecoderBackend(DecoderBackend backend) { m_decoderBackend = backend; }
+    // the encoder coalesces calls of the 'batched' entry points, the
+    // decoder always accepts them
+    bool encoderBatching() { return m_encoderBatching; }
+    void setEncoderBatching(bool state) { m_encoderBatching = state; }
+    static bool parseDecoderBackend(const std::string & name, DecoderBackend *backend);
 
     const char *sideString(SideType side) {
         const char *retval;
@@ -64,6 +74,8 @@ public:
     StringVec & decoderHeaders() { return m_decoderHeaders; }
 
     EntryPoint * findEntryByName(const std::string & name);
+    // entry points plus the batched opcodes, numbered after them
+    size_t numOpcodes();
     int genOpcodes(const std::string &filename);
     int genAttributesTemplate(const std::string &filename);
     int genProcTypes(const std::string &filename, SideType side);
@@ -82,6 +94,7 @@ public:
 
 protected:
     virtual void printHeader(FILE *fp) const;
+    int genDecoderTableImpl(FILE *fp);
     std::string m_basename;
     StringVec m_clientContextHeaders;
     StringVec m_encoderHeaders;
@@ -89,6 +102,8 @@ protected:
     StringVec m_decoderHeaders;
     size_t m_maxEntryPointsParams; // record the maximum number of parameters in the entry points;
     int m_baseOpcode;
+    DecoderBackend m_decoderBackend;
+    bool m_encoderBatching;
     int setGlobalAttribute(const std::string & line, size_t lc);
 };
 
@@ -35,6 +35,7 @@ void EntryPoint::reset()
     m_unsupported = false;
     m_customDecoder = false;
     m_notApi = false;
+    m_batched = false;
     m_vars.empty();
 }
 
@@ -365,6 +366,19 @@ int EntryPoint::setAttribute(const std::string &line, size_t lc)
             setCustomDecoder(true);
         } else if (flag == "not_api") {
             setNotApi(true);
+        } else if (flag == "batched") {
+            // consecutive calls are coalesced into one packet, which only
+            // works for fixed size arguments and no reply
+            size_t argBytes = 0;
+            for (size_t i = 0; i < m_vars.size(); i++) {
+                argBytes += m_vars[i].type()->bytes();
+            }
+            if (hasPointers() || !m_retval.isVoid() || argBytes == 0) {
+                fprintf(stderr, "WARNING: %u: %s can't be batched, it needs fixed size arguments and no return value\n",
+                        (unsigned int)lc, name().c_str());
+            } else {
+                setBatched(true);
+            }
         } else {
             fprintf(stderr, "WARNING: %u: unknown flag %s\n", (unsigned int)lc, flag.c_str());
         }
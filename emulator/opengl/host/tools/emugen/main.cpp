@@ -35,6 +35,8 @@ void usage(const char *filename)
     fprintf(stderr, "\t-i: input dir, local directory by default\n");
     fprintf(stderr, "\t-T : generate attribute template into the input directory\n\t\tno other files are generated\n");
     fprintf(stderr, "\t-W : generate wrapper into dir\n");
+    fprintf(stderr, "\t-B <switch|table>: decoder backend, overrides the decoder_backend attribute\n");
+    fprintf(stderr, "\t-b : encoder batches the calls of the 'batched' entry points,\n\t\tthe stream and the decoder must support it\n");
 }
 
 int main(int argc, char *argv[])
@@ -44,9 +46,11 @@ int main(int argc, char *argv[])
     std::string wrapperDir = "";
     std::string inDir = ".";
     bool generateAttributesTemplate = false;
+    std::string decoderBackend = "";
+    bool encoderBatching = false;
 
     int c;
-    while((c = getopt(argc, argv, "TE:D:i:hW:")) != -1) {
+    while((c = getopt(argc, argv, "TE:D:i:hW:B:b")) != -1) {
         switch(c) {
         case 'W':
             wrapperDir = std::string(optarg);
@@ -67,6 +71,12 @@ int main(int argc, char *argv[])
         case 'i':
             inDir = std::string(optarg);
             break;
+        case 'B':
+            decoderBackend = std::string(optarg);
+            break;
+        case 'b':
+            encoderBatching = true;
+            break;
         case ':':
             fprintf(stderr, "Missing argument !!\n");
             // fall through
@@ -118,6 +128,16 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
+    if (decoderBackend.size() != 0) {
+        ApiGen::DecoderBackend backend;
+        if (!ApiGen::parseDecoderBackend(decoderBackend, &backend)) {
+            fprintf(stderr, "unknown decoder backend %s\n", decoderBackend.c_str());
+            return BAD_USAGE;
+        }
+        apiEntries.setDecoderBackend(backend);
+    }
+    apiEntries.setEncoderBatching(encoderBatching);
+
     if (encoderDir.size() != 0) {
 
         apiEntries.genOpcodes(encoderDir + "/" + baseName + "_opcodes.h");
@@ -19,6 +19,10 @@ else
     host_commonSources += UnixStream.cpp
 endif
 
+ifeq ($(HOST_OS),linux)
+    host_commonSources += SharedMemoryStream.cpp
+endif
+
 
 ### OpenglCodecCommon  host ##############################################
 $(call emugl-begin-host-static-library,libOpenglCodecCommon)
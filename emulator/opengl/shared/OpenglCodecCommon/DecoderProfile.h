@@ -0,0 +1,136 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _DECODER_PROFILE_H
+#define _DECODER_PROFILE_H
+
+#include "TimeUtils.h"
+#include <string.h>
+
+//
+// Per entry point profile of the packets an emugen generated decoder
+// decoded: calls, payload bytes and a histogram of the time taken by
+// each packet, the call into the dispatch included.
+//
+// A decoder fills the profile attached to it (the 'profile' member of
+// the decoder context, NULL by default) and only the thread decoding
+// with that context writes to it, so there is no locking. Other
+// threads may read it at any time, they see counts a few packets late
+// and maybe a count updated without the matching time.
+//
+class DecoderProfile
+{
+public:
+    //
+    // Bucket 0 counts packets decoded in less than 64ns, bucket i the
+    // ones which took [64ns << (i-1), 64ns << i), the last bucket
+    // anything longer.
+    //
+    enum { NUM_BUCKETS = 20 };
+
+    struct Entry {
+        unsigned long long calls;
+        unsigned long long bytes;
+        unsigned long long timeNs;
+        unsigned int hist[NUM_BUCKETS];
+    };
+
+    typedef const char *(*opcode_name_proc_t)(unsigned int opcode);
+
+    DecoderProfile(unsigned int p_baseOpcode, unsigned int p_lastOpcode,
+                   opcode_name_proc_t p_opcodeName) :
+        m_baseOpcode(p_baseOpcode),
+        m_size(p_lastOpcode - p_baseOpcode),
+        m_opcodeName(p_opcodeName)
+    {
+        m_entries = new Entry[m_size];
+        reset();
+    }
+
+    ~DecoderProfile() {
+        delete [] m_entries;
+    }
+
+    static long long now() { return GetCurrentTimeNS(); }
+
+    // p_index is the opcode minus the base opcode of the decoder
+    void add(unsigned int p_index, unsigned int p_bytes, long long p_ns) {
+        Entry &e = m_entries[p_index];
+        e.calls++;
+        e.bytes += p_bytes;
+        e.timeNs += p_ns;
+        e.hist[bucket(p_ns)]++;
+    }
+
+    void reset() {
+        memset(m_entries, 0, m_size * sizeof(Entry));
+    }
+
+    unsigned int baseOpcode() const { return m_baseOpcode; }
+    unsigned int size() const { return m_size; }
+    const Entry &entry(unsigned int p_index) const { return m_entries[p_index]; }
+    const char *name(unsigned int p_index) const {
+        return m_opcodeName(m_baseOpcode + p_index);
+    }
+
+    // upper limit of the time of a bucket
+    static long long bucketLimitNs(int p_bucket) { return 64LL << p_bucket; }
+
+    //
+    // A time at least p_percent of the calls of the entry did not
+    // exceed, to the precision of the histogram.
+    //
+    static long long percentileNs(const Entry &p_entry, int p_percent) {
+        unsigned long long total = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            total += p_entry.hist[i];
+        }
+        unsigned long long want = (total * p_percent + 99) / 100;
+        unsigned long long n = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            n += p_entry.hist[i];
+            if (n >= want && n > 0) {
+                return bucketLimitNs(i);
+            }
+        }
+        return 0;
+    }
+
+private:
+    static int bucket(long long p_ns) {
+        unsigned long long v = (unsigned long long)p_ns >> 6;
+        if (v == 0) {
+            return 0;
+        }
+#ifdef __GNUC__
+        int b = 64 - __builtin_clzll(v);
+#else
+        int b = 0;
+        while (v) {
+            v >>= 1;
+            b++;
+        }
+#endif
+        return b < NUM_BUCKETS ? b : NUM_BUCKETS - 1;
+    }
+
+private:
+    unsigned int m_baseOpcode;
+    unsigned int m_size;
+    opcode_name_proc_t m_opcodeName;
+    Entry *m_entries;
+};
+
+#endif
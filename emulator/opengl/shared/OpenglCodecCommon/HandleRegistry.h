@@ -0,0 +1,145 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _HANDLE_REGISTRY_H
+#define _HANDLE_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+//
+// A dense array of slots which hands out 32 bit handles for the values
+// stored in it. A handle is made of:
+//
+//   | generation (12 bits) | slot index (14 bits) | tag (6 bits) |
+//
+// so a lookup is an array access and a compare. The generation of a
+// slot changes every time its value is removed, a handle kept after
+// remove() no longer matches and is rejected, until the generation
+// wraps around. Generations start at 1, a valid handle is never 0.
+//
+// The tag is fixed for a registry, it lets several registries share one
+// handle space without clashes (see HandleTable).
+//
+// HandleRegistry does no locking.
+//
+template <class T>
+class HandleRegistry
+{
+public:
+    enum {
+        TAG_BITS = 6,
+        INDEX_BITS = 14,
+        GEN_BITS = 12,
+        MAX_TAG = (1 << TAG_BITS) - 1,
+        MAX_SLOTS = 1 << INDEX_BITS
+    };
+
+    explicit HandleRegistry(uint32_t p_tag = 0) : m_tag(p_tag & MAX_TAG) {}
+
+    static uint32_t tagOf(uint32_t p_handle) {
+        return p_handle & MAX_TAG;
+    }
+
+    //
+    // Stores a copy of p_value, returns its handle or 0 when all the
+    // slots are in use.
+    //
+    uint32_t add(const T &p_value) {
+        uint32_t index;
+        if (!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+        } else if (m_slots.size() < MAX_SLOTS) {
+            index = m_slots.size();
+            m_slots.push_back(Slot());
+        } else {
+            return 0;
+        }
+
+        Slot &s = m_slots[index];
+        s.value = p_value;
+        s.used = true;
+        return (s.gen << (INDEX_BITS + TAG_BITS)) |
+               (index << TAG_BITS) | m_tag;
+    }
+
+    // the returned pointer is valid until the next add() or remove()
+    T *lookup(uint32_t p_handle) {
+        Slot *s = slotFor(p_handle);
+        return s ? &s->value : NULL;
+    }
+
+    bool remove(uint32_t p_handle, T *p_value = NULL) {
+        Slot *s = slotFor(p_handle);
+        if (!s) {
+            return false;
+        }
+        if (p_value) {
+            *p_value = s->value;
+        }
+        release(s);
+        return true;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < m_slots.size(); i++) {
+            if (m_slots[i].used) {
+                release(&m_slots[i]);
+            }
+        }
+    }
+
+    size_t size() const {
+        return m_slots.size() - m_free.size();
+    }
+
+private:
+    struct Slot {
+        Slot() : value(), gen(1), used(false) {}
+        T value;
+        uint32_t gen;
+        bool used;
+    };
+
+    Slot *slotFor(uint32_t p_handle) {
+        uint32_t index = (p_handle >> TAG_BITS) & (MAX_SLOTS - 1);
+        if ((p_handle & MAX_TAG) != m_tag || index >= m_slots.size()) {
+            return NULL;
+        }
+        Slot *s = &m_slots[index];
+        if (!s->used || s->gen != (p_handle >> (INDEX_BITS + TAG_BITS))) {
+            return NULL;
+        }
+        return s;
+    }
+
+    void release(Slot *p_slot) {
+        p_slot->value = T();
+        p_slot->used = false;
+        if (++p_slot->gen == (1u << GEN_BITS)) {
+            p_slot->gen = 1;
+        }
+        m_free.push_back(p_slot - &m_slots[0]);
+    }
+
+private:
+    uint32_t m_tag;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_free;
+};
+
+#endif
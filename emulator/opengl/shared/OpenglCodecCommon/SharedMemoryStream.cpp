@@ -0,0 +1,524 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "SharedMemoryStream.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <linux/futex.h>
+
+// how long to sleep before checking that the peer is still there
+#define PEER_CHECK_INTERVAL_MS 200
+
+//
+// Shared state of one ring. 'head' and 'tail' count the bytes written
+// and read since the ring was created, their difference is the amount
+// of data in the ring (RING_SIZE is a power of two).
+//
+struct SharedMemoryStream::RingHeader {
+    volatile unsigned int head;
+    volatile unsigned int tail;
+    volatile int dataSeq;         // futex, bumped by the writer
+    volatile int spaceSeq;        // futex, bumped by the reader
+    volatile int readerWaiting;
+    volatile int writerWaiting;
+    volatile int closed;
+};
+
+static int futexWait(volatile int *addr, int val, int timeoutMs)
+{
+    struct timespec ts;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000000;
+    return syscall(SYS_futex, (int *)addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futexWake(volatile int *addr)
+{
+    syscall(SYS_futex, (int *)addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+//
+// Map 'size' bytes of 'fd' at 'offset' twice, back-to-back.
+//
+static unsigned char *mapMirrored(int fd, off_t offset, size_t size)
+{
+    unsigned char *base = (unsigned char *)mmap(NULL, size * 2, PROT_NONE,
+                                                MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    void *lo = mmap(base, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, offset);
+    void *hi = mmap(base + size, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, offset);
+    if (lo != base || hi != base + size) {
+        munmap(base, size * 2);
+        return NULL;
+    }
+    return base;
+}
+
+SharedMemoryStream::SharedMemoryStream(size_t bufSize) :
+    UnixStream(bufSize),
+    m_header(NULL),
+    m_txHeader(NULL),
+    m_rxHeader(NULL),
+    m_tx(NULL),
+    m_rx(NULL),
+    m_ringSize(0),
+    m_staged(false),
+    m_allocSize(bufSize)
+{
+}
+
+SharedMemoryStream::SharedMemoryStream(int sock, size_t bufSize) :
+    UnixStream(sock, bufSize),
+    m_header(NULL),
+    m_txHeader(NULL),
+    m_rxHeader(NULL),
+    m_tx(NULL),
+    m_rx(NULL),
+    m_ringSize(0),
+    m_staged(false),
+    m_allocSize(bufSize)
+{
+}
+
+SharedMemoryStream::~SharedMemoryStream()
+{
+    if (m_header) {
+        //
+        // wake up the peer if it is waiting on us
+        //
+        m_txHeader->closed = 1;
+        m_rxHeader->closed = 1;
+        __sync_synchronize();
+        futexWake(&m_txHeader->dataSeq);
+        futexWake(&m_rxHeader->spaceSeq);
+    }
+    unmapRings();
+}
+
+bool SharedMemoryStream::mapRings(int fd, size_t ringSize, bool isServer)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    if (ringSize == 0 || (ringSize & (ringSize - 1)) != 0 ||
+        (ringSize & (pageSize - 1)) != 0) {
+        ERR("SharedMemoryStream: bad ring size %zu\n", ringSize);
+        return false;
+    }
+
+    m_header = (unsigned char *)mmap(NULL, pageSize, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED, fd, 0);
+    if (m_header == MAP_FAILED) {
+        m_header = NULL;
+        return false;
+    }
+    m_ringSize = ringSize;
+
+    //
+    // ring 0 carries client to server data, ring 1 the replies
+    //
+    unsigned char *ring0 = mapMirrored(fd, pageSize, ringSize);
+    unsigned char *ring1 = mapMirrored(fd, pageSize + ringSize, ringSize);
+    RingHeader *hdr0 = (RingHeader *)m_header;
+    RingHeader *hdr1 = hdr0 + 1;
+
+    if (isServer) {
+        m_rx = ring0;
+        m_rxHeader = hdr0;
+        m_tx = ring1;
+        m_txHeader = hdr1;
+    } else {
+        m_tx = ring0;
+        m_txHeader = hdr0;
+        m_rx = ring1;
+        m_rxHeader = hdr1;
+    }
+
+    if (!ring0 || !ring1) {
+        unmapRings();
+        return false;
+    }
+    return true;
+}
+
+void SharedMemoryStream::unmapRings()
+{
+    if (m_tx) {
+        munmap(m_tx, m_ringSize * 2);
+        m_tx = NULL;
+    }
+    if (m_rx) {
+        munmap(m_rx, m_ringSize * 2);
+        m_rx = NULL;
+    }
+    if (m_header) {
+        munmap(m_header, (size_t)sysconf(_SC_PAGESIZE));
+        m_header = NULL;
+    }
+    m_txHeader = NULL;
+    m_rxHeader = NULL;
+}
+
+//
+// Server side: create the shared memory and hand it to the client
+// together with the ring size.
+//
+bool SharedMemoryStream::createRings(size_t ringSize)
+{
+    static unsigned int s_seq = 0;
+
+    int fd = -1;
+    char name[64];
+    for (int i = 0; i < 16 && fd < 0; i++) {
+        snprintf(name, sizeof(name), "/emugl-stream-%d-%u",
+                 (int)getpid(), __sync_fetch_and_add(&s_seq, 1));
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno != EEXIST) {
+            break;
+        }
+    }
+    if (fd < 0) {
+        ERR("SharedMemoryStream: shm_open failed: %s\n", strerror(errno));
+        return false;
+    }
+    shm_unlink(name);
+
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    if (ftruncate(fd, pageSize + ringSize * 2) < 0 ||
+        !mapRings(fd, ringSize, true)) {
+        ERR("SharedMemoryStream: failed to map %zu bytes rings\n", ringSize);
+        close(fd);
+        return false;
+    }
+
+    unsigned int size = (unsigned int)ringSize;
+    struct iovec iov;
+    iov.iov_base = &size;
+    iov.iov_len = sizeof(size);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = ::sendmsg(m_sock, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+
+    if (n != (ssize_t)sizeof(size)) {
+        ERR("SharedMemoryStream: failed to send the rings: %s\n", strerror(errno));
+        unmapRings();
+        return false;
+    }
+    return true;
+}
+
+SocketStream *SharedMemoryStream::accept()
+{
+    while (true) {
+        int clientSock = -1;
+        do {
+            struct sockaddr_un addr;
+            socklen_t len = sizeof(addr);
+            clientSock = ::accept(m_sock, (sockaddr *)&addr, &len);
+        } while (clientSock < 0 && errno == EINTR);
+
+        if (clientSock < 0) {
+            return NULL;
+        }
+
+        SharedMemoryStream *clientStream = new SharedMemoryStream(clientSock, m_bufsize);
+        if (clientStream->createRings(RING_SIZE)) {
+            return clientStream;
+        }
+
+        // drop this client but keep serving the others
+        delete clientStream;
+    }
+}
+
+int SharedMemoryStream::connect(const char* addr)
+{
+    if (UnixStream::connect(addr) < 0) {
+        return -1;
+    }
+
+    unsigned int size = 0;
+    struct iovec iov;
+    iov.iov_base = &size;
+    iov.iov_len = sizeof(size);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do {
+        n = ::recvmsg(m_sock, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (n != (ssize_t)sizeof(size) || !cmsg ||
+        cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        ERR("SharedMemoryStream: did not receive the rings\n");
+        return -1;
+    }
+
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    bool mapped = mapRings(fd, size, false);
+    close(fd);
+
+    return mapped ? 0 : -1;
+}
+
+bool SharedMemoryStream::peerAlive()
+{
+    if (m_rxHeader->closed || m_txHeader->closed) {
+        return false;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = m_sock;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) > 0) {
+        if (pfd.revents & (POLLHUP | POLLERR)) {
+            return false;
+        }
+        char c;
+        if (::recv(m_sock, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// Wait until 'len' bytes are free in the transmit ring and return
+// where to write them, NULL if the peer went away.
+//
+unsigned char *SharedMemoryStream::waitForSpace(size_t len)
+{
+    RingHeader *h = m_txHeader;
+
+    for (;;) {
+        int seq = h->spaceSeq;
+        __sync_synchronize();
+        if (m_ringSize - (h->head - h->tail) >= len) {
+            return m_tx + (h->head & (m_ringSize - 1));
+        }
+        if (h->closed) {
+            return NULL;
+        }
+
+        h->writerWaiting = 1;
+        __sync_synchronize();
+        if (m_ringSize - (h->head - h->tail) >= len) {
+            h->writerWaiting = 0;
+            continue;
+        }
+
+        int ret = futexWait(&h->spaceSeq, seq, PEER_CHECK_INTERVAL_MS);
+        h->writerWaiting = 0;
+        if (ret < 0 && errno == ETIMEDOUT && !peerAlive()) {
+            return NULL;
+        }
+    }
+}
+
+void SharedMemoryStream::produce(size_t len)
+{
+    RingHeader *h = m_txHeader;
+
+    __sync_synchronize(); // data before head
+    h->head += len;
+    __sync_synchronize();
+    __sync_fetch_and_add(&h->dataSeq, 1);
+    if (h->readerWaiting) {
+        futexWake(&h->dataSeq);
+    }
+}
+
+//
+// Wait for data in the receive ring and return how much there is,
+// 0 if the peer went away.
+//
+size_t SharedMemoryStream::waitForData()
+{
+    RingHeader *h = m_rxHeader;
+
+    for (;;) {
+        int seq = h->dataSeq;
+        __sync_synchronize();
+        size_t avail = h->head - h->tail;
+        if (avail > 0) {
+            return avail;
+        }
+        if (h->closed) {
+            return 0;
+        }
+
+        h->readerWaiting = 1;
+        __sync_synchronize();
+        if (h->head != h->tail) {
+            h->readerWaiting = 0;
+            continue;
+        }
+
+        int ret = futexWait(&h->dataSeq, seq, PEER_CHECK_INTERVAL_MS);
+        h->readerWaiting = 0;
+        if (ret < 0 && errno == ETIMEDOUT && !peerAlive()) {
+            return 0;
+        }
+    }
+}
+
+void SharedMemoryStream::consume(size_t len)
+{
+    RingHeader *h = m_rxHeader;
+
+    __sync_synchronize(); // done reading before giving the space back
+    h->tail += len;
+    __sync_synchronize();
+    __sync_fetch_and_add(&h->spaceSeq, 1);
+    if (h->writerWaiting) {
+        futexWake(&h->spaceSeq);
+    }
+}
+
+void *SharedMemoryStream::allocBuffer(size_t minSize)
+{
+    if (!m_header) return NULL;
+
+    //
+    // Big buffers would stall until the reader drains most of the
+    // ring, build them on the heap and stream them in commitBuffer().
+    //
+    if (minSize > m_ringSize / 2) {
+        m_staged = true;
+        return SocketStream::allocBuffer(minSize);
+    }
+
+    m_staged = false;
+    return waitForSpace(minSize);
+}
+
+int SharedMemoryStream::commitBuffer(size_t size)
+{
+    if (m_staged) {
+        m_staged = false;
+        // the next packets fit in the ring again
+        setBufferSize(m_allocSize);
+        return writeFully(m_buf, size);
+    }
+
+    produce(size);
+    return 0;
+}
+
+int SharedMemoryStream::writeFully(const void *buf, size_t len)
+{
+    if (!m_header) return -1;
+
+    const unsigned char *src = (const unsigned char *)buf;
+    while (len > 0) {
+        // smaller chunks let the reader start while we copy
+        size_t chunk = len < m_ringSize / 4 ? len : m_ringSize / 4;
+        unsigned char *dst = waitForSpace(chunk);
+        if (!dst) {
+            ERR("SharedMemoryStream::writeFully: peer closed\n");
+            return -1;
+        }
+        memcpy(dst, src, chunk);
+        produce(chunk);
+        src += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+const unsigned char *SharedMemoryStream::readFully(void *buf, size_t len)
+{
+    if (!m_header || !buf) return NULL;
+
+    unsigned char *dst = (unsigned char *)buf;
+    while (len > 0) {
+        size_t avail = waitForData();
+        if (avail == 0) {
+            return NULL;
+        }
+        size_t n = avail < len ? avail : len;
+        memcpy(dst, m_rx + (m_rxHeader->tail & (m_ringSize - 1)), n);
+        consume(n);
+        dst += n;
+        len -= n;
+    }
+    return (const unsigned char *)buf;
+}
+
+const unsigned char *SharedMemoryStream::read(void *buf, size_t *inout_len)
+{
+    int n = recv(buf, *inout_len);
+    if (n > 0) {
+        *inout_len = n;
+        return (const unsigned char *)buf;
+    }
+    return NULL;
+}
+
+int SharedMemoryStream::recv(void *buf, size_t len)
+{
+    if (!m_header || !buf) return -1;
+
+    size_t avail = waitForData();
+    if (avail == 0) {
+        return 0;
+    }
+    if (len > INT_MAX) len = INT_MAX;
+    size_t n = avail < len ? avail : len;
+    memcpy(buf, m_rx + (m_rxHeader->tail & (m_ringSize - 1)), n);
+    consume(n);
+    return (int)n;
+}
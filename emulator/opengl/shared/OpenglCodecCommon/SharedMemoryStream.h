@@ -0,0 +1,76 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef __SHARED_MEMORY_STREAM_H
+#define __SHARED_MEMORY_STREAM_H
+
+#include "UnixStream.h"
+
+//
+// A stream whose data goes through a pair of shared memory rings
+// (one per direction) instead of the socket. The unix socket is only
+// used to hand the shared memory over to the client when accepting a
+// connection and to notice when the peer goes away. Readers and
+// writers sleep on futexes in the shared memory, and only make a
+// system call when the other side actually waits.
+//
+// Each ring is mapped twice back-to-back so that allocBuffer() can
+// return a contiguous region of the ring and the encoder writes the
+// commands in place. Linux only.
+//
+class SharedMemoryStream : public UnixStream {
+public:
+    static const size_t RING_SIZE = 4 * 1024 * 1024;
+
+    explicit SharedMemoryStream(size_t bufsize = 10000);
+    virtual ~SharedMemoryStream();
+
+    virtual SocketStream *accept();
+    virtual int connect(const char* addr);
+
+    virtual void *allocBuffer(size_t minSize);
+    virtual int commitBuffer(size_t size);
+    virtual const unsigned char *readFully(void *buf, size_t len);
+    virtual const unsigned char *read(void *buf, size_t *inout_len);
+    virtual int recv(void *buf, size_t len);
+    virtual int writeFully(const void *buf, size_t len);
+
+private:
+    struct RingHeader;
+
+    SharedMemoryStream(int sock, size_t bufSize);
+
+    bool createRings(size_t ringSize);
+    bool mapRings(int fd, size_t ringSize, bool isServer);
+    void unmapRings();
+
+    unsigned char *waitForSpace(size_t len);
+    void produce(size_t len);
+    size_t waitForData();
+    void consume(size_t len);
+    bool peerAlive();
+
+private:
+    unsigned char *m_header;     // page holding both RingHeaders
+    RingHeader    *m_txHeader;
+    RingHeader    *m_rxHeader;
+    unsigned char *m_tx;         // mirrored rings
+    unsigned char *m_rx;
+    size_t         m_ringSize;
+    bool           m_staged;     // last allocBuffer() used the heap buffer
+    size_t         m_allocSize;  // IOStream buffer size outside of staging
+};
+
+#endif
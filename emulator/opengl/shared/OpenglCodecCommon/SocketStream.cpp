@@ -20,11 +20,13 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <assert.h>
 
 #ifndef _WIN32
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #else
 #include <ws2tcpip.h>
 #endif
@@ -33,7 +35,11 @@ SocketStream::SocketStream(size_t bufSize) :
     IOStream(bufSize),
     m_sock(-1),
     m_bufsize(bufSize),
-    m_buf(NULL)
+    m_buf(NULL),
+    m_batchHighWaterMark(0),
+    m_pending(0),
+    m_sendCount(0),
+    m_allocOpen(false)
 {
 }
 
@@ -41,12 +47,17 @@ SocketStream::SocketStream(int sock, size_t bufSize) :
     IOStream(bufSize),
     m_sock(sock),
     m_bufsize(bufSize),
-    m_buf(NULL)
+    m_buf(NULL),
+    m_batchHighWaterMark(0),
+    m_pending(0),
+    m_sendCount(0),
+    m_allocOpen(false)
 {
 }
 
 SocketStream::~SocketStream()
 {
+    flushPending();
     if (m_sock >= 0) {
 #ifdef _WIN32
         closesocket(m_sock);
@@ -63,9 +74,14 @@ SocketStream::~SocketStream()
 
 void *SocketStream::allocBuffer(size_t minSize)
 {
-    size_t allocSize = (m_bufsize < minSize ? minSize : m_bufsize);
+    // committed data still pending stays at the start of the buffer
+    size_t needed = m_pending + minSize;
+    size_t allocSize = (m_bufsize < needed ? needed : m_bufsize);
     if (!m_buf) {
         m_buf = (unsigned char *)malloc(allocSize);
+        if (m_buf != NULL) {
+            m_bufsize = allocSize;
+        }
     }
     else if (m_bufsize < allocSize) {
         unsigned char *p = (unsigned char *)realloc(m_buf, allocSize);
@@ -73,30 +89,101 @@ void *SocketStream::allocBuffer(size_t minSize)
             m_buf = p;
             m_bufsize = allocSize;
         } else {
+            //
+            // send the pending data to make room, the buffer is still
+            // the old one, then try again with the new data alone.
+            //
             ERR("%s: realloc (%zu) failed\n", __FUNCTION__, allocSize);
-            free(m_buf);
-            m_buf = NULL;
-            m_bufsize = 0;
+            if (flushPending() < 0) {
+                return NULL;
+            }
+            if (m_bufsize < minSize) {
+                p = (unsigned char *)realloc(m_buf, minSize);
+                if (p == NULL) {
+                    ERR("%s: realloc (%zu) failed\n", __FUNCTION__, minSize);
+                    return NULL;
+                }
+                m_buf = p;
+                m_bufsize = minSize;
+            }
         }
     }
 
-    return m_buf;
+    m_allocOpen = (m_buf != NULL);
+    return m_buf ? m_buf + m_pending : NULL;
 };
 
 int SocketStream::commitBuffer(size_t size)
 {
-    return writeFully(m_buf, size);
+    m_allocOpen = false;
+    if (m_batchHighWaterMark == 0) {
+        return writeFully(m_buf, size);
+    }
+
+    m_pending += size;
+    if (m_pending >= m_batchHighWaterMark) {
+        return flushPending();
+    }
+    return 0;
+}
+
+void SocketStream::setBatching(size_t highWaterMark)
+{
+    commit();
+    if (highWaterMark == 0) {
+        flushPending();
+    }
+    m_batchHighWaterMark = highWaterMark;
+}
+
+int SocketStream::flushPending()
+{
+    if (m_pending == 0) return 0;
+    assert(!m_allocOpen);
+
+    size_t len = m_pending;
+    m_pending = 0;
+    return sendFully(m_buf, len);
 }
 
 int SocketStream::writeFully(const void* buffer, size_t size)
 {
     if (!valid()) return -1;
 
+    if (m_pending > 0) {
+        assert(!m_allocOpen);
+#ifndef _WIN32
+        //
+        // send the pending batch and the new data with one system call
+        //
+        struct iovec iov[2];
+        iov[0].iov_base = m_buf;
+        iov[0].iov_len = m_pending;
+        iov[1].iov_base = (void *)buffer;
+        iov[1].iov_len = size;
+        m_pending = 0;
+        return sendFullyv(iov, 2);
+#else
+        int stat = flushPending();
+        if (stat < 0) {
+            return stat;
+        }
+#endif
+    }
+
+    return sendFully(buffer, size);
+}
+
+int SocketStream::sendFully(const void* buffer, size_t size)
+{
+    if (!valid()) return -1;
+
     size_t res = size;
     int retval = 0;
 
     while (res > 0) {
         ssize_t stat = ::send(m_sock, (const char *)buffer + (size - res), res, 0);
+        m_sendCount++;
         if (stat < 0) {
             if (errno != EINTR) {
                 retval =  stat;
@@ -110,6 +197,36 @@ int SocketStream::writeFully(const void* buffer, size_t size)
     return retval;
 }
 
+#ifndef _WIN32
+int SocketStream::sendFullyv(struct iovec *iov, int count)
+{
+    if (!valid()) return -1;
+
+    while (count > 0) {
+        ssize_t stat = ::writev(m_sock, iov, count);
+        m_sendCount++;
+        if (stat < 0) {
+            if (errno != EINTR) {
+                ERR("%s: failed: %s\n", __FUNCTION__, strerror(errno));
+                return stat;
+            }
+            continue;
+        }
+        // skip what has been sent
+        while (count > 0 && (size_t)stat >= iov->iov_len) {
+            stat -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + stat;
+            iov->iov_len -= stat;
+        }
+    }
+    return 0;
+}
+#endif
+
 const unsigned char *SocketStream::readFully(void *buf, size_t len)
 {
     const unsigned char* ret = NULL;
@@ -117,6 +234,9 @@ const unsigned char *SocketStream::readFully(void *buf, size_t len)
     if (!buf) {
       return NULL;  // do not allow NULL buf in that implementation
     }
+    if (flushPending() < 0) {
+        return NULL; // the reply will never come
+    }
     size_t res = len;
     while (res > 0) {
         ssize_t stat = ::recv(m_sock, (char *)(buf) + len - res, res, 0);
@@ -137,6 +257,9 @@ const unsigned char *SocketStream::read( void *buf, size_t *inout_len)
     if (!buf) {
       return NULL;  // do not allow NULL buf in that implementation
     }
+    if (flushPending() < 0) {
+        return NULL;
+    }
 
     int n;
     do {
@@ -19,6 +19,10 @@
 #include <stdlib.h>
 #include "IOStream.h"
 
+#ifndef _WIN32
+struct iovec;
+#endif
+
 class SocketStream : public IOStream {
 public:
     typedef enum { ERR_INVALID_SOCKET = -1000 } SocketStreamError;
@@ -38,14 +42,44 @@ public:
 
     bool valid() { return m_sock >= 0; }
     virtual int recv(void *buf, size_t len);
+
+    //
+    // writeFully() and flushPending() send the pending batch, which
+    // moves a buffer allocated behind it: they must not be called
+    // while an allocBuffer() is not committed yet (asserted).
+    //
     virtual int writeFully(const void *buf, size_t len);
+    virtual int flushPending();
+
+    //
+    // Batching mode: committed buffers are queued and sent only once
+    // 'highWaterMark' bytes are pending, on flush()/readback(), or
+    // together with the next writeFully(). 0 (the default) sends every
+    // committed buffer right away. Commits the open IOStream buffer
+    // first.
+    //
+    void setBatching(size_t highWaterMark);
+    size_t batchHighWaterMark() const { return m_batchHighWaterMark; }
+
+    // number of send()/writev() calls made on the socket
+    unsigned int sendCount() const { return m_sendCount; }
 
 protected:
     int            m_sock;
     size_t         m_bufsize;
     unsigned char *m_buf;
+    size_t         m_batchHighWaterMark;
+    size_t         m_pending;      // committed bytes at the start of m_buf not sent yet
+    unsigned int   m_sendCount;
+    bool           m_allocOpen;    // allocBuffer() returned, commitBuffer() not called
 
     SocketStream(int sock, size_t bufSize);
+
+private:
+    int sendFully(const void *buf, size_t len);
+#ifndef _WIN32
+    int sendFullyv(struct iovec *iov, int count);
+#endif
 };
 
 #endif /* __SOCKET_STREAM_H */
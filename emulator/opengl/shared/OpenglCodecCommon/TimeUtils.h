@@ -17,6 +17,8 @@
 #define _TIME_UTILS_H
 
 long long GetCurrentTimeMS();
+long long GetCurrentTimeUS();
+long long GetCurrentTimeNS();
 void TimeSleepMS(int p_mili);
 
 #endif
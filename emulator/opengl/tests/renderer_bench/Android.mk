@@ -0,0 +1,126 @@
+LOCAL_PATH:=$(call my-dir)
+
+ifneq ($(HOST_OS),windows)
+
+renderer_PATH := ../../host/libs/libOpenglRender
+
+### ReadBuffer replay benchmark ##########################
+$(call emugl-begin-host-executable,readbuffer_bench)
+$(call emugl-import,libOpenglCodecCommon libOpenglOsUtils)
+
+LOCAL_SRC_FILES := \
+    ReadBufferBench.cpp \
+    $(renderer_PATH)/ReadBuffer.cpp
+
+LOCAL_C_INCLUDES += $(EMUGL_PATH)/host/libs/libOpenglRender
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+### Decoder dispatch benchmark ###########################
+$(call emugl-begin-host-executable,decoder_router_bench)
+$(call emugl-import,libOpenglCodecCommon libOpenglOsUtils libGLESv1_dec libGLESv2_dec lib_renderControl_dec)
+
+LOCAL_SRC_FILES := \
+    DecoderRouterBench.cpp \
+    $(renderer_PATH)/DecoderRouter.cpp
+
+LOCAL_C_INCLUDES += $(EMUGL_PATH)/host/libs/libOpenglRender
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+### Generated decoder benchmarks #########################
+# The same benchmark is built against decoders generated with each
+# emugen decoder backend.
+decoder_bench_INCLUDES := \
+    $(EMUGL_PATH)/host/libs/GLESv1_dec \
+    $(EMUGL_PATH)/host/libs/GLESv2_dec \
+    $(EMUGL_PATH)/host/libs/renderControl_dec
+
+$(call emugl-begin-host-executable,decoder_bench_switch)
+$(call emugl-import,libOpenglCodecCommon libOpenglOsUtils)
+
+$(call emugl-gen-decoder,$(EMUGL_PATH)/host/libs/GLESv1_dec,gl,-B switch)
+$(call emugl-gen-decoder,$(EMUGL_PATH)/host/libs/GLESv2_dec,gl2,-B switch)
+$(call emugl-gen-decoder,$(EMUGL_PATH)/host/libs/renderControl_dec,renderControl,-B switch)
+
+LOCAL_SRC_FILES := DecoderBackendBench.cpp
+LOCAL_C_INCLUDES += $(decoder_bench_INCLUDES)
+LOCAL_CFLAGS += -O2 -DDECODER_BACKEND=\"switch\"
+
+$(call emugl-end-module)
+
+$(call emugl-begin-host-executable,decoder_bench_table)
+$(call emugl-import,libOpenglCodecCommon libOpenglOsUtils)
+
+$(call emugl-gen-decoder,$(EMUGL_PATH)/host/libs/GLESv1_dec,gl,-B table)
+$(call emugl-gen-decoder,$(EMUGL_PATH)/host/libs/GLESv2_dec,gl2,-B table)
+$(call emugl-gen-decoder,$(EMUGL_PATH)/host/libs/renderControl_dec,renderControl,-B table)
+
+LOCAL_SRC_FILES := DecoderBackendBench.cpp
+LOCAL_C_INCLUDES += $(decoder_bench_INCLUDES)
+LOCAL_CFLAGS += -O2 -DDECODER_BACKEND=\"table\"
+
+$(call emugl-end-module)
+
+### SocketStream batching benchmark ######################
+$(call emugl-begin-host-executable,socket_batch_bench)
+$(call emugl-import,libOpenglCodecCommon libOpenglOsUtils)
+
+LOCAL_SRC_FILES := SocketBatchBench.cpp
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+### Vertex array conversion benchmark ####################
+$(call emugl-begin-host-executable,vertex_conversion_bench)
+$(call emugl-import,libOpenglCodecCommon libGLcommon)
+
+LOCAL_SRC_FILES := VertexConversionBench.cpp
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+### RangeList benchmark ##################################
+$(call emugl-begin-host-executable,rangelist_bench)
+$(call emugl-import,libOpenglCodecCommon libGLcommon)
+
+LOCAL_SRC_FILES := RangeListBench.cpp
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+### ETC1 decode benchmark ###############################
+$(call emugl-begin-host-executable,etc1_decode_bench)
+$(call emugl-import,libOpenglCodecCommon libOpenglOsUtils libGLcommon)
+
+LOCAL_SRC_FILES := Etc1DecodeBench.cpp
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+### Palette texture benchmark ###########################
+$(call emugl-begin-host-executable,palette_texture_bench)
+$(call emugl-import,libOpenglCodecCommon libGLcommon)
+
+LOCAL_SRC_FILES := PaletteTextureBench.cpp
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+### Captured stream replay ##############################
+# Replays a RENDERER_CAPTURE_FILE capture through libOpenglRender.
+$(call emugl-begin-host-executable,stream_replay)
+$(call emugl-import,libOpenglRender libOpenglCodecCommon libOpenglOsUtils)
+
+LOCAL_SRC_FILES := StreamReplay.cpp
+
+# use Translator's egl/gles headers
+LOCAL_C_INCLUDES += $(EMUGL_PATH)/host/libs/Translator/include
+LOCAL_STATIC_LIBRARIES += libutils liblog
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+endif # HOST_OS != windows
@@ -0,0 +1,184 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Measures packets/sec of the emugen generated GLESv1, GLESv2 and
+// renderControl decoders. This file is built once per emugen decoder
+// backend (decoder_bench_switch and decoder_bench_table), run both to
+// compare them.
+//
+// The decoders are bound to a no-op dispatch so that only the decoding
+// itself is measured.
+//
+// Runs of GLESv2 glUniform4f calls are also decoded sent one packet per
+// call and coalesced into OP_glUniform4f_batch packets, the way the
+// encoder sends the emugen 'batched' entry points.
+//
+// usage: decoder_bench_<backend> [-n passes]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "gl_dec.h"
+#include "gl2_dec.h"
+#include "gl2_opcodes.h"
+#include "renderControl_dec.h"
+#include "TimeUtils.h"
+#include "DumpStream.h"
+
+#ifndef DECODER_BACKEND
+#define DECODER_BACKEND "switch"
+#endif
+
+// large enough for the fixed size arguments of any entry point
+#define PACKET_SIZE 64
+#define PACKET_COUNT 100000
+#define RUN_LENGTH 8
+
+static void noopProc() {}
+
+static void *getNoopProc(const char *name, void *userData)
+{
+    return (void *)&noopProc;
+}
+
+//
+// Random calls of the given API. The payload is zero filled so
+// every pointer argument has a zero length.
+//
+static void buildStream(std::vector<unsigned char> &out,
+                        unsigned int baseOpcode, unsigned int lastOpcode)
+{
+    unsigned int seed = 1;
+    out.assign(PACKET_COUNT * PACKET_SIZE, 0);
+    for (size_t i = 0; i < PACKET_COUNT; i++) {
+        seed = seed * 1103515245 + 12345;
+        unsigned int opcode = baseOpcode + (seed >> 16) % (lastOpcode - baseOpcode);
+        unsigned int len = PACKET_SIZE;
+        memcpy(&out[i * PACKET_SIZE], &opcode, 4);
+        memcpy(&out[i * PACKET_SIZE + 4], &len, 4);
+    }
+}
+
+template <class T>
+static bool bench(const char *name, int passes)
+{
+    T dec;
+    dec.initDispatchByName(getNoopProc, NULL);
+
+    std::vector<unsigned char> packets;
+    buildStream(packets, T::baseOpcode, T::lastOpcode);
+    DumpStream stream;
+
+    long long t0 = GetCurrentTimeMS();
+    for (int i = 0; i < passes; i++) {
+        if (dec.decode(&packets[0], packets.size(), &stream) != packets.size()) {
+            fprintf(stderr, "%s: stream not fully decoded\n", name);
+            return false;
+        }
+    }
+    long long ms = GetCurrentTimeMS() - t0;
+
+    double total = (double)PACKET_COUNT * passes;
+    printf("%-14s %12.0f packets/s\n", name, ms > 0 ? total / (ms / 1000.0) : 0.0);
+    return true;
+}
+
+static bool decodeCalls(gl2_decoder_context_t &dec, const char *name,
+                        std::vector<unsigned char> &packets, int passes)
+{
+    DumpStream stream;
+
+    long long t0 = GetCurrentTimeMS();
+    for (int i = 0; i < passes; i++) {
+        if (dec.decode(&packets[0], packets.size(), &stream) != packets.size()) {
+            fprintf(stderr, "%s: stream not fully decoded\n", name);
+            return false;
+        }
+    }
+    long long ms = GetCurrentTimeMS() - t0;
+
+    double total = (double)PACKET_COUNT * passes;
+    printf("%-18s %12.0f calls/s %10u bytes\n", name,
+           ms > 0 ? total / (ms / 1000.0) : 0.0, (unsigned int)packets.size());
+    return true;
+}
+
+static void appendHeader(std::vector<unsigned char> &out,
+                         unsigned int opcode, unsigned int len)
+{
+    size_t at = out.size();
+    out.resize(at + 8);
+    memcpy(&out[at], &opcode, 4);
+    memcpy(&out[at + 4], &len, 4);
+}
+
+static bool benchBatched(int passes)
+{
+    gl2_decoder_context_t dec;
+    dec.initDispatchByName(getNoopProc, NULL);
+
+    // location, x, y, z, w
+    const unsigned int argSize = 20;
+    unsigned char args[argSize];
+    memset(args, 0, argSize);
+
+    std::vector<unsigned char> single;
+    std::vector<unsigned char> batched;
+    for (size_t i = 0; i < PACKET_COUNT; i++) {
+        appendHeader(single, OP_glUniform4f, 8 + argSize);
+        single.insert(single.end(), args, args + argSize);
+        if (i % RUN_LENGTH == 0) {
+            appendHeader(batched, OP_glUniform4f_batch, 8 + RUN_LENGTH * argSize);
+        }
+        batched.insert(batched.end(), args, args + argSize);
+    }
+
+    printf("runs of %d glUniform4f calls\n", RUN_LENGTH);
+    return decodeCalls(dec, "one per packet", single, passes) &&
+           decodeCalls(dec, "batched", batched, passes);
+}
+
+int main(int argc, char **argv)
+{
+    int passes = 50;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:")) != -1) {
+        switch (c) {
+        case 'n':
+            passes = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n passes]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%s decoders, %d packets per pass, %d passes\n",
+           DECODER_BACKEND, PACKET_COUNT, passes);
+
+    if (!bench<gl_decoder_context_t>("GLESv1", passes) ||
+        !bench<gl2_decoder_context_t>("GLESv2", passes) ||
+        !bench<renderControl_decoder_context_t>("renderControl", passes) ||
+        !benchBatched(passes)) {
+        return 1;
+    }
+    return 0;
+}
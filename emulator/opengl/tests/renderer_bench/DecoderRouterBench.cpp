@@ -0,0 +1,171 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Measures packets/sec of the GLESv1/GLESv2/renderControl decoders on
+// interleaved traffic, comparing the former "offer the buffer to every
+// decoder in turn" loop of RenderThread with the DecoderRouter.
+//
+// The decoders are bound to a no-op dispatch so that only the decode
+// and dispatch overhead is measured.
+//
+// usage: decoder_router_bench [-r maxRunLength] [-n passes]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "gl_dec.h"
+#include "gl2_dec.h"
+#include "renderControl_dec.h"
+#include "DecoderRouter.h"
+#include "TimeUtils.h"
+#include "DumpStream.h"
+
+#define PACKET_SIZE 64
+
+static void noopProc() {}
+
+static void *getNoopProc(const char *name, void *userData)
+{
+    return (void *)&noopProc;
+}
+
+//
+// Build 'count' packets where runs of 1..maxRun packets of one API
+// alternate randomly between the three APIs. The payload is zero
+// filled so every pointer argument has a zero length.
+//
+static void buildStream(std::vector<unsigned char> &out, size_t count, int maxRun)
+{
+    static const unsigned int ranges[3][2] = {
+        { gl_decoder_context_t::baseOpcode, gl_decoder_context_t::lastOpcode },
+        { gl2_decoder_context_t::baseOpcode, gl2_decoder_context_t::lastOpcode },
+        { renderControl_decoder_context_t::baseOpcode,
+          renderControl_decoder_context_t::lastOpcode },
+    };
+
+    unsigned int seed = 1;
+    out.assign(count * PACKET_SIZE, 0);
+    size_t i = 0;
+    while (i < count) {
+        seed = seed * 1103515245 + 12345;
+        int api = (seed >> 16) % 3;
+        int run = 1 + (seed >> 8) % maxRun;
+        for (; run > 0 && i < count; run--, i++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned int n = ranges[api][1] - ranges[api][0];
+            unsigned int opcode = ranges[api][0] + (seed >> 16) % n;
+            unsigned int len = PACKET_SIZE;
+            memcpy(&out[i * PACKET_SIZE], &opcode, 4);
+            memcpy(&out[i * PACKET_SIZE + 4], &len, 4);
+        }
+    }
+}
+
+struct Decoders {
+    gl_decoder_context_t gl;
+    gl2_decoder_context_t gl2;
+    renderControl_decoder_context_t rc;
+};
+
+static size_t cascadeDecode(Decoders &d, unsigned char *buf, size_t len, IOStream *stream)
+{
+    size_t pos = 0;
+    bool progress;
+    do {
+        progress = false;
+        size_t last = d.gl.decode(buf + pos, len - pos, stream);
+        if (last > 0) {
+            progress = true;
+            pos += last;
+        }
+        last = d.gl2.decode(buf + pos, len - pos, stream);
+        if (last > 0) {
+            progress = true;
+            pos += last;
+        }
+        last = d.rc.decode(buf + pos, len - pos, stream);
+        if (last > 0) {
+            progress = true;
+            pos += last;
+        }
+    } while (progress);
+    return pos;
+}
+
+int main(int argc, char **argv)
+{
+    int maxRun = 4;
+    int passes = 50;
+    size_t count = 100000;
+    int c;
+
+    while ((c = getopt(argc, argv, "r:n:")) != -1) {
+        switch (c) {
+        case 'r':
+            maxRun = atoi(optarg);
+            break;
+        case 'n':
+            passes = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-r maxRunLength] [-n passes]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (maxRun < 1) maxRun = 1;
+
+    Decoders d;
+    d.gl.initDispatchByName(getNoopProc, NULL);
+    d.gl2.initDispatchByName(getNoopProc, NULL);
+    d.rc.initDispatchByName(getNoopProc, NULL);
+
+    DecoderRouter router;
+    router.addDecoder(&d.gl);
+    router.addDecoder(&d.gl2);
+    router.addDecoder(&d.rc);
+
+    std::vector<unsigned char> packets;
+    buildStream(packets, count, maxRun);
+    DumpStream stream;
+
+    printf("%zu packets per pass, runs of 1..%d packets per API, %d passes\n",
+           count, maxRun, passes);
+
+    long long t0 = GetCurrentTimeMS();
+    for (int i = 0; i < passes; i++) {
+        if (cascadeDecode(d, &packets[0], packets.size(), &stream) != packets.size()) {
+            fprintf(stderr, "cascade: stream not fully decoded\n");
+            return 1;
+        }
+    }
+    long long t1 = GetCurrentTimeMS();
+    for (int i = 0; i < passes; i++) {
+        if (router.decode(&packets[0], packets.size(), &stream) != packets.size()) {
+            fprintf(stderr, "router: stream not fully decoded\n");
+            return 1;
+        }
+    }
+    long long t2 = GetCurrentTimeMS();
+
+    double total = (double)count * passes;
+    printf("cascade %12.0f packets/s\n", t1 > t0 ? total / ((t1 - t0) / 1000.0) : 0.0);
+    printf("router  %12.0f packets/s\n", t2 > t1 ? total / ((t2 - t1) / 1000.0) : 0.0);
+    return 0;
+}
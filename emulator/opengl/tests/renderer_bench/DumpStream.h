@@ -0,0 +1,138 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _RENDERER_BENCH_DUMP_STREAM_H
+#define _RENDERER_BENCH_DUMP_STREAM_H
+
+#include "IOStream.h"
+#include <string.h>
+#include <vector>
+
+//
+// An IOStream which serves the content of a stream captured with
+// RENDERER_DUMP_DIR (or a synthetic one) from memory.
+// read() returns at most 'chunk' bytes per call to mimic the socket
+// read pattern of a RenderThread. Anything written to the stream
+// is discarded.
+//
+class DumpStream : public IOStream {
+public:
+    explicit DumpStream(size_t chunk = 64 * 1024) :
+        IOStream(4096),
+        m_pos(0),
+        m_chunk(chunk)
+    {
+        m_wbuf.resize(4096);
+    }
+
+    bool load(const char *filename) {
+        FILE *fp = fopen(filename, "rb");
+        if (!fp) {
+            return false;
+        }
+        unsigned char tmp[64 * 1024];
+        size_t n;
+        while ((n = fread(tmp, 1, sizeof(tmp), fp)) > 0) {
+            m_data.insert(m_data.end(), tmp, tmp + n);
+        }
+        fclose(fp);
+        return m_data.size() > 0;
+    }
+
+    //
+    // Build a stream of 'count' packets, mostly small GL calls with
+    // a large vertex or texture upload every 64 packets or so.
+    //
+    void synthesize(size_t count, unsigned int opcodeBase, unsigned int numOpcodes) {
+        static const unsigned int smallSizes[] = { 12, 16, 20, 24, 40, 72, 136, 1200 };
+        static const unsigned int largeSizes[] = { 64 * 1024, 256 * 1024, 3 * 1024 * 1024 };
+        unsigned int seed = 1;
+        for (size_t i = 0; i < count; i++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned int r = seed >> 16;
+            unsigned int len = (r % 64) == 0 ?
+                    largeSizes[(r >> 6) % 3] : smallSizes[(r >> 6) % 8];
+            unsigned int opcode = opcodeBase + (seed >> 8) % numOpcodes;
+            size_t at = m_data.size();
+            m_data.resize(at + len);
+            memcpy(&m_data[at], &opcode, 4);
+            memcpy(&m_data[at + 4], &len, 4);
+        }
+    }
+
+    //
+    // Insert a packet of 'len' bytes, say a texture upload, every
+    // 'interval' packets of the stream.
+    //
+    void insertLarge(size_t interval, unsigned int opcode, unsigned int len) {
+        std::vector<unsigned char> out;
+        size_t pos = 0;
+        for (size_t n = 1; pos + 8 <= m_data.size(); n++) {
+            unsigned int packetLen;
+            memcpy(&packetLen, &m_data[pos + 4], 4);
+            out.insert(out.end(), m_data.begin() + pos, m_data.begin() + pos + packetLen);
+            pos += packetLen;
+            if (n % interval == 0) {
+                size_t at = out.size();
+                out.resize(at + len);
+                memcpy(&out[at], &opcode, 4);
+                memcpy(&out[at + 4], &len, 4);
+            }
+        }
+        m_data.swap(out);
+    }
+
+    void rewind() { m_pos = 0; }
+    size_t totalBytes() const { return m_data.size(); }
+    const unsigned char *data() const { return &m_data[0]; }
+
+    virtual void *allocBuffer(size_t minSize) {
+        if (m_wbuf.size() < minSize) {
+            m_wbuf.resize(minSize);
+        }
+        return &m_wbuf[0];
+    }
+
+    virtual int commitBuffer(size_t size) { return 0; }
+
+    virtual const unsigned char *readFully(void *buf, size_t len) {
+        memset(buf, 0, len);
+        return (const unsigned char *)buf;
+    }
+
+    virtual const unsigned char *read(void *buf, size_t *inout_len) {
+        size_t left = m_data.size() - m_pos;
+        if (left == 0) {
+            return NULL;
+        }
+        size_t n = *inout_len;
+        if (n > m_chunk) n = m_chunk;
+        if (n > left) n = left;
+        memcpy(buf, &m_data[m_pos], n);
+        m_pos += n;
+        *inout_len = n;
+        return (const unsigned char *)buf;
+    }
+
+    virtual int writeFully(const void *buf, size_t len) { return 0; }
+
+private:
+    std::vector<unsigned char> m_data;
+    std::vector<unsigned char> m_wbuf;
+    size_t m_pos;
+    size_t m_chunk;
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Decodes an ETC1 texture the way glCompressedTexImage2D does, with the
+// original per texel block decoder, with etc1_decode_image and with the
+// Etc1Decoder pool, and checks the three give the same image. The
+// texture is made of random blocks, every 64 bit value being a valid
+// ETC1 block.
+//
+// usage: etc1_decode_bench [-s size] [-n decodes]
+//        ANDROID_GLES_ETC1_THREADS sets the pool size
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GLcommon/Etc1Decoder.h>
+#include "TimeUtils.h"
+
+static const int s_modifierTable[] = {
+    2, 8, -2, -8,
+    5, 17, -5, -17,
+    9, 29, -9, -29,
+    13, 42, -13, -42,
+    18, 60, -18, -60,
+    24, 80, -24, -80,
+    33, 106, -33, -106,
+    47, 183, -47, -183 };
+
+static const int s_lookup[8] = { 0, 1, 2, 3, -4, -3, -2, -1 };
+
+static inline etc1_byte clamp(int x)
+{
+    return (etc1_byte) (x >= 0 ? (x < 255 ? x : 255) : 0);
+}
+
+static inline int convert4To8(int b)
+{
+    int c = b & 0xf;
+    return (c << 4) | c;
+}
+
+static inline int convert5To8(int b)
+{
+    int c = b & 0x1f;
+    return (c << 3) | (c >> 2);
+}
+
+// the decoder GLcommon used before, clamping every texel
+static void refDecodeSubblock(etc1_byte *out, int r, int g, int b,
+                              const int *table, etc1_uint32 low,
+                              bool second, bool flipped)
+{
+    int baseX = 0;
+    int baseY = 0;
+    if (second) {
+        if (flipped) {
+            baseY = 2;
+        } else {
+            baseX = 2;
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        int x, y;
+        if (flipped) {
+            x = baseX + (i >> 1);
+            y = baseY + (i & 1);
+        } else {
+            x = baseX + (i >> 2);
+            y = baseY + (i & 3);
+        }
+        int k = y + (x * 4);
+        int offset = ((low >> k) & 1) | ((low >> (k + 15)) & 2);
+        int delta = table[offset];
+        etc1_byte *q = out + 3 * (x + 4 * y);
+        *q++ = clamp(r + delta);
+        *q++ = clamp(g + delta);
+        *q++ = clamp(b + delta);
+    }
+}
+
+static void refDecodeBlock(const etc1_byte *in, etc1_byte *out)
+{
+    etc1_uint32 high = (in[0] << 24) | (in[1] << 16) | (in[2] << 8) | in[3];
+    etc1_uint32 low = (in[4] << 24) | (in[5] << 16) | (in[6] << 8) | in[7];
+    int r1, r2, g1, g2, b1, b2;
+    if (high & 2) {
+        int rBase = high >> 27;
+        int gBase = high >> 19;
+        int bBase = high >> 11;
+        r1 = convert5To8(rBase);
+        r2 = convert5To8((0x1f & rBase) + s_lookup[0x7 & (high >> 24)]);
+        g1 = convert5To8(gBase);
+        g2 = convert5To8((0x1f & gBase) + s_lookup[0x7 & (high >> 16)]);
+        b1 = convert5To8(bBase);
+        b2 = convert5To8((0x1f & bBase) + s_lookup[0x7 & (high >> 8)]);
+    } else {
+        r1 = convert4To8(high >> 28);
+        r2 = convert4To8(high >> 24);
+        g1 = convert4To8(high >> 20);
+        g2 = convert4To8(high >> 16);
+        b1 = convert4To8(high >> 12);
+        b2 = convert4To8(high >> 8);
+    }
+    const int *tableA = s_modifierTable + (7 & (high >> 5)) * 4;
+    const int *tableB = s_modifierTable + (7 & (high >> 2)) * 4;
+    bool flipped = (high & 1) != 0;
+    refDecodeSubblock(out, r1, g1, b1, tableA, low, false, flipped);
+    refDecodeSubblock(out, r2, g2, b2, tableB, low, true, flipped);
+}
+
+static void refDecodeImage(const etc1_byte *in, etc1_byte *out,
+                           int width, int height, int stride)
+{
+    etc1_byte block[ETC1_DECODED_BLOCK_SIZE];
+    for (int y = 0; y < height; y += 4) {
+        int yEnd = height - y < 4 ? height - y : 4;
+        for (int x = 0; x < width; x += 4) {
+            int xEnd = width - x < 4 ? width - x : 4;
+            refDecodeBlock(in, block);
+            in += ETC1_ENCODED_BLOCK_SIZE;
+            for (int cy = 0; cy < yEnd; cy++) {
+                memcpy(out + 3 * x + stride * (y + cy),
+                       block + cy * 4 * 3, xEnd * 3);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int size = 2048;
+    int decodes = 10;
+    int c;
+
+    while ((c = getopt(argc, argv, "s:n:")) != -1) {
+        switch (c) {
+        case 's':
+            size = atoi(optarg);
+            break;
+        case 'n':
+            decodes = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s size] [-n decodes]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size < 1) size = 2048;
+    if (decodes < 1) decodes = 10;
+
+    etc1_uint32 encodedSize = etc1_get_encoded_data_size(size, size);
+    etc1_byte *in = new etc1_byte[encodedSize];
+    srand(1);
+    for (etc1_uint32 i = 0; i < encodedSize; i++) {
+        in[i] = (etc1_byte)rand();
+    }
+
+    // GL_UNPACK_ALIGNMENT 4, as doCompressedTexImage2D pads the rows
+    int stride = (size * 3 + 3) & ~3;
+    etc1_byte *ref = new etc1_byte[stride * size];
+    etc1_byte *out = new etc1_byte[stride * size];
+    memset(ref, 0, stride * size);
+
+    long long t0 = GetCurrentTimeMS();
+    for (int i = 0; i < decodes; i++) {
+        refDecodeImage(in, ref, size, size, stride);
+    }
+    long long tRef = GetCurrentTimeMS() - t0;
+
+    memset(out, 0, stride * size);
+    t0 = GetCurrentTimeMS();
+    for (int i = 0; i < decodes; i++) {
+        etc1_decode_image(in, out, size, size, 3, stride);
+    }
+    long long tSingle = GetCurrentTimeMS() - t0;
+    bool singleOk = memcmp(ref, out, stride * size) == 0;
+
+    // the first decode starts the pool
+    memset(out, 0, stride * size);
+    Etc1Decoder::decodeRGB(in, out, size, size, stride);
+    t0 = GetCurrentTimeMS();
+    for (int i = 0; i < decodes; i++) {
+        Etc1Decoder::decodeRGB(in, out, size, size, stride);
+    }
+    long long tPool = GetCurrentTimeMS() - t0;
+    bool poolOk = memcmp(ref, out, stride * size) == 0;
+
+    printf("%dx%d ETC1, %d decodes\n", size, size, decodes);
+    printf("    per texel clamping:  %8.2f ms/decode\n", (double)tRef / decodes);
+    printf("    etc1_decode_image:   %8.2f ms/decode %s\n",
+           (double)tSingle / decodes, singleOk ? "" : "MISMATCH");
+    printf("    Etc1Decoder pool:    %8.2f ms/decode %s\n",
+           (double)tPool / decodes, poolOk ? "" : "MISMATCH");
+
+    delete[] in;
+    delete[] ref;
+    delete[] out;
+    return singleOk && poolOk ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Expands a mipmapped paletted texture of each of the ten
+// OES_compressed_paletted_texture formats, as glCompressedTexImage2D
+// with a negative level does, with the per texel expansion GLcommon
+// used before and with uncompressTexture, and checks both give the
+// same levels. Palette and indices are random.
+//
+// usage: palette_texture_bench [-s size] [-n expansions]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GLES/gl.h>
+#include <GLES/glext.h>
+#include <GLcommon/PaletteTexture.h>
+#include "TimeUtils.h"
+
+struct Format {
+    GLenum format;
+    const char *name;
+    int indexBits;
+    int colorBytes;
+    int outComps;
+};
+
+static const Format s_formats[MAX_SUPPORTED_PALETTE] = {
+    { GL_PALETTE4_RGB8_OES,      "PALETTE4_RGB8",      4, 3, 3 },
+    { GL_PALETTE4_RGBA8_OES,     "PALETTE4_RGBA8",     4, 4, 4 },
+    { GL_PALETTE4_R5_G6_B5_OES,  "PALETTE4_R5_G6_B5",  4, 2, 3 },
+    { GL_PALETTE4_RGBA4_OES,     "PALETTE4_RGBA4",     4, 2, 4 },
+    { GL_PALETTE4_RGB5_A1_OES,   "PALETTE4_RGB5_A1",   4, 2, 4 },
+    { GL_PALETTE8_RGB8_OES,      "PALETTE8_RGB8",      8, 3, 3 },
+    { GL_PALETTE8_RGBA8_OES,     "PALETTE8_RGBA8",     8, 4, 4 },
+    { GL_PALETTE8_R5_G6_B5_OES,  "PALETTE8_R5_G6_B5",  8, 2, 3 },
+    { GL_PALETTE8_RGBA4_OES,     "PALETTE8_RGBA4",     8, 2, 4 },
+    { GL_PALETTE8_RGB5_A1_OES,   "PALETTE8_RGB5_A1",   8, 2, 4 },
+};
+
+// the per texel color lookup GLcommon used before
+static void refColor(const unsigned char *palette, int index, GLenum format,
+                     unsigned char *out)
+{
+    unsigned short s;
+    switch (format) {
+    case GL_PALETTE4_RGB8_OES:
+    case GL_PALETTE8_RGB8_OES:
+        out[0] = palette[index];
+        out[1] = palette[index + 1];
+        out[2] = palette[index + 2];
+        out[3] = 0;
+        break;
+    case GL_PALETTE4_R5_G6_B5_OES:
+    case GL_PALETTE8_R5_G6_B5_OES:
+        s = *((unsigned short *)(palette + index));
+        out[0] = (s >> 11) * 255 / 31;
+        out[1] = ((s >> 5) & 0x3f) * 255 / 63;
+        out[2] = (s & 0x1f) * 255 / 31;
+        out[3] = 0;
+        break;
+    case GL_PALETTE4_RGBA8_OES:
+    case GL_PALETTE8_RGBA8_OES:
+        memcpy(out, palette + index, 4);
+        break;
+    case GL_PALETTE4_RGBA4_OES:
+    case GL_PALETTE8_RGBA4_OES:
+        s = *((unsigned short *)(palette + index));
+        out[0] = ((s >> 12) & 0xf) * 255 / 15;
+        out[1] = ((s >> 8) & 0xf) * 255 / 15;
+        out[2] = ((s >> 4) & 0xf) * 255 / 15;
+        out[3] = (s & 0xf) * 255 / 15;
+        break;
+    case GL_PALETTE4_RGB5_A1_OES:
+    case GL_PALETTE8_RGB5_A1_OES:
+        s = *((unsigned short *)(palette + index));
+        out[0] = ((s >> 11) & 0x1f) * 255 / 31;
+        out[1] = ((s >> 6) & 0x1f) * 255 / 31;
+        out[2] = ((s >> 1) & 0x1f) * 255 / 31;
+        out[3] = (s & 0x1) * 255;
+        break;
+    }
+}
+
+// one level, allocated and looked up texel by texel
+static unsigned char *refLevel(const Format &f, const unsigned char *data,
+                               int width, int height, int level)
+{
+    const unsigned char *indices = data + (1 << f.indexBits) * f.colorBytes;
+    for (int i = 0; i < level; i++) {
+        indices += (width * height * f.indexBits + 7) / 8;
+        width = width > 1 ? width >> 1 : 1;
+        height = height > 1 ? height >> 1 : 1;
+    }
+    int nPixels = width * height;
+    unsigned char *out = new unsigned char[nPixels * f.outComps];
+    for (int i = 0; i < nPixels; i++) {
+        int index;
+        if (f.indexBits == 4) {
+            index = (i % 2) == 0 ? indices[i / 2] >> 4 : indices[i / 2] & 0xf;
+        } else {
+            index = indices[i];
+        }
+        unsigned char c[4];
+        refColor(data, index * f.colorBytes, f.format, c);
+        memcpy(out + i * f.outComps, c, f.outComps);
+    }
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    int size = 512;
+    int expansions = 20;
+    int c;
+
+    while ((c = getopt(argc, argv, "s:n:")) != -1) {
+        switch (c) {
+        case 's':
+            size = atoi(optarg);
+            break;
+        case 'n':
+            expansions = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s size] [-n expansions]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size < 1) size = 512;
+    if (expansions < 1) expansions = 20;
+
+    int nLevels = 1;
+    while ((size >> (nLevels - 1)) > 1) nLevels++;
+
+    printf("%dx%d, %d levels, %d expansions\n", size, size, nLevels, expansions);
+    printf("    %-20s %12s %12s\n", "format", "per texel", "table");
+
+    bool ok = true;
+    for (int fi = 0; fi < MAX_SUPPORTED_PALETTE; fi++) {
+        const Format &f = s_formats[fi];
+
+        int imageSize = (1 << f.indexBits) * f.colorBytes;
+        for (int i = 0; i < nLevels; i++) {
+            int s = size >> i;
+            imageSize += (s * s * f.indexBits + 7) / 8;
+        }
+        unsigned char *data = new unsigned char[imageSize];
+        srand(fi + 1);
+        for (int i = 0; i < imageSize; i++) {
+            data[i] = (unsigned char)rand();
+        }
+
+        long long t0 = GetCurrentTimeUS();
+        for (int n = 0; n < expansions; n++) {
+            for (int i = 0; i < nLevels; i++) {
+                delete[] refLevel(f, data, size, size, i);
+            }
+        }
+        long long tRef = GetCurrentTimeUS() - t0;
+
+        size_t offsets[32];
+        GLenum formatOut;
+        t0 = GetCurrentTimeUS();
+        for (int n = 0; n < expansions; n++) {
+            delete[] uncompressTexture(f.format, formatOut, size, size,
+                                       imageSize, data, 0, nLevels, 1, offsets);
+        }
+        long long tTable = GetCurrentTimeUS() - t0;
+
+        unsigned char *levels = uncompressTexture(f.format, formatOut, size, size,
+                                                  imageSize, data, 0, nLevels, 1, offsets);
+        bool same = levels != NULL &&
+                    formatOut == (f.outComps == 4 ? GL_RGBA : GL_RGB);
+        for (int i = 0; same && i < nLevels; i++) {
+            int s = size >> i;
+            unsigned char *ref = refLevel(f, data, size, size, i);
+            same = memcmp(ref, levels + offsets[i], s * s * f.outComps) == 0;
+            delete[] ref;
+        }
+        delete[] levels;
+        delete[] data;
+        ok = ok && same;
+
+        printf("    %-20s %9.1f us %9.1f us %s\n", f.name,
+               (double)tRef / expansions, (double)tTable / expansions,
+               same ? "" : "MISMATCH");
+    }
+    return ok ? 0 : 1;
+}
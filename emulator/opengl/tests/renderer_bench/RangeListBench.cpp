@@ -0,0 +1,194 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Runs the RangeList bookkeeping GLcommon does for a glDrawElements on
+// a GL_FIXED buffer object: the indices are turned into byte ranges and
+// removed from the ranges of the buffer still to be converted. The
+// results are checked against a byte map first.
+//
+// usage: rangelist_bench [-i indices] [-v vertices] [-n draws]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include <GLES/gl.h>
+#include <GLcommon/RangeManip.h>
+#include "TimeUtils.h"
+
+// fixed3 vertices
+static const int s_attribSize = 3 * 4;
+static const int s_stride = 16;
+
+static void indicesToRanges(const std::vector<GLushort> &indices,
+                            RangeList &ranges)
+{
+    std::vector<GLushort> sorted(indices);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        ranges.addRange(Range(sorted[i] * s_stride, s_attribSize));
+    }
+}
+
+// the buffer as left by a few glBufferSubData calls
+static void pendingRanges(int bufferSize, RangeList &pending)
+{
+    for (int offset = 0; offset < bufferSize; offset += bufferSize / 8) {
+        pending.addRange(Range(offset, bufferSize / 16));
+    }
+}
+
+static bool checkList(RangeList &l, const std::vector<char> &map)
+{
+    std::vector<char> got(map.size(), 0);
+    int prevEnd = -1;
+    for (int i = 0; i < l.size(); i++) {
+        // sorted, non empty and not touching
+        if (l[i].getSize() <= 0 || l[i].getStart() <= prevEnd) return false;
+        prevEnd = l[i].getEnd();
+        for (int b = l[i].getStart(); b < l[i].getEnd(); b++) got[b] = 1;
+    }
+    return got == map;
+}
+
+static void mapAdd(std::vector<char> &map, const Range &r)
+{
+    for (int b = r.getStart(); b < r.getEnd(); b++) map[b] = 1;
+}
+
+//
+// random additions and removals, compared to a byte map
+//
+static bool checkRandom()
+{
+    const int size = 4096;
+    RangeList list;
+    std::vector<char> map(size, 0);
+
+    for (int op = 0; op < 20000; op++) {
+        int start = rand() % size;
+        int len = rand() % 64 + 1;
+        if (start + len > size) len = size - start;
+        Range r(start, len);
+
+        if (rand() % 3) {
+            list.addRange(r);
+            mapAdd(map, r);
+        } else {
+            RangeList deleted;
+            std::vector<char> deletedMap(size, 0);
+            list.delRange(r, deleted);
+            for (int b = start; b < start + len; b++) {
+                deletedMap[b] = map[b];
+                map[b] = 0;
+            }
+            if (!checkList(deleted, deletedMap)) return false;
+        }
+        if (!checkList(list, map)) return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int nIndices = 60000;
+    int nVerts = 20000;
+    int draws = 200;
+    int c;
+
+    while ((c = getopt(argc, argv, "i:v:n:")) != -1) {
+        switch (c) {
+        case 'i':
+            nIndices = atoi(optarg);
+            break;
+        case 'v':
+            nVerts = atoi(optarg);
+            break;
+        case 'n':
+            draws = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-i indices] [-v vertices] [-n draws]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (nIndices < 1) nIndices = 60000;
+    if (nVerts < 1 || nVerts > 65536) nVerts = 20000;
+    if (draws < 1) draws = 1;
+
+    srand(1);
+    if (!checkRandom()) {
+        printf("random add/del: MISMATCH\n");
+        return 1;
+    }
+
+    // a triangle list, each vertex shared by a few triangles
+    std::vector<GLushort> indices(nIndices);
+    for (int i = 0; i < nIndices; i++) {
+        indices[i] = rand() % nVerts;
+    }
+
+    int bufferSize = nVerts * s_stride;
+    RangeList ranges, pending, conversions;
+    indicesToRanges(indices, ranges);
+    pendingRanges(bufferSize, pending);
+    pending.delRanges(ranges, conversions);
+
+    std::vector<char> rangesMap(bufferSize, 0), pendingMap(bufferSize, 0);
+    for (int i = 0; i < nIndices; i++) {
+        mapAdd(rangesMap, Range(indices[i] * s_stride, s_attribSize));
+    }
+    RangeList pendingRef;
+    pendingRanges(bufferSize, pendingRef);
+    for (int i = 0; i < pendingRef.size(); i++) mapAdd(pendingMap, pendingRef[i]);
+    std::vector<char> convMap(bufferSize, 0);
+    for (int b = 0; b < bufferSize; b++) {
+        convMap[b] = rangesMap[b] && pendingMap[b];
+        pendingMap[b] = pendingMap[b] && !rangesMap[b];
+    }
+    if (!checkList(ranges, rangesMap) || !checkList(conversions, convMap) ||
+        !checkList(pending, pendingMap)) {
+        printf("indexed draw: MISMATCH\n");
+        return 1;
+    }
+
+    printf("%d indices, %d vertices: %d ranges, %d to convert\n",
+           nIndices, nVerts, ranges.size(), conversions.size());
+
+    long long toRangesUS = 0, conversionsUS = 0;
+    for (int d = 0; d < draws; d++) {
+        RangeList r, p, conv;
+        pendingRanges(bufferSize, p);
+
+        long long t0 = GetCurrentTimeUS();
+        indicesToRanges(indices, r);
+        long long t1 = GetCurrentTimeUS();
+        p.delRanges(r, conv);
+        long long t2 = GetCurrentTimeUS();
+
+        toRangesUS += t1 - t0;
+        conversionsUS += t2 - t1;
+    }
+    printf("indices to ranges  %8.1f us/draw\n", (double)toRangesUS / draws);
+    printf("ranges to convert  %8.1f us/draw\n", (double)conversionsUS / draws);
+    return 0;
+}
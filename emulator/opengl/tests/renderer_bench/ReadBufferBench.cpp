@@ -0,0 +1,193 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Replays a stream captured with RENDERER_DUMP_DIR through the
+// RenderThread ReadBuffer and through the previous memmove based
+// implementation, and reports the achieved throughput of each.
+//
+// usage: readbuffer_bench [-c chunkBytes] [-n passes] [-u uploadKB] [stream_file]
+//
+// When no stream file is given a synthetic stream is used. -u adds an
+// upload of the given size every 1000 packets, an upload larger than the
+// 4MB buffer goes through the ReadBuffer staging buffer. The peak buffer
+// size includes the staging buffer.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "ReadBuffer.h"
+#include "TimeUtils.h"
+#include "DumpStream.h"
+
+#define STREAM_BUFFER_SIZE 4*1024*1024
+
+//
+// The ReadBuffer implementation used before the ring buffer,
+// kept here as the reference point.
+//
+class LinearReadBuffer {
+public:
+    LinearReadBuffer(IOStream *stream, size_t bufSize) :
+        m_size(bufSize),
+        m_validData(0),
+        m_stream(stream)
+    {
+        m_buf = (unsigned char*)malloc(m_size);
+        m_readPtr = m_buf;
+    }
+    ~LinearReadBuffer() { free(m_buf); }
+
+    int getData() {
+        if ((m_validData > 0) && (m_readPtr > m_buf)) {
+            memmove(m_buf, m_readPtr, m_validData);
+        }
+        size_t len = m_size - m_validData;
+        if (len == 0) {
+            size_t new_size = m_size*2;
+            if (new_size < m_size) {
+                new_size = INT_MAX;
+            }
+            unsigned char *new_buf = (unsigned char*)realloc(m_buf, new_size);
+            if (!new_buf) {
+                return -1;
+            }
+            m_size = new_size;
+            m_buf = new_buf;
+            len = m_size - m_validData;
+        }
+        m_readPtr = m_buf;
+        if (NULL != m_stream->read(m_buf + m_validData, &len)) {
+            m_validData += len;
+            return len;
+        }
+        return -1;
+    }
+    unsigned char *buf() { return m_readPtr; }
+    size_t validData() { return m_validData; }
+    void consume(size_t amount) { m_validData -= amount; m_readPtr += amount; }
+    size_t size() const { return m_size; }
+    size_t stagingSize() const { return 0; }
+
+private:
+    unsigned char *m_buf;
+    unsigned char *m_readPtr;
+    size_t m_size;
+    size_t m_validData;
+    IOStream *m_stream;
+};
+
+//
+// Walk whole packets the way the decoders do, touching the packet
+// header and its last byte.
+//
+template <class BufferT>
+static double runPass(BufferT &readBuf, unsigned long long *packets,
+                      unsigned int *checksum, size_t *peakSize)
+{
+    long long t0 = GetCurrentTimeMS();
+    while (readBuf.getData() > 0) {
+        if (readBuf.size() + readBuf.stagingSize() > *peakSize) {
+            *peakSize = readBuf.size() + readBuf.stagingSize();
+        }
+        for (;;) {
+            size_t avail = readBuf.validData();
+            if (avail < 8) break;
+            unsigned char *ptr = readBuf.buf();
+            unsigned int packetLen = *(unsigned int *)(ptr + 4);
+            if (packetLen < 8 || avail < packetLen) break;
+            *checksum += *(unsigned int *)ptr + ptr[packetLen - 1];
+            readBuf.consume(packetLen);
+            (*packets)++;
+        }
+    }
+    return (double)(GetCurrentTimeMS() - t0);
+}
+
+template <class BufferT>
+static void bench(const char *name, DumpStream &stream, int passes)
+{
+    unsigned long long packets = 0;
+    unsigned int checksum = 0;
+    size_t peakSize = 0;
+    double ms = 0.0;
+
+    for (int i = 0; i < passes; i++) {
+        stream.rewind();
+        BufferT readBuf(&stream, STREAM_BUFFER_SIZE);
+        ms += runPass(readBuf, &packets, &checksum, &peakSize);
+    }
+
+    double mb = (double)stream.totalBytes() * passes / (1024.0 * 1024.0);
+    printf("%-10s %10.1f MB/s  %12llu packets  peak buffer %zu KB  (checksum %08x)\n",
+           name, ms > 0 ? mb / (ms / 1000.0) : 0.0,
+           packets, peakSize / 1024, checksum);
+}
+
+static const char *bufferMode()
+{
+    DumpStream empty;
+    ReadBuffer probe(&empty, STREAM_BUFFER_SIZE);
+    return probe.isMirrored() ? "mirrored" : "linear";
+}
+
+int main(int argc, char **argv)
+{
+    size_t chunk = 64 * 1024;
+    int passes = 10;
+    size_t upload = 0;
+    int c;
+
+    while ((c = getopt(argc, argv, "c:n:u:")) != -1) {
+        switch (c) {
+        case 'c':
+            chunk = (size_t)atoi(optarg);
+            break;
+        case 'n':
+            passes = atoi(optarg);
+            break;
+        case 'u':
+            upload = (size_t)atoi(optarg) * 1024;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-c chunkBytes] [-n passes] [-u uploadKB] [stream_file]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    DumpStream stream(chunk);
+    if (optind < argc) {
+        if (!stream.load(argv[optind])) {
+            fprintf(stderr, "Failed to load stream %s\n", argv[optind]);
+            return 1;
+        }
+    } else {
+        stream.synthesize(20000, 1024, 400);
+    }
+    if (upload >= 8) {
+        stream.insertLarge(1000, 1024, upload);
+    }
+
+    printf("%zu bytes, %d passes, %zu byte reads, ReadBuffer is %s\n",
+           stream.totalBytes(), passes, chunk, bufferMode());
+
+    bench<LinearReadBuffer>("memmove", stream, passes);
+    bench<ReadBuffer>("ring", stream, passes);
+    return 0;
+}
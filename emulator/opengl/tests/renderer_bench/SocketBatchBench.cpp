@@ -0,0 +1,181 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Replays a command stream through a SocketStream the way an encoder
+// writes it and counts the send system calls made per frame, with
+// batching disabled and with a few batching high-water marks.
+//
+// Packets of 64KB and more are written like emugen 'isLarge' arguments
+// (header committed, then writeFully() of the payload). A frame ends
+// with a flush(), as eglSwapBuffers does through its readback.
+//
+// usage: socket_batch_bench [-b streamBufferSize] [-f packetsPerFrame] [stream_file]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "SocketStream.h"
+#include "osThread.h"
+#include "TimeUtils.h"
+#include "DumpStream.h"
+
+#define LARGE_PACKET_SIZE (64 * 1024)
+
+//
+// SocketStream over one end of a socketpair
+//
+class PairStream : public SocketStream {
+public:
+    PairStream(int sock, size_t bufSize) : SocketStream(sock, bufSize) {}
+    virtual int listen(char addrstr[MAX_ADDRSTR_LEN]) { return -1; }
+    virtual SocketStream *accept() { return NULL; }
+    virtual int connect(const char* addr) { return -1; }
+};
+
+//
+// Drains the receiving end of the socketpair
+//
+class Drain : public osUtils::Thread {
+public:
+    explicit Drain(int sock) : m_sock(sock), m_bytes(0) {}
+    virtual int Main() {
+        static char buf[256 * 1024];
+        ssize_t n;
+        while ((n = ::recv(m_sock, buf, sizeof(buf), 0)) > 0) {
+            m_bytes += n;
+        }
+        return 0;
+    }
+    unsigned long long bytes() const { return m_bytes; }
+
+private:
+    int m_sock;
+    unsigned long long m_bytes;
+};
+
+static bool replay(const DumpStream &dump, size_t bufSize, size_t highWaterMark,
+                   size_t packetsPerFrame)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return false;
+    }
+
+    Drain drain(fds[1]);
+    drain.start();
+
+    PairStream *stream = new PairStream(fds[0], bufSize);
+    stream->setBatching(highWaterMark);
+
+    const unsigned char *data = dump.data();
+    size_t total = dump.totalBytes();
+    size_t pos = 0;
+    unsigned int frames = 0;
+    size_t packets = 0;
+
+    long long t0 = GetCurrentTimeMS();
+    while (total - pos >= 8) {
+        unsigned int packetLen = *(const unsigned int *)(data + pos + 4);
+        if (packetLen < 8 || total - pos < packetLen) break;
+
+        if (packetLen >= LARGE_PACKET_SIZE) {
+            unsigned char *ptr = stream->alloc(8);
+            memcpy(ptr, data + pos, 8);
+            stream->commit();
+            stream->writeFully(data + pos + 8, packetLen - 8);
+        } else {
+            unsigned char *ptr = stream->alloc(packetLen);
+            memcpy(ptr, data + pos, packetLen);
+        }
+        pos += packetLen;
+
+        if (++packets % packetsPerFrame == 0) {
+            stream->flush();
+            frames++;
+        }
+    }
+    stream->flush();
+    if (packets % packetsPerFrame) frames++;
+    long long ms = GetCurrentTimeMS() - t0;
+
+    unsigned int sends = stream->sendCount();
+    delete stream; // closes fds[0], the drain thread sees EOF
+    int exitStatus;
+    drain.wait(&exitStatus);
+    ::close(fds[1]);
+
+    char mode[32];
+    if (highWaterMark) {
+        snprintf(mode, sizeof(mode), "batch %zuKB", highWaterMark / 1024);
+    } else {
+        snprintf(mode, sizeof(mode), "unbatched");
+    }
+    printf("%-14s %8.1f sends/frame  %8u sends  %7.1f MB/s%s\n",
+           mode, frames ? (double)sends / frames : 0.0, sends,
+           ms > 0 ? drain.bytes() / (1024.0 * 1024.0) / (ms / 1000.0) : 0.0,
+           drain.bytes() == pos ? "" : "  (short read!)");
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    size_t bufSize = 16 * 1024;
+    size_t packetsPerFrame = 500;
+    int c;
+
+    while ((c = getopt(argc, argv, "b:f:")) != -1) {
+        switch (c) {
+        case 'b':
+            bufSize = (size_t)atoi(optarg);
+            break;
+        case 'f':
+            packetsPerFrame = (size_t)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-b streamBufferSize] [-f packetsPerFrame] [stream_file]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (packetsPerFrame == 0) packetsPerFrame = 1;
+
+    DumpStream dump;
+    if (optind < argc) {
+        if (!dump.load(argv[optind])) {
+            fprintf(stderr, "Failed to load stream %s\n", argv[optind]);
+            return 1;
+        }
+    } else {
+        dump.synthesize(5000, 1024, 400);
+    }
+
+    printf("%zu bytes, %zu byte stream buffer, %zu packets per frame\n",
+           dump.totalBytes(), bufSize, packetsPerFrame);
+
+    static const size_t marks[] = { 0, 64 * 1024, 256 * 1024, 1024 * 1024 };
+    for (size_t i = 0; i < sizeof(marks) / sizeof(marks[0]); i++) {
+        if (!replay(dump, bufSize, marks[i], packetsPerFrame)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,522 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Replays a renderer session captured with RENDERER_CAPTURE_FILE (see
+// StreamCapture.h) against a FrameBuffer without a window, through the
+// GLESv1/GLESv2/renderControl decoders, and reports where the time
+// went:
+//
+//   decode    decoding alone, the segment decoded again with no-op
+//             entry points
+//   dispatch  the rest of the decode time, the translator and the
+//             host GL calls of the decoded packets
+//   driver    waiting for the host GL to complete each posted frame,
+//             a glFinish after each data record posting one
+//   idle      waiting for the recorded time of the data, -p only
+//
+// Replies are not sent anywhere, they are compared with the captured
+// ones, a replay whose replies differ from the capture (a handle or
+// a GL name the host hands out differently) may not render the same.
+// The replies to a data record follow it in the capture, they are
+// compared when the next data record of the connection is replayed.
+//
+// Each captured connection is replayed by a thread of its own, as the
+// renderer state is per thread, but the records are replayed one at a
+// time in the captured order.
+//
+// A segment [-s, -e) of the capture can be replayed alone. The data
+// before the segment is replayed first, unmeasured and at max speed,
+// since it created the contexts, surfaces and GL objects the segment
+// uses. The capture index only lets the decode-only pass start reading
+// at the segment.
+//
+// usage: stream_replay [-p] [-s start ms] [-e end ms] [-l] capture
+//        -p  replay at the recorded pace instead of max speed
+//        -l  print the capture index and exit
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+#include "gl_dec.h"
+#include "gl2_dec.h"
+#include "renderControl_dec.h"
+#include "renderControl_opcodes.h"
+#include "StreamCapture.h"
+#include "FrameBuffer.h"
+#include "ThreadInfo.h"
+#include "RenderControl.h"
+#include "DecoderRouter.h"
+#include "EGLDispatch.h"
+#include "GLDispatch.h"
+#include "GL2Dispatch.h"
+#include "TimeUtils.h"
+#include "DumpStream.h"
+#include "osThread.h"
+
+#define DEFAULT_FB_WIDTH  320
+#define DEFAULT_FB_HEIGHT 480
+
+static void noopProc() {}
+
+static void *getNoopProc(const char *name, void *userData)
+{
+    return (void *)&noopProc;
+}
+
+// true if the packets of buf post a color buffer
+static bool postsFrame(const unsigned char *buf, size_t len)
+{
+    size_t pos = 0;
+    while (len - pos >= 8) {
+        unsigned int opcode = *(const unsigned int *)(buf + pos);
+        unsigned int packetLen = *(const unsigned int *)(buf + pos + 4);
+        if (opcode == OP_rcFBPost) {
+            return true;
+        }
+        if (packetLen < 8 || len - pos < packetLen) {
+            break;
+        }
+        pos += packetLen;
+    }
+    return false;
+}
+
+//
+// The stream the decoders of a replayed connection reply to, it keeps
+// the replies of the data record being decoded.
+//
+class ReplyStream : public IOStream {
+public:
+    ReplyStream() : IOStream(10000) {}
+
+    virtual void *allocBuffer(size_t minSize) {
+        if (m_buf.size() < minSize) {
+            m_buf.resize(minSize);
+        }
+        return &m_buf[0];
+    }
+    virtual int commitBuffer(size_t size) {
+        m_replies.insert(m_replies.end(), m_buf.begin(), m_buf.begin() + size);
+        return size;
+    }
+    virtual const unsigned char *readFully(void *buf, size_t len) {
+        return NULL;
+    }
+    virtual const unsigned char *read(void *buf, size_t *inout_len) {
+        return NULL;
+    }
+    virtual int writeFully(const void *buf, size_t len) {
+        const unsigned char *p = (const unsigned char *)buf;
+        m_replies.insert(m_replies.end(), p, p + len);
+        return len;
+    }
+
+    std::vector<unsigned char> &replies() { return m_replies; }
+
+private:
+    std::vector<unsigned char> m_buf;
+    std::vector<unsigned char> m_replies;
+};
+
+struct ReplayTimes {
+    ReplayTimes() : decodeUs(0), driverUs(0), frames(0) {}
+    long long decodeUs;
+    long long driverUs;
+    int frames;
+};
+
+//
+// The thread replaying one captured connection. run() hands it a data
+// record and waits for it to be decoded.
+//
+class ReplayConnection : public osUtils::Thread
+{
+public:
+    ReplayConnection() : m_buf(NULL), m_len(0), m_measured(false),
+                         m_busy(false), m_exit(false) {}
+
+    void expectReply(const unsigned char *buf, size_t len) {
+        m_expected.insert(m_expected.end(), buf, buf + len);
+    }
+
+    //
+    // Returns false if the replies to the last data record run differ
+    // from the captured ones read since, then forgets both.
+    //
+    bool checkReplies() {
+        android::Mutex::Autolock mutex(m_lock);
+        std::vector<unsigned char> &replies = m_stream.replies();
+        bool same = replies == m_expected;
+        replies.clear();
+        m_expected.clear();
+        return same;
+    }
+
+    // true if the last data record run is part of the measured segment
+    bool measured() const { return m_measured; }
+
+    void run(const unsigned char *buf, size_t len, ReplayTimes *times,
+             bool measured) {
+        android::Mutex::Autolock mutex(m_lock);
+        m_buf = buf;
+        m_len = len;
+        m_times = times;
+        m_measured = measured;
+        m_busy = true;
+        m_cond.signal();
+        while (m_busy) {
+            m_cond.wait(m_lock);
+        }
+    }
+
+    void exit() {
+        android::Mutex::Autolock mutex(m_lock);
+        m_exit = true;
+        m_cond.signal();
+    }
+
+    virtual int Main() {
+        RenderThreadInfo *tInfo = getRenderThreadInfo();
+        tInfo->m_glDec.initGL(gl_dispatch_get_proc_func, NULL);
+        tInfo->m_gl2Dec.initGL(gl2_dispatch_get_proc_func, NULL);
+        initRenderControlContext(&m_rcDec);
+
+        DecoderRouter router;
+        router.addDecoder(&tInfo->m_glDec);
+        router.addDecoder(&tInfo->m_gl2Dec);
+        router.addDecoder(&m_rcDec);
+
+        android::Mutex::Autolock mutex(m_lock);
+        for (;;) {
+            while (!m_busy && !m_exit) {
+                m_cond.wait(m_lock);
+            }
+            if (m_exit) {
+                break;
+            }
+
+            long long t0 = GetCurrentTimeUS();
+            size_t n = router.decode((void *)m_buf, m_len, &m_stream);
+            long long t1 = GetCurrentTimeUS();
+            if (n != m_len) {
+                fprintf(stderr, "warning: %u bytes of a data record not decoded\n",
+                        (unsigned int)(m_len - n));
+            }
+            m_times->decodeUs += t1 - t0;
+
+            if (postsFrame(m_buf, m_len)) {
+                finish();
+                m_times->driverUs += GetCurrentTimeUS() - t1;
+                m_times->frames++;
+            }
+
+            m_busy = false;
+            m_cond.signal();
+        }
+
+        EGLDisplay eglDpy = s_egl.eglGetCurrentDisplay();
+        if (eglDpy != EGL_NO_DISPLAY) {
+            s_egl.eglMakeCurrent(eglDpy, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                                 EGL_NO_CONTEXT);
+        }
+        return 0;
+    }
+
+private:
+    void finish() {
+        RenderThreadInfo *tInfo = getRenderThreadInfo();
+        if (!tInfo->currContext.Ptr()) {
+            return;
+        }
+        if (tInfo->currContext->isGL2()) {
+            s_gl2.glFinish();
+        } else {
+            s_gl.glFinish();
+        }
+    }
+
+private:
+    android::Mutex m_lock;
+    android::Condition m_cond;
+    renderControl_decoder_context_t m_rcDec;
+    ReplyStream m_stream;
+    std::vector<unsigned char> m_expected;
+    const unsigned char *m_buf;
+    size_t m_len;
+    ReplayTimes *m_times;
+    bool m_measured;
+    bool m_busy;
+    bool m_exit;
+};
+
+typedef std::map<unsigned int, ReplayConnection *> ConnectionMap;
+
+// counts the last data record of conn if its replies differ
+static void checkReplies(ReplayConnection *conn, unsigned long long *divergent)
+{
+    if (!conn->checkReplies() && conn->measured()) {
+        (*divergent)++;
+    }
+}
+
+static void closeConnection(ConnectionMap &conns, unsigned int id,
+                            unsigned long long *divergent)
+{
+    ConnectionMap::iterator it = conns.find(id);
+    if (it == conns.end()) {
+        return;
+    }
+    checkReplies(it->second, divergent);
+    int status;
+    it->second->exit();
+    it->second->wait(&status);
+    delete it->second;
+    conns.erase(it);
+}
+
+static void listIndex(const CaptureReader &reader)
+{
+    const std::vector<CaptureIndexEntry> &index = reader.index();
+    printf("%10s %14s %10s\n", "time ms", "offset", "record");
+    for (size_t i = 0; i < index.size(); i++) {
+        printf("%10.1f %14llu %10llu\n", index[i].timeUs / 1000.0,
+               (unsigned long long)index[i].offset,
+               (unsigned long long)index[i].record);
+    }
+}
+
+//
+// Decodes the data records of the segment again with no-op entry
+// points, for the decoding part of the replay time.
+//
+static long long decodeOnly(CaptureReader &reader, long long startUs, long long endUs)
+{
+    gl_decoder_context_t gl;
+    gl2_decoder_context_t gl2;
+    renderControl_decoder_context_t rc;
+    gl.initDispatchByName(getNoopProc, NULL);
+    gl2.initDispatchByName(getNoopProc, NULL);
+    rc.initDispatchByName(getNoopProc, NULL);
+
+    DecoderRouter router;
+    router.addDecoder(&gl);
+    router.addDecoder(&gl2);
+    router.addDecoder(&rc);
+    DumpStream stream;
+
+    const CaptureIndexEntry *entry = reader.findIndex(startUs);
+    if (entry) {
+        reader.seek(entry);
+    } else {
+        reader.rewind();
+    }
+
+    long long decodeUs = 0;
+    CaptureRecord rec;
+    const unsigned char *data;
+    while (reader.next(&rec, &data)) {
+        if (rec.type != CAPTURE_DATA || (long long)rec.timeUs < startUs) {
+            continue;
+        }
+        if ((long long)rec.timeUs >= endUs) {
+            break;
+        }
+        long long t0 = GetCurrentTimeUS();
+        router.decode((void *)data, rec.length, &stream);
+        decodeUs += GetCurrentTimeUS() - t0;
+    }
+    return decodeUs;
+}
+
+int main(int argc, char **argv)
+{
+    bool paced = false;
+    bool list = false;
+    long long startUs = 0;
+    long long endUs = -1;
+    int c;
+
+    while ((c = getopt(argc, argv, "ps:e:l")) != -1) {
+        switch (c) {
+        case 'p':
+            paced = true;
+            break;
+        case 's':
+            startUs = atoll(optarg) * 1000;
+            break;
+        case 'e':
+            endUs = atoll(optarg) * 1000;
+            break;
+        case 'l':
+            list = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-p] [-s start ms] [-e end ms] [-l] capture\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-p] [-s start ms] [-e end ms] [-l] capture\n",
+                argv[0]);
+        return 1;
+    }
+
+    CaptureReader reader;
+    if (!reader.open(argv[optind])) {
+        fprintf(stderr, "%s is not a renderer capture\n", argv[optind]);
+        return 1;
+    }
+    printf("%s: %dx%d, %llu records, %.1f ms, %u index entries%s\n",
+           argv[optind], reader.fbWidth(), reader.fbHeight(),
+           (unsigned long long)reader.records(), reader.durationUs() / 1000.0,
+           (unsigned int)reader.index().size(),
+           reader.hasIndex() ? "" : " (rebuilt)");
+    if (list) {
+        listIndex(reader);
+        return 0;
+    }
+    if (endUs < 0 || endUs > reader.durationUs()) {
+        endUs = reader.durationUs() + 1;
+    }
+
+    if (!init_egl_dispatch() || !init_gl_dispatch()) {
+        fprintf(stderr, "failed to load the EGL/GLES translators\n");
+        return 1;
+    }
+    init_gl2_dispatch();
+
+    int width = reader.fbWidth() > 0 ? reader.fbWidth() : DEFAULT_FB_WIDTH;
+    int height = reader.fbHeight() > 0 ? reader.fbHeight() : DEFAULT_FB_HEIGHT;
+    if (!FrameBuffer::initialize(width, height)) {
+        fprintf(stderr, "failed to create the FrameBuffer\n");
+        return 1;
+    }
+
+    ConnectionMap conns;
+    ReplayTimes skipped;
+    ReplayTimes measured;
+    unsigned long long segmentRecords = 0;
+    unsigned long long segmentBytes = 0;
+    unsigned long long divergent = 0;
+    long long skipUs = 0;
+    long long idleUs = 0;
+    long long replayStart = 0;
+    long long segmentStartUs = 0;
+
+    CaptureRecord rec;
+    const unsigned char *data;
+    while (reader.next(&rec, &data)) {
+        if (rec.type == CAPTURE_DATA && (long long)rec.timeUs >= endUs) {
+            break;
+        }
+
+        ReplayConnection *conn = NULL;
+        ConnectionMap::iterator it = conns.find(rec.connection);
+        if (it != conns.end()) {
+            conn = it->second;
+        }
+
+        switch (rec.type) {
+        case CAPTURE_OPEN:
+            conn = new ReplayConnection();
+            if (!conn->start()) {
+                fprintf(stderr, "failed to start a replay thread\n");
+                return 1;
+            }
+            conns[rec.connection] = conn;
+            break;
+
+        case CAPTURE_CLOSE:
+            closeConnection(conns, rec.connection, &divergent);
+            break;
+
+        case CAPTURE_REPLY:
+            if (conn) {
+                conn->expectReply(data, rec.length);
+            }
+            break;
+
+        case CAPTURE_DATA: {
+            if (!conn) {
+                break;
+            }
+            checkReplies(conn, &divergent);
+            if ((long long)rec.timeUs < startUs) {
+                long long t0 = GetCurrentTimeUS();
+                conn->run(data, rec.length, &skipped, false);
+                skipUs += GetCurrentTimeUS() - t0;
+                break;
+            }
+
+            long long now = GetCurrentTimeUS();
+            if (!replayStart) {
+                replayStart = now;
+                segmentStartUs = rec.timeUs;
+            }
+            if (paced) {
+                long long due = replayStart + (rec.timeUs - segmentStartUs);
+                if (due > now) {
+                    usleep(due - now);
+                    idleUs += GetCurrentTimeUS() - now;
+                }
+            }
+            conn->run(data, rec.length, &measured, true);
+            segmentRecords++;
+            segmentBytes += rec.length;
+            break;
+        }
+        }
+    }
+    long long replayUs = replayStart ? GetCurrentTimeUS() - replayStart : 0;
+
+    while (conns.size() > 0) {
+        closeConnection(conns, conns.begin()->first, &divergent);
+    }
+
+    long long decodeUs = decodeOnly(reader, startUs, endUs);
+    long long dispatchUs = measured.decodeUs - decodeUs;
+    if (dispatchUs < 0) {
+        dispatchUs = 0;
+    }
+
+    if (startUs > 0) {
+        printf("skipped to %.1f ms in %.1f ms\n", startUs / 1000.0, skipUs / 1000.0);
+    }
+    printf("replayed %llu data records, %llu bytes, %d frames, %s\n",
+           segmentRecords, segmentBytes, measured.frames,
+           paced ? "recorded pace" : "max speed");
+    printf("    total     %10.1f ms", replayUs / 1000.0);
+    if (replayUs > 0) {
+        printf("  %.1f frames/s", measured.frames * 1000000.0 / replayUs);
+    }
+    printf("\n");
+    printf("    decode    %10.1f ms\n", decodeUs / 1000.0);
+    printf("    dispatch  %10.1f ms\n", dispatchUs / 1000.0);
+    printf("    driver    %10.1f ms\n", measured.driverUs / 1000.0);
+    if (paced) {
+        printf("    idle      %10.1f ms\n", idleUs / 1000.0);
+    }
+    printf("%llu data records with replies differing from the capture\n", divergent);
+
+    FrameBuffer::finalize();
+    return 0;
+}
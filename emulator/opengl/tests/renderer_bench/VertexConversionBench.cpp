@@ -0,0 +1,164 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Runs the GL_FIXED -> GL_FLOAT and GL_BYTE -> GL_SHORT vertex array
+// conversions of GLcommon on the common GLES1 vertex formats, with each
+// implementation the CPU supports, checks that they all produce the
+// scalar results and reports the conversion rate.
+//
+// usage: vertex_conversion_bench [-v vertices] [-n passes]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GLcommon/VertexConversion.h>
+#include "TimeUtils.h"
+
+struct Format {
+    const char *name;
+    GLenum type;        // GL_FIXED or GL_BYTE
+    int size;           // components
+    int strideIn;       // 0 when packed
+    bool indexed;
+};
+
+static const Format s_formats[] = {
+    { "fixed2 packed",       GL_FIXED, 2, 0,  false },
+    { "fixed3 packed",       GL_FIXED, 3, 0,  false },
+    { "fixed4 packed",       GL_FIXED, 4, 0,  false },
+    { "fixed2 stride 32",    GL_FIXED, 2, 32, false },
+    { "fixed3 stride 32",    GL_FIXED, 3, 32, false },
+    { "fixed4 stride 32",    GL_FIXED, 4, 32, false },
+    { "fixed3 indexed",      GL_FIXED, 3, 0,  true  },
+    { "fixed4 indexed",      GL_FIXED, 4, 0,  true  },
+    { "byte3 packed",        GL_BYTE,  3, 0,  false },
+    { "byte4 packed",        GL_BYTE,  4, 0,  false },
+    { "byte4 stride 16",     GL_BYTE,  4, 16, false },
+    { "byte4 indexed",       GL_BYTE,  4, 0,  true  },
+};
+
+static const char *s_implNames[] = { "scalar", "sse2", "avx2" };
+
+static void convert(const Format &f, const char *in, char *out,
+                    int nVerts, const GLushort *indices)
+{
+    int inSize = f.type == GL_FIXED ? sizeof(GLfixed) : sizeof(GLbyte);
+    int outSize = f.type == GL_FIXED ? sizeof(GLfloat) : sizeof(GLshort);
+    unsigned int strideIn = f.strideIn ? f.strideIn : f.size * inSize;
+    unsigned int strideOut = f.size * outSize;
+
+    if (f.indexed && f.type == GL_FIXED) {
+        convertFixedToFloatIndexed(in, strideIn, out, strideOut, nVerts,
+                                   GL_UNSIGNED_SHORT, indices, f.size);
+    } else if (f.indexed) {
+        convertByteToShortIndexed(in, strideIn, out, strideOut, nVerts,
+                                  GL_UNSIGNED_SHORT, indices, f.size);
+    } else if (f.type == GL_FIXED) {
+        convertFixedToFloat(in, strideIn, out, strideOut, nVerts, f.size);
+    } else {
+        convertByteToShort(in, strideIn, out, strideOut, nVerts, f.size);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int nVerts = 4096;
+    int passes = 2000;
+    int c;
+
+    while ((c = getopt(argc, argv, "v:n:")) != -1) {
+        switch (c) {
+        case 'v':
+            nVerts = atoi(optarg);
+            break;
+        case 'n':
+            passes = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-v vertices] [-n passes]\n", argv[0]);
+            return 1;
+        }
+    }
+    // indices are GLushort
+    if (nVerts < 1 || nVerts > 65536) nVerts = 4096;
+    if (passes < 1) passes = 1;
+
+    VertexConversionImpl best = getVertexConversionImpl();
+    printf("%d vertices, %d passes, best implementation %s\n",
+           nVerts, passes, s_implNames[best]);
+
+    size_t inBytes = (size_t)nVerts * 32;
+    size_t outBytes = (size_t)nVerts * 4 * sizeof(GLfloat);
+    char *in = (char *)malloc(inBytes);
+    char *ref = (char *)malloc(outBytes);
+    char *out = (char *)malloc(outBytes);
+    GLushort *indices = (GLushort *)malloc(nVerts * sizeof(GLushort));
+
+    srand(1);
+    for (size_t i = 0; i < inBytes; i++) {
+        in[i] = (char)rand();
+    }
+    // a shuffled index list, as meshes reference vertices out of order
+    for (int i = 0; i < nVerts; i++) {
+        indices[i] = i;
+    }
+    for (int i = nVerts - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        GLushort t = indices[i]; indices[i] = indices[j]; indices[j] = t;
+    }
+
+    int rc = 0;
+    for (size_t f = 0; f < sizeof(s_formats) / sizeof(s_formats[0]); f++) {
+        const Format &fmt = s_formats[f];
+
+        setVertexConversionImpl(VERTEX_CONVERSION_SCALAR);
+        memset(ref, 0, outBytes);
+        convert(fmt, in, ref, nVerts, indices);
+
+        printf("%-18s", fmt.name);
+        for (int impl = VERTEX_CONVERSION_SCALAR; impl <= best; impl++) {
+            setVertexConversionImpl((VertexConversionImpl)impl);
+
+            memset(out, 0, outBytes);
+            convert(fmt, in, out, nVerts, indices);
+            if (memcmp(out, ref, outBytes) != 0) {
+                printf(" %s: MISMATCH", s_implNames[impl]);
+                rc = 1;
+                continue;
+            }
+
+            long long t0 = GetCurrentTimeUS();
+            for (int p = 0; p < passes; p++) {
+                convert(fmt, in, out, nVerts, indices);
+            }
+            long long us = GetCurrentTimeUS() - t0;
+            if (us <= 0) us = 1;
+            printf(" %s %8.1f Mvert/s", s_implNames[impl],
+                   (double)nVerts * passes / us);
+        }
+        printf("\n");
+    }
+    setVertexConversionImpl(best);
+
+    free(in);
+    free(ref);
+    free(out);
+    free(indices);
+    return rc;
+}
@@ -31,3 +31,23 @@ $(call emugl-import,libMac_view)
 endif
 
 $(call emugl-end-module)
+
+$(call emugl-begin-host-executable,callBenchCM)
+$(call emugl-import,libEGL_translator libGLES_CM_translator)
+
+LOCAL_SRC_FILES:= \
+        callBenchCM.cpp
+
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+$(call emugl-begin-host-executable,particlesCM)
+$(call emugl-import,libEGL_translator libGLES_CM_translator)
+
+LOCAL_SRC_FILES:= \
+        particlesCM.cpp
+
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
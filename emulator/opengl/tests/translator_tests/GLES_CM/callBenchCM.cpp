@@ -0,0 +1,124 @@
+/*
+* Copyright 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Measures the translator's cost per GLES1 call on a call heavy stream:
+// each frame issues glColor4x / glTranslatex pairs on a pbuffer context,
+// the way many small state changes come from the guest.
+//
+// usage: callBenchCM [-c pairs per frame] [-f frames]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#undef ANDROID
+#include <EGL/egl.h>
+#include <GLES/gl.h>
+
+static EGLint const attribute_list[] = {
+    EGL_RED_SIZE, 1,
+    EGL_GREEN_SIZE, 1,
+    EGL_BLUE_SIZE, 1,
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_NONE
+};
+
+static EGLint const pbuffer_attribs[] = {
+    EGL_WIDTH, 64,
+    EGL_HEIGHT, 64,
+    EGL_NONE
+};
+
+static long long nowUS()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+int main(int argc, char **argv)
+{
+    int pairs = 5000;
+    int frames = 200;
+    int c;
+
+    while ((c = getopt(argc, argv, "c:f:")) != -1) {
+        switch (c) {
+        case 'c':
+            pairs = atoi(optarg);
+            break;
+        case 'f':
+            frames = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-c pairs per frame] [-f frames]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (pairs < 1) pairs = 5000;
+    if (frames < 1) frames = 200;
+
+    int major, minor, num_config;
+    EGLConfig config;
+    EGLDisplay d = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (!eglInitialize(d, &major, &minor) ||
+        !eglChooseConfig(d, attribute_list, &config, 1, &num_config) ||
+        num_config < 1) {
+        fprintf(stderr, "no pbuffer config\n");
+        return 1;
+    }
+    EGLSurface surface = eglCreatePbufferSurface(d, config, pbuffer_attribs);
+    EGLContext ctx = eglCreateContext(d, config, EGL_NO_CONTEXT, NULL);
+    if (surface == EGL_NO_SURFACE || ctx == EGL_NO_CONTEXT ||
+        eglMakeCurrent(d, surface, surface, ctx) != EGL_TRUE) {
+        fprintf(stderr, "make current failed\n");
+        return 1;
+    }
+
+    glMatrixMode(GL_MODELVIEW);
+    glFinish();
+
+    long long total = 0;
+    for (int f = 0; f < frames; f++) {
+        long long t0 = nowUS();
+        glPushMatrix();
+        for (int i = 0; i < pairs; i++) {
+            glColor4x(i << 4, 0x8000, 0x4000, 0x10000);
+            glTranslatex(0x100, -0x100, 0);
+        }
+        glPopMatrix();
+        total += nowUS() - t0;
+        glFinish();
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        fprintf(stderr, "GL error 0x%x\n", err);
+    }
+
+    double calls = 2.0 * pairs * frames + 2.0 * frames;
+    printf("%d frames of %d glColor4x/glTranslatex pairs: %.1f us/frame, %.1f ns/call\n",
+           frames, pairs, (double)total / frames, total * 1000.0 / calls);
+
+    eglMakeCurrent(d, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroySurface(d, surface);
+    eglDestroyContext(d, ctx);
+    eglTerminate(d);
+    return err != GL_NO_ERROR;
+}
@@ -0,0 +1,198 @@
+/*
+* Copyright 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Particle system drawn with a point size array, the way GLES1 games do
+// it: each frame moves the particles and draws them all with a single
+// glDrawArrays(GL_POINTS). The frame is timed twice, once with the
+// translator's point size program and once with it disabled through
+// ANDROID_GLES_NO_POINT_SIZE_PROGRAM, where every run of equal sizes
+// becomes a host draw of its own.
+//
+// usage: particlesCM [-n particles] [-s distinct sizes] [-f frames]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#undef ANDROID
+#include <EGL/egl.h>
+#include <GLES/gl.h>
+#define GL_GLEXT_PROTOTYPES
+#include <GLES/glext.h>
+
+static EGLint const attribute_list[] = {
+    EGL_RED_SIZE, 1,
+    EGL_GREEN_SIZE, 1,
+    EGL_BLUE_SIZE, 1,
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_NONE
+};
+
+static EGLint const pbuffer_attribs[] = {
+    EGL_WIDTH, 256,
+    EGL_HEIGHT, 256,
+    EGL_NONE
+};
+
+struct Particle {
+    GLfloat x, y;
+    GLfloat dx, dy;
+};
+
+static long long nowUS()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static float frand()
+{
+    return (float)rand() / RAND_MAX * 2.0f - 1.0f;
+}
+
+//
+// Runs the particle loop on a fresh context and returns the average
+// frame time in microseconds, or -1 on failure.
+//
+static double runFrames(EGLDisplay d, EGLConfig config,
+                        Particle* particles, GLfloat* positions,
+                        GLfloat* sizes, int count, int frames)
+{
+    EGLSurface surface = eglCreatePbufferSurface(d, config, pbuffer_attribs);
+    EGLContext ctx = eglCreateContext(d, config, EGL_NO_CONTEXT, NULL);
+    if (surface == EGL_NO_SURFACE || ctx == EGL_NO_CONTEXT ||
+        eglMakeCurrent(d, surface, surface, ctx) != EGL_TRUE) {
+        fprintf(stderr, "make current failed\n");
+        return -1;
+    }
+
+    glClearColor(0, 0, 0, 1);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glColor4f(1.0f, 0.6f, 0.2f, 0.5f);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_POINT_SIZE_ARRAY_OES);
+    glVertexPointer(2, GL_FLOAT, 0, positions);
+    glPointSizePointerOES(GL_FLOAT, 0, sizes);
+
+    // one frame outside the timing, for the point size program setup
+    glDrawArrays(GL_POINTS, 0, count);
+    glFinish();
+
+    long long total = 0;
+    for (int f = 0; f < frames; f++) {
+        long long t0 = nowUS();
+        for (int i = 0; i < count; i++) {
+            Particle& p = particles[i];
+            p.x += p.dx;
+            p.y += p.dy;
+            if (p.x < -1.0f || p.x > 1.0f) p.dx = -p.dx;
+            if (p.y < -1.0f || p.y > 1.0f) p.dy = -p.dy;
+            positions[i * 2] = p.x;
+            positions[i * 2 + 1] = p.y;
+        }
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawArrays(GL_POINTS, 0, count);
+        glFinish();
+        total += nowUS() - t0;
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        fprintf(stderr, "GL error 0x%x\n", err);
+    }
+
+    eglMakeCurrent(d, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroySurface(d, surface);
+    eglDestroyContext(d, ctx);
+    return err != GL_NO_ERROR ? -1 : (double)total / frames;
+}
+
+int main(int argc, char **argv)
+{
+    int count = 20000;
+    int distinct = 8;
+    int frames = 100;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:s:f:")) != -1) {
+        switch (c) {
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 's':
+            distinct = atoi(optarg);
+            break;
+        case 'f':
+            frames = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n particles] [-s distinct sizes] [-f frames]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (count < 1) count = 20000;
+    if (distinct < 1) distinct = 8;
+    if (frames < 1) frames = 100;
+
+    int major, minor, num_config;
+    EGLConfig config;
+    EGLDisplay d = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (!eglInitialize(d, &major, &minor) ||
+        !eglChooseConfig(d, attribute_list, &config, 1, &num_config) ||
+        num_config < 1) {
+        fprintf(stderr, "no pbuffer config\n");
+        return 1;
+    }
+
+    Particle* particles = new Particle[count];
+    GLfloat* positions = new GLfloat[count * 2];
+    GLfloat* sizes = new GLfloat[count];
+
+    srand(1);
+    int runs = 0;
+    for (int i = 0; i < count; i++) {
+        particles[i].x = frand();
+        particles[i].y = frand();
+        particles[i].dx = frand() * 0.01f;
+        particles[i].dy = frand() * 0.01f;
+        sizes[i] = (float)(1 + rand() % distinct);
+        if (i == 0 || sizes[i] != sizes[i - 1]) runs++;
+    }
+
+    unsetenv("ANDROID_GLES_NO_POINT_SIZE_PROGRAM");
+    double single = runFrames(d, config, particles, positions, sizes, count, frames);
+    setenv("ANDROID_GLES_NO_POINT_SIZE_PROGRAM", "1", 1);
+    double split = runFrames(d, config, particles, positions, sizes, count, frames);
+
+    eglTerminate(d);
+    delete[] particles;
+    delete[] positions;
+    delete[] sizes;
+
+    if (single < 0 || split < 0) {
+        return 1;
+    }
+
+    printf("%d particles, %d sizes, %d frames\n", count, distinct, frames);
+    printf("    point size program: %10.1f us/frame\n", single);
+    printf("    runs of equal size: %10.1f us/frame (%d draws/frame)\n", split, runs);
+    return 0;
+}
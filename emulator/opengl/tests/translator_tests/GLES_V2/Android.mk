@@ -29,3 +29,13 @@ endif
 
 $(call emugl-end-module)
 
+
+$(call emugl-begin-host-executable,shaderSourceV2)
+$(call emugl-import,libEGL_translator libGLES_V2_translator)
+
+LOCAL_SRC_FILES:= \
+        shaderSourceV2.cpp
+
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
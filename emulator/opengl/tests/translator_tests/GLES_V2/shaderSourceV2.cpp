@@ -0,0 +1,166 @@
+/*
+* Copyright 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Times glShaderSource on a GLES2 pbuffer context for a fragment shader
+// given for the first time and given again to new shader objects, the
+// way an application recreating its shaders does. The repeated ones are
+// served by the translator's shader cache, unless
+// ANDROID_GLES_NO_SHADER_CACHE is set.
+//
+// usage: shaderSourceV2 [-l source lines] [-n shaders]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <sys/time.h>
+
+#undef ANDROID
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+static EGLint const attribute_list[] = {
+    EGL_RED_SIZE, 1,
+    EGL_GREEN_SIZE, 1,
+    EGL_BLUE_SIZE, 1,
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+    EGL_NONE
+};
+
+static EGLint const context_attribs[] = {
+    EGL_CONTEXT_CLIENT_VERSION, 2,
+    EGL_NONE
+};
+
+static EGLint const pbuffer_attribs[] = {
+    EGL_WIDTH, 64,
+    EGL_HEIGHT, 64,
+    EGL_NONE
+};
+
+static long long nowUS()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+// a long shader with the precision statements and comments the
+// translator has to get through
+static std::string makeSource(int lines)
+{
+    std::string src = "// generated shader\n"
+                      "precision mediump float;\n"
+                      "uniform sampler2D tex;\n"
+                      "varying vec2 uv;\n"
+                      "void main() {\n"
+                      "    highp vec4 c = texture2D(tex, uv);\n";
+    char line[128];
+    for (int i = 0; i < lines; i++) {
+        snprintf(line, sizeof(line),
+                 "    /* step %d */ c = c * 0.999 + vec4(%d.0 / 1024.0); // blend\n",
+                 i, i % 1024);
+        src += line;
+    }
+    src += "    gl_FragColor = c;\n"
+           "}\n";
+    return src;
+}
+
+int main(int argc, char **argv)
+{
+    int lines = 500;
+    int shaders = 200;
+    int c;
+
+    while ((c = getopt(argc, argv, "l:n:")) != -1) {
+        switch (c) {
+        case 'l':
+            lines = atoi(optarg);
+            break;
+        case 'n':
+            shaders = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-l source lines] [-n shaders]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (lines < 1) lines = 500;
+    if (shaders < 2) shaders = 200;
+
+    int major, minor, num_config;
+    EGLConfig config;
+    EGLDisplay d = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (!eglInitialize(d, &major, &minor) ||
+        !eglChooseConfig(d, attribute_list, &config, 1, &num_config) ||
+        num_config < 1) {
+        fprintf(stderr, "no pbuffer config\n");
+        return 1;
+    }
+    EGLSurface surface = eglCreatePbufferSurface(d, config, pbuffer_attribs);
+    EGLContext ctx = eglCreateContext(d, config, EGL_NO_CONTEXT, context_attribs);
+    if (surface == EGL_NO_SURFACE || ctx == EGL_NO_CONTEXT ||
+        eglMakeCurrent(d, surface, surface, ctx) != EGL_TRUE) {
+        fprintf(stderr, "make current failed\n");
+        return 1;
+    }
+
+    std::string src = makeSource(lines);
+    const GLchar *str = src.c_str();
+    GLuint *names = new GLuint[shaders];
+    for (int i = 0; i < shaders; i++) {
+        names[i] = glCreateShader(GL_FRAGMENT_SHADER);
+    }
+
+    long long t0 = nowUS();
+    glShaderSource(names[0], 1, &str, NULL);
+    long long first = nowUS() - t0;
+
+    t0 = nowUS();
+    for (int i = 1; i < shaders; i++) {
+        glShaderSource(names[i], 1, &str, NULL);
+    }
+    long long again = nowUS() - t0;
+
+    // the translated source has to compile like before
+    glCompileShader(names[shaders - 1]);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(names[shaders - 1], GL_COMPILE_STATUS, &compiled);
+
+    for (int i = 0; i < shaders; i++) {
+        glDeleteShader(names[i]);
+    }
+    delete[] names;
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        fprintf(stderr, "GL error 0x%x\n", err);
+    }
+
+    printf("%u byte shader: first glShaderSource %lld us, again %.1f us%s\n",
+           (unsigned int)src.size(), first, (double)again / (shaders - 1),
+           compiled ? "" : " (compile failed)");
+
+    eglMakeCurrent(d, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroySurface(d, surface);
+    eglDestroyContext(d, ctx);
+    eglTerminate(d);
+    return err != GL_NO_ERROR || !compiled;
+}
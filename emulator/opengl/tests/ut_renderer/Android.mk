@@ -27,4 +27,24 @@ LOCAL_LDLIBS += -lpthread -lX11 -lrt
 
 $(call emugl-end-module)
 
+# UnixStream vs SharedMemoryStream throughput/latency benchmark
+$(call emugl-begin-host-executable,ut_stream_bench)
+$(call emugl-import,libOpenglCodecCommon libOpenglOsUtils)
+
+LOCAL_SRC_FILES := StreamBench.cpp
+LOCAL_CFLAGS += -O2
+
+$(call emugl-end-module)
+
+# FrameBuffer handle table contention benchmark
+$(call emugl-begin-host-executable,ut_handle_table_bench)
+$(call emugl-import,libOpenglCodecCommon libOpenglOsUtils)
+
+LOCAL_SRC_FILES := HandleTableBench.cpp
+LOCAL_C_INCLUDES += $(EMUGL_PATH)/host/libs/libOpenglRender
+LOCAL_CFLAGS += -O2
+LOCAL_LDLIBS += -lpthread
+
+$(call emugl-end-module)
+
 endif # HOST_OS == linux
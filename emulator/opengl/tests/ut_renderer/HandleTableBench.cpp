@@ -0,0 +1,209 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Compares the FrameBuffer handle lookups under contention:
+//  - global: one mutex around a std::map, held for the whole call as
+//    FrameBuffer used to do.
+//  - striped: HandleTable, the lock is only held for the lookup, a slot
+//    array access, and the call works on its own copy of the object
+//    reference.
+// Each thread looks up its own handles, like one RenderThread per guest
+// process, and every 64th operation creates and destroys a handle.
+// The "work" done per call stands for the GL calls made with the object.
+//
+// usage: ut_handle_table_bench [-t maxThreads] [-n opsPerThread] [-w work]
+// (-w 0 measures the lookup alone)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <map>
+#include "HandleTable.h"
+#include "SmartPtr.h"
+#include "osThread.h"
+#include "TimeUtils.h"
+
+#define HANDLES_PER_THREAD 32
+#define MAX_THREADS 64
+
+struct Object {
+    volatile unsigned int value;
+};
+typedef SmartPtr<Object> ObjectPtr;
+
+static void doWork(Object *p_obj, int p_work)
+{
+    for (int i = 0; i < p_work; i++) {
+        p_obj->value++;
+    }
+}
+
+class GlobalTable {
+public:
+    GlobalTable() : m_nextHandle(0) {}
+    HandleType add(const ObjectPtr &p_obj) {
+        android::Mutex::Autolock mutex(m_lock);
+        HandleType h = ++m_nextHandle;
+        m_map[h] = p_obj;
+        return h;
+    }
+    void remove(HandleType p_handle) {
+        android::Mutex::Autolock mutex(m_lock);
+        m_map.erase(p_handle);
+    }
+    bool call(HandleType p_handle, int p_work) {
+        android::Mutex::Autolock mutex(m_lock);
+        std::map<HandleType, ObjectPtr>::iterator i(m_map.find(p_handle));
+        if (i == m_map.end()) {
+            return false;
+        }
+        doWork((*i).second.Ptr(), p_work);
+        return true;
+    }
+private:
+    android::Mutex m_lock;
+    std::map<HandleType, ObjectPtr> m_map;
+    HandleType m_nextHandle;
+};
+
+class StripedTable {
+public:
+    StripedTable() : m_table(0) {}
+    HandleType add(const ObjectPtr &p_obj) {
+        return m_table.add(p_obj);
+    }
+    void remove(HandleType p_handle) {
+        m_table.remove(p_handle);
+    }
+    bool call(HandleType p_handle, int p_work) {
+        ObjectPtr obj;
+        if (!m_table.get(p_handle, &obj)) {
+            return false;
+        }
+        doWork(obj.Ptr(), p_work);
+        return true;
+    }
+private:
+    HandleTable<ObjectPtr> m_table;
+};
+
+template <class TableT>
+class Worker : public osUtils::Thread {
+public:
+    Worker() : m_table(NULL), m_ops(0), m_work(0), m_misses(0) {}
+
+    void init(TableT *p_table, int p_ops, int p_work) {
+        m_table = p_table;
+        m_ops = p_ops;
+        m_work = p_work;
+    }
+
+    void addHandles() {
+        for (int i = 0; i < HANDLES_PER_THREAD; i++) {
+            m_handles[i] = m_table->add(ObjectPtr(new Object()));
+        }
+    }
+
+    virtual int Main() {
+        for (int i = 0; i < m_ops; i++) {
+            if ((i & 63) == 63) {
+                m_table->remove(m_table->add(ObjectPtr(new Object())));
+            } else if (!m_table->call(m_handles[i % HANDLES_PER_THREAD], m_work)) {
+                m_misses++;
+            }
+        }
+        return 0;
+    }
+
+    int misses() const { return m_misses; }
+
+private:
+    TableT *m_table;
+    HandleType m_handles[HANDLES_PER_THREAD];
+    int m_ops;
+    int m_work;
+    int m_misses;
+};
+
+template <class TableT>
+static bool runOne(const char *name, int numThreads, int ops, int work)
+{
+    TableT table;
+    Worker<TableT> workers[MAX_THREADS];
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].init(&table, ops, work);
+        workers[t].addHandles();
+    }
+
+    long long t0 = GetCurrentTimeUS();
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].start();
+    }
+    int misses = 0;
+    for (int t = 0; t < numThreads; t++) {
+        int exitStatus;
+        workers[t].wait(&exitStatus);
+        misses += workers[t].misses();
+    }
+    long long us = GetCurrentTimeUS() - t0;
+    if (us <= 0) us = 1;
+
+    if (misses) {
+        fprintf(stderr, "%s: %d lookups failed\n", name, misses);
+        return false;
+    }
+    printf("%-8s %3d threads %12.2f Mops/s\n", name, numThreads,
+           (double)numThreads * ops / us);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int maxThreads = 16;
+    int ops = 1000000;
+    int work = 100;
+    int c;
+
+    while ((c = getopt(argc, argv, "t:n:w:")) != -1) {
+        switch (c) {
+        case 't':
+            maxThreads = atoi(optarg);
+            break;
+        case 'n':
+            ops = atoi(optarg);
+            break;
+        case 'w':
+            work = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t maxThreads] [-n opsPerThread] "
+                            "[-w work]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (maxThreads < 1) maxThreads = 1;
+    if (maxThreads > MAX_THREADS) maxThreads = MAX_THREADS;
+
+    for (int n = 1; n <= maxThreads; n *= 2) {
+        if (!runOne<GlobalTable>("global", n, ops, work) ||
+            !runOne<StripedTable>("striped", n, ops, work)) {
+            return 1;
+        }
+    }
+    return 0;
+}
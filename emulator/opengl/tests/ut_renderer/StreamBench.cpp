@@ -0,0 +1,185 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+//
+// Compares UnixStream and SharedMemoryStream between two threads:
+//  - throughput: the client streams commands of a given size through
+//    alloc() (or writeFully() for 64KB and more, like large arguments)
+//    and the server reads them with read() as a RenderThread does.
+//  - latency: round trips of an 8 byte request and a 4 byte reply,
+//    like a GL call returning a value.
+//
+// usage: ut_stream_bench [-m totalMB] [-r roundTrips]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "UnixStream.h"
+#include "SharedMemoryStream.h"
+#include "osThread.h"
+#include "TimeUtils.h"
+
+#define READ_BUFFER_SIZE (4 * 1024 * 1024)
+#define CLIENT_BUFFER_SIZE (16 * 1024)
+#define LARGE_PACKET_SIZE (64 * 1024)
+
+enum { MODE_THROUGHPUT, MODE_LATENCY };
+
+class Server : public osUtils::Thread {
+public:
+    Server(SocketStream *listenSock, int mode) :
+        m_listenSock(listenSock), m_mode(mode), m_bytes(0) {}
+
+    virtual int Main() {
+        SocketStream *stream = m_listenSock->accept();
+        if (!stream) {
+            fprintf(stderr, "accept failed\n");
+            return -1;
+        }
+
+        unsigned char *buf = (unsigned char *)malloc(READ_BUFFER_SIZE);
+        if (m_mode == MODE_THROUGHPUT) {
+            size_t len = READ_BUFFER_SIZE;
+            while (stream->read(buf, &len)) {
+                m_bytes += len;
+                len = READ_BUFFER_SIZE;
+            }
+        } else {
+            while (stream->readFully(buf, 8)) {
+                unsigned int *reply = (unsigned int *)stream->alloc(4);
+                memcpy(reply, buf, 4);
+                stream->flush();
+            }
+        }
+        free(buf);
+        delete stream;
+        return 0;
+    }
+
+    unsigned long long bytes() const { return m_bytes; }
+
+private:
+    SocketStream *m_listenSock;
+    int m_mode;
+    unsigned long long m_bytes;
+};
+
+template <class StreamT>
+static bool runOne(const char *name, int mode, size_t packetSize,
+                   size_t totalBytes, int roundTrips)
+{
+    char addr[SocketStream::MAX_ADDRSTR_LEN];
+    StreamT *listenSock = new StreamT();
+    if (listenSock->listen(addr) < 0) {
+        fprintf(stderr, "%s: listen failed\n", name);
+        delete listenSock;
+        return false;
+    }
+
+    Server server(listenSock, mode);
+    server.start();
+
+    StreamT *client = new StreamT(CLIENT_BUFFER_SIZE);
+    if (client->connect(addr) < 0) {
+        fprintf(stderr, "%s: connect failed\n", name);
+        delete client;
+        delete listenSock;
+        return false;
+    }
+
+    long long t0 = GetCurrentTimeMS();
+    if (mode == MODE_THROUGHPUT) {
+        unsigned char *payload = (unsigned char *)calloc(1, packetSize);
+        for (size_t sent = 0; sent < totalBytes; sent += packetSize) {
+            if (packetSize >= LARGE_PACKET_SIZE) {
+                client->writeFully(payload, packetSize);
+            } else {
+                unsigned char *ptr = client->alloc(packetSize);
+                memcpy(ptr, payload, packetSize);
+            }
+        }
+        client->flush();
+        free(payload);
+    } else {
+        for (int i = 0; i < roundTrips; i++) {
+            unsigned char *ptr = client->alloc(8);
+            memcpy(ptr, &i, 4);
+            memset(ptr + 4, 0, 4);
+            int reply;
+            if (!client->readback(&reply, 4) || reply != i) {
+                fprintf(stderr, "%s: bad reply\n", name);
+                break;
+            }
+        }
+    }
+    delete client; // the server sees the end of the stream
+    int exitStatus;
+    server.wait(&exitStatus);
+    long long ms = GetCurrentTimeMS() - t0;
+    delete listenSock;
+
+    if (ms <= 0) ms = 1;
+    if (mode == MODE_THROUGHPUT) {
+        printf("%-14s %8zu byte packets %10.1f MB/s\n", name, packetSize,
+               server.bytes() / (1024.0 * 1024.0) / (ms / 1000.0));
+    } else {
+        printf("%-14s round trip %29.2f us\n", name, ms * 1000.0 / roundTrips);
+    }
+    return true;
+}
+
+template <class StreamT>
+static bool runAll(const char *name, size_t totalBytes, int roundTrips)
+{
+    static const size_t sizes[] = { 64, 1024, 64 * 1024, 1024 * 1024 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (!runOne<StreamT>(name, MODE_THROUGHPUT, sizes[i], totalBytes, 0)) {
+            return false;
+        }
+    }
+    return runOne<StreamT>(name, MODE_LATENCY, 0, 0, roundTrips);
+}
+
+int main(int argc, char **argv)
+{
+    size_t totalMB = 512;
+    int roundTrips = 20000;
+    int c;
+
+    while ((c = getopt(argc, argv, "m:r:")) != -1) {
+        switch (c) {
+        case 'm':
+            totalMB = (size_t)atoi(optarg);
+            break;
+        case 'r':
+            roundTrips = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m totalMB] [-r roundTrips]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (roundTrips < 1) roundTrips = 1;
+
+    size_t totalBytes = totalMB * 1024 * 1024;
+    if (!runAll<UnixStream>("UnixStream", totalBytes, roundTrips) ||
+        !runAll<SharedMemoryStream>("SharedMemory", totalBytes, roundTrips)) {
+        return 1;
+    }
+    return 0;
+}